@@ -0,0 +1,291 @@
+// SPDX-FileCopyrightText: 2020 P Burgess for Adafruit Industries
+//
+// SPDX-License-Identifier: MIT
+
+// Desktop harness for the camera setup path in ov7670.c, run against the
+// simulated OV7670 in arch/posix.c. Times OV7670_begin() (safe and fast
+// boot, and warm restart from saved full and diff register profiles) to
+// return and to first complete frame, then for each
+// OV7670_size: OV7670_set_size(), latency from there to the first complete
+// frame, and the steady-state interval between frames. It also checks
+// that the frame size the registers produce (per the simulation) matches
+// what OV7670_set_size() was asked for. Since the simulated camera runs
+// at register-implied timing, delays and frame waits here are real time,
+// the same as on hardware, and register reads & writes are delayed as
+// 100 KHz I2C would be. Counts of register transactions that actually
+// reached the "bus" (rather than the register cache) are shown too, and
+// the read-modify-write config functions are timed on their own, and a
+// few OV7670_set_window() crops and OV7670_set_scaled_size() sizes are
+// checked like the sizes. For each, the output PCLK (after the COM14
+// divider) is shown and checked to be as slow as the frame allows.
+//
+// Usage: bench_capture [-q] [-f fps] [-p image.ppm] [-o out.ppm]
+//   -q   Quick run (fewer frames, e.g. for CI)
+//   -f   Requested frame rate (default 30)
+//   -p   Load PPM/PGM image as the camera's scene (default color bars)
+//   -o   Save captured VGA RGB frame as PPM (e.g. to eyeball windowing)
+
+#define _POSIX_C_SOURCE 199309L // For clock_gettime()
+#include "ov7670.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char *space_name[] = {"RGB", "YUV"};
+static const char *boot_name[] = {"safe", "fast"};
+
+// Crop rectangles for OV7670_set_window(), in pixels of the given size
+static const struct {
+  OV7670_size size;
+  uint16_t x, y, width, height;
+} roi[] = {
+    {OV7670_SIZE_DIV1, 220, 210, 200, 60}, // Inspection strip from VGA
+    {OV7670_SIZE_DIV2, 0, 0, 160, 120},    // Top-left quarter of QVGA
+    {OV7670_SIZE_DIV4, 40, 30, 80, 60},    // Center of QQVGA
+};
+
+// Exact sizes for OV7670_set_scaled_size(): CIF, QCIF and some displays
+static const struct {
+  uint16_t width, height;
+} scaled[] = {{352, 288}, {176, 144}, {240, 240}, {160, 128}, {128, 128}};
+
+// Frame size checks catch PCLK divided too far (the simulated camera then
+// loses pixels, as a real one would). This catches the opposite: each
+// output pixel takes 2 PCLKs and a line lasts as long as the sensor
+// window at the undivided clock, so if the frame would still fit with
+// PCLK halved again, it's running faster than needed (costing the host
+// bandwidth). Divider is returned in div for the error message.
+static bool pclk_ok(OV7670_arch *arch, uint16_t width, uint8_t *div) {
+  uint16_t win_w, win_h;
+  OV7670_sim_window(arch, &win_w, &win_h);
+  OV7670_sim_pclk_hz(arch, div);
+  return (*div >= 16) || (win_w / (*div * 2) < width);
+}
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+// Write big-endian RGB565 frame as binary PPM, returns false on error
+static bool save_ppm(const char *filename, const uint16_t *pixels,
+                     uint16_t width, uint16_t height) {
+  FILE *file = fopen(filename, "wb");
+  if (!file) {
+    return false;
+  }
+  fprintf(file, "P6\n%d %d\n255\n", width, height);
+  const uint8_t *bytes = (const uint8_t *)pixels;
+  for (uint32_t i = 0; i < (uint32_t)width * height; i++) {
+    uint16_t c = (bytes[i * 2] << 8) | bytes[i * 2 + 1];
+    uint8_t rgb[3] = {(c >> 8) & 0xF8, (c >> 3) & 0xFC, (c << 3) & 0xF8};
+    fwrite(rgb, 1, 3, file);
+  }
+  return fclose(file) == 0;
+}
+
+int main(int argc, char *argv[]) {
+  bool quick = false;
+  float fps = 30.0;
+  const char *scene = NULL, *out = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-q")) {
+      quick = true;
+    } else if (!strcmp(argv[i], "-f") && (i + 1 < argc)) {
+      fps = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "-p") && (i + 1 < argc)) {
+      scene = argv[++i];
+    } else if (!strcmp(argv[i], "-o") && (i + 1 < argc)) {
+      out = argv[++i];
+    } else {
+      fprintf(stderr,
+              "Usage: %s [-q] [-f fps] [-p image.ppm] [-o out.ppm]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+  int frames = quick ? 3 : 15; // Frames averaged for steady-state interval
+
+  // Pins are all -1, so OV7670_begin() takes the soft-reset path
+  OV7670_pins pins;
+  memset(&pins, -1, sizeof pins);
+  static OV7670_arch arch; // Static because it's biggish
+  OV7670_host host = {&arch, &pins, &host};
+  if (scene && !OV7670_sim_load(&arch, scene)) {
+    fprintf(stderr, "Can't load %s (binary PPM/PGM, maxval 255)\n", scene);
+    return 1;
+  }
+  uint16_t *pixels = malloc(640 * 480 * sizeof(uint16_t));
+  if (!pixels) {
+    fprintf(stderr, "malloc failed\n");
+    return 1;
+  }
+
+  int errors = 0;
+  for (int space = OV7670_COLOR_RGB; space <= OV7670_COLOR_YUV; space++) {
+    double start;
+    for (int boot = OV7670_BOOT_SAFE; boot <= OV7670_BOOT_FAST; boot++) {
+      arch.i2c_writes = arch.i2c_reads = 0;
+      start = now_ms();
+      OV7670_status status =
+          OV7670_begin(&host, space, OV7670_SIZE_DIV1, fps, boot);
+      double begin_ms = now_ms() - start;
+      uint32_t begin_writes = arch.i2c_writes, begin_reads = arch.i2c_reads;
+      if (status != OV7670_STATUS_OK) {
+        fprintf(stderr, "OV7670_begin() failed, status %d\n", status);
+        return 1;
+      }
+      OV7670_capture(&arch, pixels, 640, 480);
+      double boot_ms = now_ms() - start;
+      float actual_fps = 1e9 / OV7670_sim_frame_ns(&arch);
+      printf("%s %s boot: begin %.1f ms (I2C %u wr, %u rd), first frame "
+             "%.1f ms, %.2f fps (%.2f asked)\n",
+             space_name[space], boot_name[boot], begin_ms, begin_writes,
+             begin_reads, boot_ms, actual_fps, fps);
+    }
+
+    // Warm restart from saved register profiles. The camera's registers
+    // afterward should be identical to a full startup.
+    OV7670_command profile[256];
+    uint8_t expected[256];
+    memcpy(expected, arch.reg, sizeof expected);
+    for (int diff = 0; diff <= 1; diff++) {
+      int len = OV7670_profile_save(&arch.cache, profile, 256, diff);
+      host.profile = profile;
+      host.profile_len = len;
+      arch.i2c_writes = arch.i2c_reads = 0;
+      start = now_ms();
+      // fps 0: the profile sets the clock, fast boot's wait follows it
+      OV7670_begin(&host, space, OV7670_SIZE_DIV1, 0, OV7670_BOOT_FAST);
+      double begin_ms = now_ms() - start;
+      uint32_t begin_writes = arch.i2c_writes;
+      OV7670_capture(&arch, pixels, 640, 480);
+      printf("%s %s profile (%d regs): begin %.1f ms (I2C %u wr), first "
+             "frame %.1f ms",
+             space_name[space], diff ? "diff" : "full", len, begin_ms,
+             begin_writes, now_ms() - start);
+      if (memcmp(expected, arch.reg, sizeof expected)) {
+        printf("  MISMATCH: registers differ from full startup");
+        errors++;
+      }
+      putchar('\n');
+      host.profile = NULL;
+    }
+    printf("%-4s %9s %9s %9s %8s %11s %12s\n", "spc", "size", "set ms",
+           "I2C wr/rd", "PCLK MHz", "1st frm ms", "interval ms");
+
+    for (int size = OV7670_SIZE_DIV1; size <= OV7670_SIZE_DIV16; size++) {
+      uint16_t width = 640 >> size, height = 480 >> size;
+      arch.i2c_writes = arch.i2c_reads = 0;
+      start = now_ms();
+      OV7670_set_size(host.platform, size);
+      double set_ms = now_ms() - start;
+      char i2c[20];
+      snprintf(i2c, sizeof i2c, "%u/%u", arch.i2c_writes, arch.i2c_reads);
+      OV7670_capture(&arch, pixels, width, height);
+      double first_ms = now_ms() - start;
+      start = now_ms();
+      for (int f = 0; f < frames; f++) {
+        OV7670_capture(&arch, pixels, width, height);
+      }
+      double interval_ms = (now_ms() - start) / frames;
+      printf("%-4s %4dx%-4d %9.3f %9s %8.3f %11.1f %12.2f",
+             space_name[space], width, height, set_ms, i2c,
+             OV7670_sim_pclk_hz(&arch, NULL) / 1e6, first_ms, interval_ms);
+
+      uint16_t sim_width, sim_height;
+      uint8_t div;
+      OV7670_sim_frame_size(&arch, &sim_width, &sim_height);
+      if ((sim_width != width) || (sim_height != height)) {
+        printf("  MISMATCH: camera outputs %dx%d", sim_width, sim_height);
+        errors++;
+      } else if (!pclk_ok(&arch, width, &div)) {
+        printf("  MISMATCH: PCLK /%d is faster than needed", div);
+        errors++;
+      }
+      putchar('\n');
+
+      if (out && (space == OV7670_COLOR_RGB) && !size &&
+          !save_ppm(out, pixels, width, height)) {
+        fprintf(stderr, "Can't write %s\n", out);
+      }
+    }
+
+    // Cropped windows from OV7670_set_window(), output size checked the
+    // same way. DMA (and the buffer) would only need the cropped pixels.
+    for (size_t r = 0; r < sizeof roi / sizeof roi[0]; r++) {
+      uint16_t width = roi[r].width, height = roi[r].height;
+      arch.i2c_writes = arch.i2c_reads = 0;
+      start = now_ms();
+      OV7670_set_window(host.platform, roi[r].size, roi[r].x, roi[r].y, width,
+                        height);
+      double set_ms = now_ms() - start;
+      char i2c[20];
+      snprintf(i2c, sizeof i2c, "%u/%u", arch.i2c_writes, arch.i2c_reads);
+      OV7670_capture(&arch, pixels, width, height);
+      printf("%-4s %4dx%-4d %9.3f %9s %8.3f %11.1f  window at %d,%d of 1:%d",
+             space_name[space], width, height, set_ms, i2c,
+             OV7670_sim_pclk_hz(&arch, NULL) / 1e6, now_ms() - start,
+             roi[r].x, roi[r].y, 1 << roi[r].size);
+      uint16_t sim_width, sim_height;
+      uint8_t div;
+      OV7670_sim_frame_size(&arch, &sim_width, &sim_height);
+      if ((sim_width != width) || (sim_height != height)) {
+        printf("  MISMATCH: camera outputs %dx%d", sim_width, sim_height);
+        errors++;
+      } else if (!pclk_ok(&arch, width, &div)) {
+        printf("  MISMATCH: PCLK /%d is faster than needed", div);
+        errors++;
+      }
+      putchar('\n');
+    }
+
+    // Exact sizes through the downsampler and fractional scaler
+    for (size_t i = 0; i < sizeof scaled / sizeof scaled[0]; i++) {
+      uint16_t width = scaled[i].width, height = scaled[i].height;
+      arch.i2c_writes = arch.i2c_reads = 0;
+      start = now_ms();
+      bool ok = OV7670_set_scaled_size(host.platform, width, height);
+      double set_ms = now_ms() - start;
+      char i2c[20];
+      snprintf(i2c, sizeof i2c, "%u/%u", arch.i2c_writes, arch.i2c_reads);
+      OV7670_capture(&arch, pixels, width, height);
+      printf("%-4s %4dx%-4d %9.3f %9s %8.3f %11.1f  scaled",
+             space_name[space], width, height, set_ms, i2c,
+             OV7670_sim_pclk_hz(&arch, NULL) / 1e6, now_ms() - start);
+      uint16_t sim_width, sim_height;
+      uint8_t div;
+      OV7670_sim_frame_size(&arch, &sim_width, &sim_height);
+      if (!ok) {
+        printf("  FAILED: size not accepted");
+        errors++;
+      } else if ((sim_width != width) || (sim_height != height)) {
+        printf("  MISMATCH: camera outputs %dx%d", sim_width, sim_height);
+        errors++;
+      } else if (!pclk_ok(&arch, width, &div)) {
+        printf("  MISMATCH: PCLK /%d is faster than needed", div);
+        errors++;
+      }
+      putchar('\n');
+    }
+  }
+
+  // Preview/still style mode changes: flip, night mode and test pattern
+  // on, then back off, each a read-modify-write of camera registers.
+  arch.i2c_writes = arch.i2c_reads = 0;
+  double start = now_ms();
+  OV7670_flip(host.platform, true, true);
+  OV7670_night(host.platform, OV7670_NIGHT_MODE_2);
+  OV7670_test_pattern(host.platform, OV7670_TEST_PATTERN_COLOR_BAR);
+  OV7670_flip(host.platform, false, false);
+  OV7670_night(host.platform, OV7670_NIGHT_MODE_OFF);
+  OV7670_test_pattern(host.platform, OV7670_TEST_PATTERN_NONE);
+  printf("Mode changes: %.3f ms (I2C %u wr, %u rd)\n", now_ms() - start,
+         arch.i2c_writes, arch.i2c_reads);
+
+  free(pixels);
+  free(arch.image);
+  return errors ? 1 : 0;
+}
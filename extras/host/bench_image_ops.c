@@ -0,0 +1,827 @@
+// SPDX-FileCopyrightText: 2020 P Burgess for Adafruit Industries
+//
+// SPDX-License-Identifier: MIT
+
+// Desktop microbenchmark for the postprocessing functions in image_ops.c
+// (plus OV7670_Y2RGB565() from ov7670.c). Each op is timed at all five
+// OV7670_size resolutions, in both RGB and YUV colorspaces, and reported
+// as nanoseconds per pixel and megabytes (of 16-bit pixel data) per
+// second. Numbers are from whatever machine runs this, NOT the camera's
+// microcontroller, so only compare results from the same machine -- the
+// point is catching regressions (or confirming wins) in the C code itself.
+// Each op is also run on a cropped OV7670_view of a full frame and checked
+// against the same op on a packed copy of those pixels. "median_sel" is
+// a copy of the 3x3 median as it was before the sorting network (row
+// buffers and selection passes, RGB only), to compare speed against.
+// Medians are checked against a plain brute-force version (Y only for
+// YUV, "median_c" checks U and V too; "_c" ops filter YUV chroma, and are
+// the same as the plain ones for RGB). "blur" and "blur7" (box blurs,
+// radius 1 and 7) and "local_thr" are checked against plain window sums;
+// "integral" times building a summed-area table plus a box mean per 8x8
+// tile. Convolutions ("gauss3", "gauss5", "sharpen", "unsharp", "emboss",
+// "sobel", "scharr", the library presets) are checked against a plain
+// weighted sum; "gauss5_full" is gauss5 as a non-separable 25-weight
+// kernel, to compare against the separable one. "chain3" is three point
+// ops in series; "pipeline" and "pipe64k" are the same three as an
+// OV7670_pipeline (per-channel and 64K-entry tables), checked against
+// it. Filters get working memory from one OV7670_scratch arena,
+// sized by OV7670_scratch_bytes() for the largest frame and window.
+//
+// Usage: bench_image_ops [-q] [-c] [-l] [op ...]
+//   -q   Quick run (fewer repetitions, e.g. for CI)
+//   -c   Print CSV instead of a table
+//   -l   Little-endian pixel data (as with OV7670_set_order()), checked
+//        against big-endian results
+//   op   Only run ops with these names (e.g. "median edges")
+
+#define _POSIX_C_SOURCE 199309L // For clock_gettime()
+#include "image_ops.h"
+#include "ov7670.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Each op is wrapped in a function with the same arguments, so they can
+// all go in one table. Parameters are the library's default arguments.
+// These call the _view() versions, which the others are shorthand for.
+
+// Working memory for the filters, set up once in main()
+static OV7670_scratch scratch;
+
+static void op_negative(const OV7670_view *view) {
+  OV7670_image_negative_view(view);
+}
+
+static void op_threshold(const OV7670_view *view) {
+  OV7670_image_threshold_view(view, 128);
+}
+
+static void op_posterize(const OV7670_view *view) {
+  OV7670_image_posterize_view(view, 4);
+}
+
+static void op_mosaic(const OV7670_view *view) {
+  OV7670_image_mosaic_view(view, 8, 8);
+}
+
+static void op_median(const OV7670_view *view) {
+  OV7670_image_median_view(view, &scratch);
+}
+
+static void op_edges(const OV7670_view *view) {
+  OV7670_image_edges_view(view, 7, &scratch);
+}
+
+static void op_y2rgb565(const OV7670_view *view) {
+  OV7670_Y2RGB565_view(view);
+}
+
+static void op_yuv2rgb565(const OV7670_view *view) {
+  OV7670_YUV2RGB565_view(view, NULL);
+}
+
+static void op_y_extract(const OV7670_view *view) {
+  static uint8_t plane[640 * 480]; // Separate, so the frame is unchanged
+  OV7670_Y_extract_view(view, plane);
+}
+
+static void op_median5(const OV7670_view *view) {
+  OV7670_image_median_radius_view(view, 2, &scratch);
+}
+
+static void op_median7(const OV7670_view *view) {
+  OV7670_image_median_radius_view(view, 3, &scratch);
+}
+
+static void op_median_c(const OV7670_view *view) {
+  OV7670_image_median_yuv(view, 1, true, &scratch);
+}
+
+static void op_mosaic_c(const OV7670_view *view) {
+  OV7670_image_mosaic_yuv(view, 8, 8, true);
+}
+
+static void op_edges_c(const OV7670_view *view) {
+  OV7670_image_edges_yuv(view, 7, true, &scratch);
+}
+
+// Median of the n values in list, by selection passes up to the middle
+// (the list is reordered).
+static uint8_t ref_select(uint8_t *list, int n) {
+  uint8_t min = 0;
+  for (int pass = 0; pass <= n / 2; pass++) {
+    int min_idx = pass;
+    min = list[pass];
+    for (int j = pass + 1; j < n; j++) {
+      if (list[j] < min) {
+        min = list[j];
+        min_idx = j;
+      }
+    }
+    list[min_idx] = list[pass];
+  }
+  return min;
+}
+
+// Plain, slow median of YUV planes: Y, plus U and V (half as many across,
+// every other pixel's high or low byte) if chroma is set.
+static void ref_median_yuv(const OV7670_view *view, uint8_t radius,
+                           bool chroma) {
+  uint16_t width = view->width, height = view->height;
+  uint32_t row_bytes = width * 2;
+  uint8_t *copy = malloc(row_bytes * height);
+  for (uint16_t y = 0; y < height; y++) {
+    memcpy(&copy[y * row_bytes], OV7670_view_row(view, y), row_bytes);
+  }
+  int luma = (view->order == OV7670_ORDER_BIG) ? 0 : 1;
+  int size = radius * 2 + 1;
+  uint8_t list[225];
+  for (int p = 0; p < (chroma ? 3 : 1); p++) {
+    int offset = p ? (luma ^ 1) + (p - 1) * 2 : luma;
+    int step = p ? 4 : 2;
+    int samples = (p == 0) ? width : (p == 1) ? (width + 1) / 2 : width / 2;
+    for (int y = 0; y < height; y++) {
+      uint8_t *row = (uint8_t *)OV7670_view_row(view, y) + offset;
+      for (int x = 0; x < samples; x++) {
+        int i = 0;
+        for (int dy = -radius; dy <= radius; dy++) {
+          int yy = (y + dy < 0) ? 0 : (y + dy >= height) ? height - 1 : y + dy;
+          for (int dx = -radius; dx <= radius; dx++) {
+            int xx = (x + dx < 0)          ? 0
+                     : (x + dx >= samples) ? samples - 1
+                                           : x + dx;
+            list[i++] = copy[yy * row_bytes + offset + xx * step];
+          }
+        }
+        row[x * step] = ref_select(list, size * size);
+      }
+    }
+  }
+  free(copy);
+}
+
+// Plain, slow median filter over a (2 * radius + 1) square, edge pixels
+// repeated, to check the library's against (YUV: Y only, as the library).
+// For correctness only, it's not meant to be fast.
+static void ref_median(const OV7670_view *view, uint8_t radius) {
+  if (view->space == OV7670_COLOR_YUV) {
+    ref_median_yuv(view, radius, false);
+    return;
+  }
+  uint16_t width = view->width, height = view->height;
+  uint16_t *copy = malloc(width * height * sizeof(uint16_t));
+  for (uint16_t y = 0; y < height; y++) {
+    memcpy(&copy[y * width], OV7670_view_row(view, y), width * 2);
+  }
+  bool swap = (view->order == OV7670_ORDER_BIG);
+  int size = radius * 2 + 1, n = size * size;
+  uint8_t list[3][225];
+  for (int y = 0; y < height; y++) {
+    uint16_t *row = OV7670_view_row(view, y);
+    for (int x = 0; x < width; x++) {
+      int i = 0;
+      for (int dy = -radius; dy <= radius; dy++) {
+        int yy = (y + dy < 0) ? 0 : (y + dy >= height) ? height - 1 : y + dy;
+        for (int dx = -radius; dx <= radius; dx++, i++) {
+          int xx = (x + dx < 0) ? 0 : (x + dx >= width) ? width - 1 : x + dx;
+          uint16_t rgb = copy[yy * width + xx];
+          rgb = swap ? __builtin_bswap16(rgb) : rgb;
+          list[0][i] = rgb >> 11;
+          list[1][i] = (rgb >> 5) & 0x3F;
+          list[2][i] = rgb & 0x1F;
+        }
+      }
+      uint16_t rgb = (ref_select(list[0], n) << 11) |
+                     (ref_select(list[1], n) << 5) | ref_select(list[2], n);
+      row[x] = swap ? __builtin_bswap16(rgb) : rgb;
+    }
+  }
+  free(copy);
+}
+
+static void ref_median3(const OV7670_view *view) { ref_median(view, 1); }
+
+// The library's 3x3 median as it was before the sorting network, copied
+// as is (comments trimmed) for "median_sel" to compare against: pixels
+// unpacked to column-major row buffers, malloc()ed per call, and five
+// selection passes over each 9 values per channel. RGB only, as it was.
+#define SEL_SPECIALIZE static inline __attribute__((always_inline))
+
+SEL_SPECIALIZE uint16_t sel_swap(uint16_t pixel, bool swap) {
+  return swap ? __builtin_bswap16(pixel) : pixel;
+}
+
+SEL_SPECIALIZE void sel_row_prep(uint16_t *src, uint8_t *r_dst,
+                                 uint16_t width, uint32_t channel_bytes,
+                                 bool swap) {
+  uint8_t *g_dst = &r_dst[channel_bytes];
+  uint8_t *b_dst = &g_dst[channel_bytes];
+
+  uint16_t x, rgb, offset = 3;
+  for (x = 0; x < width; x++) {        // For each pixel in row...
+    rgb = sel_swap(*src++, swap);      // Packed RGB565 pixel
+    r_dst[offset] = rgb >> 11;         // Extract 5 bits red,
+    g_dst[offset] = (rgb >> 5) & 0x3F; // 6 bits green,
+    b_dst[offset] = rgb & 0x1F;        // 5 bits blue
+    offset += 3;
+  }
+  r_dst[0] = r_dst[3]; // Duplicate leftmost pixel
+  g_dst[0] = g_dst[3];
+  b_dst[0] = b_dst[3];
+  x = offset - 3;
+  r_dst[offset] = r_dst[x]; // Duplicate rightmost pixel
+  g_dst[offset] = g_dst[x];
+  b_dst[offset] = b_dst[x];
+}
+
+static void sel_row_copy(uint8_t *r_src, uint8_t *r_dst, uint16_t width,
+                         uint32_t channel_bytes) {
+  uint8_t *g_src = &r_src[channel_bytes];
+  uint8_t *b_src = &g_src[channel_bytes];
+  uint8_t *g_dst = &r_dst[channel_bytes];
+  uint8_t *b_dst = &g_dst[channel_bytes];
+  uint16_t x, offset;
+
+  for (x = offset = 0; x < width; x++, offset += 3) {
+    r_dst[offset] = r_src[offset];
+    g_dst[offset] = g_src[offset];
+    b_dst[offset] = b_src[offset];
+  }
+}
+
+static inline uint8_t sel_med9(uint8_t *list) {
+  uint8_t buf[9];
+  memcpy(buf, list, 9);
+
+  uint8_t n, i, min, min_idx;
+
+  for (n = 0; n < 5; n++) {       // 5 min-finding passes
+    min = buf[n];                 //   Initial min guess...
+    min_idx = n;                  //   is at index 'n' (0-4)
+    for (i = n + 1; i < 9; i++) { //   Compare through end of list...
+      if (buf[i] < min) {         //     Keep track of
+        min = buf[i];             //     min value and
+        min_idx = i;              //     index of min in list
+      }
+    }
+    buf[min_idx] = buf[n];
+  }
+
+  return min; // min of 5th pass (max of 5 least values)
+}
+
+SEL_SPECIALIZE void sel_median_rgb(const OV7670_view *view, bool swap) {
+  uint16_t width = view->width, height = view->height;
+  uint8_t *buf;
+  uint32_t buf_bytes_per_channel = (width + 2) * 3 + height - 1;
+  if ((buf = (uint8_t *)malloc(buf_bytes_per_channel * 3))) {
+    uint8_t *rptr = buf;                          // -> red buffer
+    uint8_t *gptr = &rptr[buf_bytes_per_channel]; // -> green buffer
+    uint8_t *bptr = &gptr[buf_bytes_per_channel]; // -> blue buffer
+
+    sel_row_prep(view->pixels, &rptr[1], width, buf_bytes_per_channel, swap);
+    sel_row_copy(&rptr[1], rptr, width + 2, buf_bytes_per_channel);
+
+    uint16_t *ptr; // Dest pointer, back into source image
+    uint16_t x, y, offset, rgb;
+    uint8_t r_med, g_med, b_med;
+    for (y = 0; y < height; y++) { // For each row of image...
+      if (y < (height - 1)) {
+        sel_row_prep(OV7670_view_row(view, y + 1), &rptr[2], width,
+                     buf_bytes_per_channel, swap);
+      } else {
+        sel_row_copy(&rptr[1], &rptr[2], width + 2, buf_bytes_per_channel);
+      }
+
+      ptr = OV7670_view_row(view, y);
+      for (x = offset = 0; x < width; x++, offset += 3) { // Each column...
+        r_med = sel_med9(&rptr[offset]);                  // 3x3 median red
+        g_med = sel_med9(&gptr[offset]);                  // " green
+        b_med = sel_med9(&bptr[offset]);                  // " blue
+        rgb = (r_med << 11) | (g_med << 5) | b_med;       // Recombine 565
+        *ptr++ = sel_swap(rgb, swap);                     // back in image
+      }
+      rptr++; // Next row
+      gptr++;
+      bptr++;
+    }
+
+    free(buf);
+  }
+}
+
+static void op_median_sel(const OV7670_view *view) {
+  if (view->order == OV7670_ORDER_BIG) {
+    sel_median_rgb(view, true);
+  } else {
+    sel_median_rgb(view, false);
+  }
+}
+
+static void ref_median5(const OV7670_view *view) { ref_median(view, 2); }
+
+static void ref_median7(const OV7670_view *view) { ref_median(view, 3); }
+
+static void ref_median_c(const OV7670_view *view) {
+  if (view->space == OV7670_COLOR_YUV) {
+    ref_median_yuv(view, 1, true);
+  } else {
+    ref_median(view, 1);
+  }
+}
+
+static void op_blur(const OV7670_view *view) {
+  OV7670_image_box_blur_view(view, 1, &scratch);
+}
+
+static void op_blur7(const OV7670_view *view) {
+  OV7670_image_box_blur_view(view, 7, &scratch);
+}
+
+static void op_local_thr(const OV7670_view *view) {
+  OV7670_image_local_threshold_view(view, 7, 10, &scratch);
+}
+
+// Summed-area table of the whole view, 32-bit, then one box mean per
+// 8x8 tile (timing only, the image isn't changed).
+static volatile uint8_t mean; // So the compiler can't skip the queries
+
+static void op_integral(const OV7670_view *view) {
+  static uint8_t mem[641 * 481 * 4 + 640];
+  OV7670_integral integral;
+  OV7670_integral_build(&integral, mem, true, view, OV7670_CHANNEL_GREEN);
+  for (uint16_t y = 0; y < view->height; y += 8) {
+    for (uint16_t x = 0; x < view->width; x += 8) {
+      mean = OV7670_integral_mean(&integral, x, y, 8, 8);
+    }
+  }
+}
+
+// Plain box filter, summing each window pixel by pixel (the part inside
+// the image, at the edges): the rounded average, or with threshold, 0 if
+// the pixel is more than bias (8-bit units) below it, else full scale.
+// RGB565 channels each, YUV Y only, as the library.
+static void ref_box(const OV7670_view *view, int radius, int bias,
+                    bool threshold) {
+  uint16_t width = view->width, height = view->height;
+  uint32_t row_bytes = width * 2;
+  uint8_t *copy = malloc(row_bytes * height);
+  for (uint16_t y = 0; y < height; y++) {
+    memcpy(&copy[y * row_bytes], OV7670_view_row(view, y), row_bytes);
+  }
+  bool yuv = (view->space == OV7670_COLOR_YUV);
+  int hi = (view->order == OV7670_ORDER_BIG) ? 0 : 1;
+  // Field of each channel in the native 16-bit value (Y: the high byte)
+  static const int yuv_field[][2] = {{8, 0xFF}};
+  static const int rgb_field[][2] = {{11, 0x1F}, {5, 0x3F}, {0, 0x1F}};
+  const int(*field)[2] = yuv ? yuv_field : rgb_field;
+  for (int c = 0; c < (yuv ? 1 : 3); c++) {
+    int pos = field[c][0], mask = field[c][1];
+    int shift = (mask == 0xFF) ? 0 : (mask == 0x3F) ? 2 : 3;
+    for (int y = 0; y < height; y++) {
+      uint8_t *row = (uint8_t *)OV7670_view_row(view, y);
+      for (int x = 0; x < width; x++) {
+        uint32_t sum = 0, area = 0;
+        for (int yy = y - radius; yy <= y + radius; yy++) {
+          for (int xx = x - radius; xx <= x + radius; xx++) {
+            if ((yy >= 0) && (yy < height) && (xx >= 0) && (xx < width)) {
+              const uint8_t *p = &copy[yy * row_bytes + xx * 2];
+              sum += (((p[hi] << 8) | p[hi ^ 1]) >> pos) & mask;
+              area++;
+            }
+          }
+        }
+        uint8_t *p = &row[x * 2];
+        uint16_t native = (p[hi] << 8) | p[hi ^ 1];
+        int value = (native >> pos) & mask;
+        if (threshold) {
+          value = (((value << shift) + bias) * area < (sum << shift)) ? 0
+                                                                      : mask;
+        } else {
+          value = (sum + area / 2) / area;
+        }
+        native = (native & ~(mask << pos)) | (value << pos);
+        p[hi] = native >> 8;
+        if (!yuv) {
+          p[hi ^ 1] = native;
+        }
+      }
+    }
+  }
+  free(copy);
+}
+
+static void ref_blur(const OV7670_view *view) { ref_box(view, 1, 0, false); }
+
+static void ref_blur7(const OV7670_view *view) { ref_box(view, 7, 0, false); }
+
+static void ref_local_thr(const OV7670_view *view) {
+  ref_box(view, 7, 10, true);
+}
+
+// Convolution with each stock kernel, plus the 5x5 Gaussian as a full
+// (non-separable) 25-weight kernel, to compare. main() sets these up.
+static OV7670_kernel kernels[OV7670_KERNEL_SCHARR + 1], gauss5_full;
+
+static void op_gauss3(const OV7670_view *view) {
+  OV7670_image_convolve_view(view, &kernels[OV7670_KERNEL_GAUSSIAN3],
+                             &scratch);
+}
+
+static void op_gauss5(const OV7670_view *view) {
+  OV7670_image_convolve_view(view, &kernels[OV7670_KERNEL_GAUSSIAN5],
+                             &scratch);
+}
+
+static void op_gauss5_full(const OV7670_view *view) {
+  OV7670_image_convolve_view(view, &gauss5_full, &scratch);
+}
+
+static void op_sharpen(const OV7670_view *view) {
+  OV7670_image_convolve_view(view, &kernels[OV7670_KERNEL_SHARPEN], &scratch);
+}
+
+static void op_unsharp(const OV7670_view *view) {
+  OV7670_image_convolve_view(view, &kernels[OV7670_KERNEL_UNSHARP], &scratch);
+}
+
+static void op_emboss(const OV7670_view *view) {
+  OV7670_image_convolve_view(view, &kernels[OV7670_KERNEL_EMBOSS], &scratch);
+}
+
+static void op_sobel(const OV7670_view *view) {
+  OV7670_image_convolve_view(view, &kernels[OV7670_KERNEL_SOBEL], &scratch);
+}
+
+static void op_scharr(const OV7670_view *view) {
+  OV7670_image_convolve_view(view, &kernels[OV7670_KERNEL_SCHARR], &scratch);
+}
+
+// Plain convolution, edge pixels repeated, each window summed straight
+// from a copy of the image with the kernel expanded to its full square.
+static void ref_convolve(const OV7670_view *view, const OV7670_kernel *k) {
+  uint16_t width = view->width, height = view->height;
+  uint32_t row_bytes = width * 2;
+  uint8_t *copy = malloc(row_bytes * height);
+  for (uint16_t y = 0; y < height; y++) {
+    memcpy(&copy[y * row_bytes], OV7670_view_row(view, y), row_bytes);
+  }
+  int size = k->size, pad = size / 2, w[25];
+  for (int i = 0; i < size; i++) { // Row
+    for (int j = 0; j < size; j++) {
+      w[i * size + j] = k->separable ? k->weights[size + i] * k->weights[j]
+                                     : k->weights[i * size + j];
+    }
+  }
+  bool yuv = (view->space == OV7670_COLOR_YUV);
+  int hi = (view->order == OV7670_ORDER_BIG) ? 0 : 1;
+  static const int yuv_field[][2] = {{8, 0xFF}};
+  static const int rgb_field[][2] = {{11, 0x1F}, {5, 0x3F}, {0, 0x1F}};
+  const int(*field)[2] = yuv ? yuv_field : rgb_field;
+  for (int c = 0; c < (yuv ? 1 : 3); c++) {
+    int pos = field[c][0], mask = field[c][1];
+    int bias = k->bias >> ((mask == 0xFF) ? 0 : (mask == 0x3F) ? 2 : 3);
+    for (int y = 0; y < height; y++) {
+      uint8_t *row = (uint8_t *)OV7670_view_row(view, y);
+      for (int x = 0; x < width; x++) {
+        int32_t gx = 0, gy = 0;
+        for (int i = 0; i < size; i++) {
+          int yy = y + i - pad;
+          yy = (yy < 0) ? 0 : (yy >= height) ? height - 1 : yy;
+          for (int j = 0; j < size; j++) {
+            int xx = x + j - pad;
+            xx = (xx < 0) ? 0 : (xx >= width) ? width - 1 : xx;
+            const uint8_t *p = &copy[yy * row_bytes + xx * 2];
+            int v = (((p[hi] << 8) | p[hi ^ 1]) >> pos) & mask;
+            gx += w[i * size + j] * v;
+            gy += w[j * size + i] * v;
+          }
+        }
+        int32_t sum = k->gradient ? abs(gx) + abs(gy) : gx;
+        if (k->shift) {
+          sum = (sum + (1 << (k->shift - 1))) >> k->shift;
+        }
+        sum += bias;
+        int value = (sum < 0) ? 0 : (sum > mask) ? mask : sum;
+        uint8_t *p = &row[x * 2];
+        uint16_t native = (p[hi] << 8) | p[hi ^ 1];
+        native = (native & ~(mask << pos)) | (value << pos);
+        p[hi] = native >> 8;
+        if (!yuv) {
+          p[hi ^ 1] = native;
+        }
+      }
+    }
+  }
+  free(copy);
+}
+
+static void ref_gauss3(const OV7670_view *view) {
+  ref_convolve(view, &kernels[OV7670_KERNEL_GAUSSIAN3]);
+}
+
+static void ref_gauss5(const OV7670_view *view) {
+  ref_convolve(view, &kernels[OV7670_KERNEL_GAUSSIAN5]);
+}
+
+static void ref_sharpen(const OV7670_view *view) {
+  ref_convolve(view, &kernels[OV7670_KERNEL_SHARPEN]);
+}
+
+static void ref_unsharp(const OV7670_view *view) {
+  ref_convolve(view, &kernels[OV7670_KERNEL_UNSHARP]);
+}
+
+static void ref_emboss(const OV7670_view *view) {
+  ref_convolve(view, &kernels[OV7670_KERNEL_EMBOSS]);
+}
+
+static void ref_sobel(const OV7670_view *view) {
+  ref_convolve(view, &kernels[OV7670_KERNEL_SOBEL]);
+}
+
+static void ref_scharr(const OV7670_view *view) {
+  ref_convolve(view, &kernels[OV7670_KERNEL_SCHARR]);
+}
+
+// Three point ops in series, the slow way (a pass each)...
+static void op_chain3(const OV7670_view *view) {
+  OV7670_image_negative_view(view);
+  OV7670_image_posterize_view(view, 4);
+  OV7670_image_threshold_view(view, 128);
+}
+
+// ...and the same three compiled into one pass, with per-channel tables
+// or the 64K-entry table. main() sets these up.
+static OV7670_pipeline pipeline, pipeline64k;
+
+static void op_pipeline(const OV7670_view *view) {
+  OV7670_pipeline_apply(&pipeline, view);
+}
+
+static void op_pipe64k(const OV7670_view *view) {
+  OV7670_pipeline_apply(&pipeline64k, view);
+}
+
+// Ops with a ref function must give the same results as it
+static const struct {
+  const char *name;
+  void (*func)(const OV7670_view *);
+  void (*ref)(const OV7670_view *);
+  bool rgb_only; // Skipped in YUV
+} ops[] = {
+    {"negative", op_negative},
+    {"threshold", op_threshold},
+    {"posterize", op_posterize},
+    {"mosaic", op_mosaic},
+    {"median", op_median, ref_median3},
+    {"median_sel", op_median_sel, ref_median3, true},
+    {"median5", op_median5, ref_median5},
+    {"median7", op_median7, ref_median7},
+    {"median_c", op_median_c, ref_median_c},
+    {"edges", op_edges},
+    {"edges_c", op_edges_c},
+    {"mosaic_c", op_mosaic_c},
+    {"Y2RGB565", op_y2rgb565},
+    {"YUV2RGB565", op_yuv2rgb565},
+    {"Y_extract", op_y_extract},
+    {"blur", op_blur, ref_blur},
+    {"blur7", op_blur7, ref_blur7},
+    {"local_thr", op_local_thr, ref_local_thr},
+    {"integral", op_integral},
+    {"gauss3", op_gauss3, ref_gauss3},
+    {"gauss5", op_gauss5, ref_gauss5},
+    {"gauss5_full", op_gauss5_full, ref_gauss5},
+    {"sharpen", op_sharpen, ref_sharpen},
+    {"unsharp", op_unsharp, ref_unsharp},
+    {"emboss", op_emboss, ref_emboss},
+    {"sobel", op_sobel, ref_sobel},
+    {"scharr", op_scharr, ref_scharr},
+    {"chain3", op_chain3},
+    {"pipeline", op_pipeline, op_chain3},
+    {"pipe64k", op_pipe64k, op_chain3},
+};
+
+#define NUM_OPS (sizeof ops / sizeof ops[0])
+
+static const char *space_name[] = {"RGB", "YUV"};
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// Fill a frame with repeatable, camera-like content: smooth gradients plus
+// a little noise, so data-dependent ops (median especially) take realistic
+// branches. Data is big-endian, as from the camera, unless order says
+// otherwise.
+static void fill_image(OV7670_colorspace space, OV7670_order order,
+                       uint16_t *pixels, uint16_t width, uint16_t height) {
+  uint32_t seed = 12345;
+  for (uint16_t y = 0; y < height; y++) {
+    for (uint16_t x = 0; x < width; x++) {
+      seed = seed * 1103515245 + 12345; // Cheap LCG noise
+      uint8_t noise = (seed >> 16) & 0x0F;
+      uint8_t a = (x * 255 / width) ^ noise;
+      uint8_t b = (y * 255 / height) ^ noise;
+      uint16_t value;
+      if (space == OV7670_COLOR_RGB) {
+        value = ((a & 0xF8) << 8) | (((a + b) & 0xFC) << 3) | (b >> 3);
+        value = __builtin_bswap16(value);
+      } else { // YUV: Y in low byte, alternating U/V in high byte
+        value = ((x & 1) ? b : (255 - b)) << 8 | (uint8_t)((a + b) / 2);
+      }
+      if (order == OV7670_ORDER_LITTLE) {
+        value = __builtin_bswap16(value);
+      }
+      pixels[y * width + x] = value;
+    }
+  }
+}
+
+// Run an op on a crop of a full-frame image, in place, and on a packed
+// copy of the same pixels, which should give the same result. Pixels
+// outside the crop shouldn't change at all. Returns true if all's well.
+static bool check_view(void (*func)(const OV7670_view *),
+                       OV7670_colorspace space, OV7670_order order,
+                       const uint16_t *pristine, uint16_t *work,
+                       uint16_t *ref) {
+  const uint16_t width = 640, height = 480;
+  const uint16_t x = 14, y = 7, crop_width = 64, crop_height = 64;
+  memcpy(work, pristine, width * height * sizeof(uint16_t));
+  OV7670_view frame = OV7670_view_frame(space, order, work, width, height);
+  OV7670_view crop =
+      OV7670_view_crop(&frame, x, y, crop_width, crop_height);
+  for (uint16_t row = 0; row < crop_height; row++) {
+    memcpy(&ref[row * crop_width], OV7670_view_row(&crop, row),
+           crop_width * sizeof(uint16_t));
+  }
+  OV7670_view packed =
+      OV7670_view_frame(space, order, ref, crop_width, crop_height);
+  func(&crop);
+  func(&packed);
+  for (uint16_t row = 0; row < height; row++) {
+    for (uint16_t col = 0; col < width; col++) {
+      uint32_t i = row * width + col;
+      bool inside = (col >= x) && (col < x + crop_width) && (row >= y) &&
+                    (row < y + crop_height);
+      uint16_t expected =
+          inside ? ref[(row - y) * crop_width + col - x] : pristine[i];
+      if (work[i] != expected) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  bool quick = false, csv = false;
+  OV7670_order order = OV7670_ORDER_BIG;
+  int first_op_arg = argc;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-q")) {
+      quick = true;
+    } else if (!strcmp(argv[i], "-c")) {
+      csv = true;
+    } else if (!strcmp(argv[i], "-l")) {
+      order = OV7670_ORDER_LITTLE;
+    } else if (first_op_arg == argc) {
+      first_op_arg = i; // Remaining args are op names
+    }
+  }
+
+  int errors = 0;
+
+  // Minimum time spent on each op/size/colorspace combination
+  double min_ns = quick ? 20e6 : 250e6;
+
+  uint32_t max_pixels = 640 * 480;
+  uint16_t *pristine = malloc(max_pixels * sizeof(uint16_t));
+  uint16_t *work = malloc(max_pixels * sizeof(uint16_t));
+  uint16_t *ref = malloc(max_pixels * sizeof(uint16_t));
+  uint16_t *lut = malloc(65536 * sizeof(uint16_t));
+  if (!pristine || !work || !ref || !lut) {
+    fprintf(stderr, "malloc failed\n");
+    return 1;
+  }
+
+  uint32_t scratch_bytes = OV7670_scratch_bytes(640, 7);
+  void *scratch_mem = malloc(scratch_bytes);
+  if (!scratch_mem) {
+    fprintf(stderr, "malloc failed\n");
+    return 1;
+  }
+  OV7670_scratch_init(&scratch, scratch_mem, scratch_bytes);
+
+  OV7670_pipeline_init(&pipeline, NULL);
+  OV7670_pipeline_init(&pipeline64k, lut);
+  OV7670_pipeline *pipelines[] = {&pipeline, &pipeline64k};
+  for (int i = 0; i < 2; i++) {
+    OV7670_pipeline_add(pipelines[i], OV7670_POINT_NEGATIVE, 0);
+    OV7670_pipeline_add(pipelines[i], OV7670_POINT_POSTERIZE, 4);
+    OV7670_pipeline_add(pipelines[i], OV7670_POINT_THRESHOLD, 128);
+  }
+  for (int k = 0; k <= OV7670_KERNEL_SCHARR; k++) {
+    kernels[k] = OV7670_kernel_preset((OV7670_kernel_type)k);
+  }
+  gauss5_full = kernels[OV7670_KERNEL_GAUSSIAN5];
+  gauss5_full.separable = false;
+  for (int i = 0; i < 25; i++) {
+    gauss5_full.weights[i] = kernels[OV7670_KERNEL_GAUSSIAN5].weights[i / 5] *
+                             kernels[OV7670_KERNEL_GAUSSIAN5].weights[i % 5];
+  }
+
+  if (csv) {
+    puts("op,colorspace,width,height,ns_per_pixel,bytes_per_sec");
+  } else {
+    printf("%-10s %-4s %9s %10s %10s\n", "op", "spc", "size", "ns/pixel",
+           "MB/s");
+  }
+
+  for (size_t o = 0; o < NUM_OPS; o++) {
+    if (first_op_arg < argc) { // Op names given? Skip if not listed
+      bool listed = false;
+      for (int i = first_op_arg; i < argc; i++) {
+        listed |= !strcmp(argv[i], ops[o].name);
+      }
+      if (!listed) {
+        continue;
+      }
+    }
+    for (int space = OV7670_COLOR_RGB;
+         space <= (ops[o].rgb_only ? OV7670_COLOR_RGB : OV7670_COLOR_YUV);
+         space++) {
+      for (int size = OV7670_SIZE_DIV1; size <= OV7670_SIZE_DIV16; size++) {
+        uint16_t width = 640 >> size;
+        uint16_t height = 480 >> size;
+        uint32_t num_pixels = width * height;
+        fill_image(space, order, pristine, width, height);
+        OV7670_view view =
+            OV7670_view_frame(space, order, work, width, height);
+        // Time each call separately (the ops work in-place, so the input
+        // is restored between calls, untimed) and keep the best result.
+        double best = 1e30, total = 0;
+        for (int reps = 0; (reps < 3) || (total < min_ns); reps++) {
+          memcpy(work, pristine, num_pixels * sizeof(uint16_t));
+          double start = now_ns();
+          ops[o].func(&view);
+          double elapsed = now_ns() - start;
+          total += elapsed;
+          if (elapsed < best) {
+            best = elapsed;
+          }
+        }
+        // Little-endian results should be big-endian results, swapped
+        bool mismatch = false;
+        if (order == OV7670_ORDER_LITTLE) {
+          fill_image(space, OV7670_ORDER_BIG, ref, width, height);
+          OV7670_view big =
+              OV7670_view_frame(space, OV7670_ORDER_BIG, ref, width, height);
+          ops[o].func(&big);
+          for (uint32_t i = 0; i < num_pixels; i++) {
+            mismatch |= (__builtin_bswap16(ref[i]) != work[i]);
+          }
+          errors += mismatch;
+        }
+        // Same result as the reference op, if any?
+        if (ops[o].ref) {
+          memcpy(ref, pristine, num_pixels * sizeof(uint16_t));
+          OV7670_view expected =
+              OV7670_view_frame(space, order, ref, width, height);
+          ops[o].ref(&expected);
+          bool same = !memcmp(ref, work, num_pixels * sizeof(uint16_t));
+          mismatch |= !same;
+          errors += !same;
+        }
+        // A crop of the full frame should match the same op on a copy
+        bool view_ok = true;
+        if (size == OV7670_SIZE_DIV1) {
+          view_ok = check_view(ops[o].func, space, order, pristine, work,
+                               ref);
+          errors += !view_ok;
+        }
+        double ns_per_pixel = best / num_pixels;
+        double bytes_per_sec = num_pixels * sizeof(uint16_t) * 1e9 / best;
+        if (csv) {
+          printf("%s,%s,%d,%d,%.3f,%.0f\n", ops[o].name, space_name[space],
+                 width, height, ns_per_pixel, bytes_per_sec);
+        } else {
+          printf("%-10s %-4s %4dx%-4d %10.3f %10.1f%s%s\n", ops[o].name,
+                 space_name[space], width, height, ns_per_pixel,
+                 bytes_per_sec / 1e6, mismatch ? "  MISMATCH" : "",
+                 view_ok ? "" : "  VIEW MISMATCH");
+        }
+      }
+    }
+  }
+
+  free(scratch_mem);
+  free(lut);
+  free(ref);
+  free(work);
+  free(pristine);
+  return errors ? 1 : 0;
+}
@@ -39,19 +39,30 @@
 Adafruit_OV7670::Adafruit_OV7670(uint8_t addr, OV7670_pins *pins_ptr,
                                  TwoWire *twi_ptr, OV7670_arch *arch_ptr)
     : i2c_address(addr & 0x7f), wire(twi_ptr),
-      arch_defaults((arch_ptr == NULL)), buffer(NULL), buffer_size(0) {
+      arch_defaults((arch_ptr == NULL)), buffer(NULL), buffer_size(0),
+      boot_us(0), profile(NULL), profile_len(0), frames_seen(0),
+      strip_count(1), scratch_radius(0), luma(false) {
+  OV7670_cache_clear(&regcache);
+  OV7670_scratch_init(&scratch, NULL, 0);
+  OV7670_ring_init(&ring, &buffer, 0); // No buffers until begin()
   if (pins_ptr) {
     memcpy(&pins, pins_ptr, sizeof(OV7670_pins));
   }
   if (arch_ptr) {
     memcpy(&arch, arch_ptr, sizeof(OV7670_arch));
+  } else {
+    memset(&arch, 0, sizeof(OV7670_arch)); // Arch state starts clear
   }
 }
 
 Adafruit_OV7670::~Adafruit_OV7670() {
+  for (uint8_t i = 1; i < ring.count; i++) {
+    free(ring.buf[i]); // Extra frame buffers, if any
+  }
   if (buffer) {
     free(buffer);
   }
+  free(scratch.base);
   // TO DO: arch-specific code should have a function to clean up DMA
   // and timer. No rush really, destructor is unlikely to ever be used.
 }
@@ -60,8 +71,9 @@ Adafruit_OV7670::~Adafruit_OV7670() {
 
 OV7670_status Adafruit_OV7670::begin(OV7670_colorspace colorspace,
                                      OV7670_size size, float fps,
-                                     uint32_t bufsiz) {
+                                     uint32_t bufsiz, OV7670_boot boot) {
 
+  uint32_t start = micros();
   wire->begin();
   wire->setClock(100000); // Datasheet claims 400 KHz, but no, use 100 KHz
 
@@ -69,36 +81,140 @@ OV7670_status Adafruit_OV7670::begin(OV7670_colorspace colorspace,
   _height = 480 >> (int)size; // 480, 240, 120, 60, 30
   space = colorspace;
 
-  // Allocate buffer for camera
-  buffer_size = bufsiz ? bufsiz : _width * _height * sizeof(uint16_t);
-  buffer = (uint16_t *)malloc(buffer_size);
-  if (buffer == NULL) {
-    buffer_size = 0;
-    return OV7670_STATUS_ERR_MALLOC;
+  // Allocate buffer for camera, or in strip mode, all of the strip buffers
+  // (so DMA can cycle through them from the first frame)
+  uint16_t *bufs[OV7670_RING_MAX];
+  uint8_t count = 1;
+  if (ring.strip_rows) {
+    buffer_size = ring.strip_rows * _width * pixel_bytes();
+    count = strip_count;
+  } else {
+    buffer_size = bufsiz ? bufsiz : _width * _height * pixel_bytes();
+  }
+  for (uint8_t i = 0; i < count; i++) {
+    bufs[i] = (uint16_t *)malloc(buffer_size);
+    if (bufs[i] == NULL) {
+      while (i--) {
+        free(bufs[i]);
+      }
+      buffer = NULL;
+      buffer_size = 0;
+      return OV7670_STATUS_ERR_MALLOC;
+    }
   }
+  buffer = bufs[0];
+  ring.strip_height = _height;
+  ring.row_width = _width;
+  OV7670_ring_buffers(&ring, bufs, count); // Keeps any callbacks
+  if (scratch_radius && (scratch_fit() != OV7670_STATUS_OK)) {
+    setScratch(0); // Filters will use the heap instead
+  }
+
+  // Camera is about to be reset, anything known about registers is stale
+  OV7670_cache_clear(&regcache);
 
-  return arch_begin(colorspace, size, fps); // Device-specific setup
+  OV7670_status status = arch_begin(colorspace, size, fps, boot);
+  if ((status == OV7670_STATUS_OK) && (ring.order != OV7670_ORDER_BIG) &&
+      (pixel_bytes() == 2)) {
+    OV7670_set_order(this, ring.order); // Camera reset to big-endian
+  }
+  boot_us = micros() - start;
+  return status;
 }
 
 int Adafruit_OV7670::readRegister(uint8_t reg) {
-  wire->beginTransmission(i2c_address);
-  wire->write(reg);
-  wire->endTransmission();
-  wire->requestFrom(i2c_address, (uint8_t)1);
-  return wire->read();
+  int value = OV7670_cache_read(&regcache, reg);
+  if (value < 0) { // Not cached, ask the camera
+    wire->beginTransmission(i2c_address);
+    wire->write(reg);
+    wire->endTransmission();
+    wire->requestFrom(i2c_address, (uint8_t)1);
+    value = wire->read();
+    if (value >= 0) {
+      OV7670_cache_store(&regcache, reg, value);
+    }
+  }
+  return value;
 }
 
 void Adafruit_OV7670::writeRegister(uint8_t reg, uint8_t value) {
+  if (!OV7670_cache_write(&regcache, reg, value)) {
+    return; // Camera already holds this value
+  }
   wire->beginTransmission(i2c_address);
   wire->write(reg);
   wire->write(value);
-  wire->endTransmission();
+  // Cached only once the camera has ACKed it
+  OV7670_cache_written(&regcache, reg, value, wire->endTransmission() == 0);
 }
 
 OV7670_status Adafruit_OV7670::setSize(OV7670_size size, OV7670_realloc allo) {
-  uint16_t new_width = 640 >> (int)size;
-  uint16_t new_height = 480 >> (int)size;
-  uint32_t new_buffer_size = new_width * new_height * sizeof(uint16_t);
+  uint16_t width = 640 >> (int)size;
+  uint16_t height = 480 >> (int)size;
+  OV7670_status status = resize(width, height, allo);
+  if ((_width == width) && (_height == height)) { // Took effect
+    OV7670_set_size(this, size);
+  }
+  return status;
+}
+
+OV7670_status Adafruit_OV7670::setSize(uint16_t width, uint16_t height,
+                                       OV7670_realloc allo) {
+  if (!OV7670_scaled_size_valid(width, height)) {
+    return OV7670_STATUS_ERR_SIZE;
+  }
+  OV7670_status status = resize(width, height, allo);
+  if ((_width == width) && (_height == height)) { // Took effect
+    OV7670_set_scaled_size(this, width, height);
+  }
+  return status;
+}
+
+OV7670_status Adafruit_OV7670::setWindow(OV7670_size size, uint16_t x,
+                                         uint16_t y, uint16_t width,
+                                         uint16_t height,
+                                         OV7670_realloc allo) {
+  uint16_t frame_width = 640 >> (int)size;
+  uint16_t frame_height = 480 >> (int)size;
+  // Keep rectangle within frame, at least 2x1, and even width & position
+  // (RGB565 is sent in pixel pairs' worth of bytes, YUV in macropixels)
+  if (x > frame_width - 2) {
+    x = frame_width - 2;
+  }
+  if (y > frame_height - 1) {
+    y = frame_height - 1;
+  }
+  x &= ~1;
+  if (width > frame_width - x) {
+    width = frame_width - x;
+  }
+  width = (width < 2) ? 2 : (width & ~1);
+  if (height > frame_height - y) {
+    height = frame_height - y;
+  }
+  if (height < 1) {
+    height = 1;
+  }
+  OV7670_status status = resize(width, height, allo);
+  if ((_width == width) && (_height == height)) { // Took effect
+    OV7670_set_window(this, size, x, y, width, height);
+  }
+  return status;
+}
+
+// Common to setSize() and setWindow(): fit buffer(s) to the new frame
+// size per allo, then bring ring and DMA in line. Camera registers are
+// up to the caller, if _width and _height took the new values. If
+// capture's running, it's suspended (after the frame in progress) for
+// all this, so DMA never writes to a buffer being reallocated, and
+// resumed after unless the application had it suspended already.
+OV7670_status Adafruit_OV7670::resize(uint16_t new_width, uint16_t new_height,
+                                      OV7670_realloc allo) {
+  uint16_t buffer_rows = ring.strip_rows ? ring.strip_rows : new_height;
+  if (!arch_size_ok(new_width, buffer_rows)) {
+    return OV7670_STATUS_ERR_SIZE; // Keep current size & camera settings
+  }
+  uint32_t new_buffer_size = new_width * buffer_rows * pixel_bytes();
   bool ra = false;
 
   switch (allo) {
@@ -116,6 +232,11 @@ OV7670_status Adafruit_OV7670::setSize(OV7670_size size, OV7670_realloc allo) {
     break;
   }
 
+  bool running = buffer && !arch.suspended;
+  if (buffer) {
+    suspend();
+  }
+
   if (ra) { // Reallocate?
     uint16_t *new_buffer = (uint16_t *)realloc(buffer, new_buffer_size);
     if (new_buffer == NULL) { // FAIL
@@ -123,22 +244,233 @@ OV7670_status Adafruit_OV7670::setSize(OV7670_size size, OV7670_realloc allo) {
       buffer = NULL;
       // Calling code had better poll width(), height() or getBuffer() in
       // this case so it knows the camera buffer is gone, doesn't attempt
-      // to read camera data into unknown RAM.
+      // to read camera data into unknown RAM. Capture stays suspended.
       return OV7670_STATUS_ERR_MALLOC;
     }
+    buffer = new_buffer;
     buffer_size = new_buffer_size;
   }
 
   _width = new_width;
   _height = new_height;
 
-  OV7670_set_size(this, size);
+  // Extra frame buffers (if any) follow the main buffer's size. If any
+  // can't be reallocated, drop back to the single main buffer, but with
+  // the new size in effect.
+  OV7670_status status = OV7670_STATUS_OK;
+  uint16_t *bufs[OV7670_RING_MAX] = {buffer};
+  uint8_t count = ring.count;
+  for (uint8_t i = 1; i < count; i++) {
+    bufs[i] = ra ? (uint16_t *)realloc(ring.buf[i], buffer_size) : ring.buf[i];
+    if (bufs[i] == NULL) { // realloc() failed, ring.buf[i] still valid
+      for (uint8_t j = 1; j < count; j++) {
+        free((j < i) ? bufs[j] : ring.buf[j]);
+      }
+      count = 1;
+      status = OV7670_STATUS_ERR_MALLOC;
+    }
+  }
+  OV7670_disable_interrupts();
+  OV7670_ring_buffers(&ring, bufs, count);
+  ring.strip_height = _height;
+  ring.row_width = _width;
+  ring.strip_row = 0;
+  OV7670_enable_interrupts();
+  arch_update(); // DMA length (and chained buffer list, if used)
+  if (running) {
+    resume();
+  }
+
+  if (scratch_radius && (scratch_fit() != OV7670_STATUS_OK)) {
+    status = OV7670_STATUS_ERR_MALLOC; // Filters can't run at this width
+  }
+
+  return status;
+}
+
+// Grow scratch arena, if needed, to fit the current width and radius.
+// Never shrinks, so toggling between sizes doesn't churn the heap.
+OV7670_status Adafruit_OV7670::scratch_fit(void) {
+  uint32_t bytes = OV7670_scratch_bytes(_width, scratch_radius);
+  if (bytes > scratch.size) {
+    void *mem = realloc(scratch.base, bytes);
+    if (mem == NULL) { // Old arena is still valid, if too small
+      return OV7670_STATUS_ERR_MALLOC;
+    }
+    OV7670_scratch_init(&scratch, mem, bytes);
+  }
+  return OV7670_STATUS_OK;
+}
+
+OV7670_status Adafruit_OV7670::setScratch(uint8_t radius) {
+  OV7670_status status = OV7670_STATUS_OK;
+  scratch_radius = radius; // If not begun, begin() will allocate it
+  if (radius && buffer && (scratch_fit() != OV7670_STATUS_OK)) {
+    scratch_radius = 0; // Use the heap instead
+    status = OV7670_STATUS_ERR_MALLOC;
+  }
+  if (!scratch_radius) {
+    free(scratch.base);
+    OV7670_scratch_init(&scratch, NULL, 0);
+  }
+  return status;
+}
+
+OV7670_status Adafruit_OV7670::setBufferCount(uint8_t count) {
+  if (buffer == NULL) { // Not started, or lost buffer in setSize()
+    return OV7670_STATUS_ERR_MALLOC;
+  }
+  if (ring.strip_rows) { // Strip count is set in setStripMode()
+    return OV7670_STATUS_ERR_PERIPHERAL;
+  }
+  if (count < 1) {
+    count = 1;
+  } else if (count > OV7670_RING_MAX) {
+    count = OV7670_RING_MAX;
+  }
+  uint16_t *bufs[OV7670_RING_MAX] = {buffer};
+  for (uint8_t i = 1; i < count; i++) {
+    bufs[i] = (i < ring.count) ? ring.buf[i] : (uint16_t *)malloc(buffer_size);
+    if (bufs[i] == NULL) {
+      while (--i >= ring.count) {
+        free(bufs[i]); // Free any newly-allocated, keep old
+      }
+      return OV7670_STATUS_ERR_MALLOC;
+    }
+  }
+  // Wait out the frame in progress so no buffer is mid-capture, swap
+  // rings, then free any buffers no longer needed.
+  suspend();
+  uint8_t old_count = ring.count;
+  uint16_t *old_bufs[OV7670_RING_MAX];
+  memcpy(old_bufs, ring.buf, sizeof old_bufs);
+  OV7670_ring_buffers(&ring, bufs, count);
+  arch_update();
+  resume();
+  for (uint8_t i = count; i < old_count; i++) {
+    free(old_bufs[i]);
+  }
+  return OV7670_STATUS_OK;
+}
 
+OV7670_status Adafruit_OV7670::setStripMode(uint16_t rows, uint8_t count,
+                                            OV7670_strip_callback func,
+                                            void *arg) {
+  if (buffer) {
+    return OV7670_STATUS_ERR_PERIPHERAL; // Too late, already started
+  }
+  if (count < 1) {
+    count = 1;
+  } else if (count > OV7670_RING_MAX) {
+    count = OV7670_RING_MAX;
+  }
+  ring.strip_rows = rows;
+  ring.strip_callback = func;
+  ring.strip_arg = arg;
+  strip_count = count;
   return OV7670_STATUS_OK;
 }
 
+void Adafruit_OV7670::setFrameCallback(OV7670_frame_callback func,
+                                       void *arg) {
+  OV7670_disable_interrupts(); // Don't call new func with old arg
+  ring.callback = func;
+  ring.callback_arg = arg;
+  OV7670_enable_interrupts();
+}
+
+void Adafruit_OV7670::setRowCallback(uint16_t rows, OV7670_row_callback func,
+                                     void *arg) {
+  OV7670_disable_interrupts();
+  ring.row_callback = rows ? func : NULL;
+  ring.row_arg = arg;
+  ring.row_step = rows;
+  ring.row_last = 0;
+  OV7670_enable_interrupts();
+  if (buffer) {
+    // As in resize(), DMA may be reconfigured, so not mid-frame
+    bool running = !arch.suspended;
+    suspend();
+    arch_update(); // Start or stop the arch's row tracking
+    if (running) {
+      resume();
+    }
+  }
+}
+
+bool Adafruit_OV7670::waitFrame(uint32_t timeout_ms) {
+  uint32_t start = millis();
+  while (!frameAvailable()) {
+    if ((millis() - start) >= timeout_ms) {
+      return false;
+    }
+    yield();
+  }
+  frames_seen = ring.frames;
+  return true;
+}
+
+void Adafruit_OV7670::setByteOrder(OV7670_order order) {
+  if (buffer && (pixel_bytes() == 2)) { // Camera's running, not luma-only
+    OV7670_set_order(this, order);
+  }
+  OV7670_disable_interrupts();
+  ring.order = order;
+  OV7670_enable_interrupts();
+}
+
+void Adafruit_OV7670::getStats(OV7670_stats *dest) {
+  OV7670_disable_interrupts();
+  memcpy(dest, &ring.stats, sizeof(OV7670_stats));
+  OV7670_enable_interrupts();
+}
+
+void Adafruit_OV7670::resetStats(void) {
+  OV7670_disable_interrupts();
+  OV7670_stats_reset(&ring.stats);
+  OV7670_enable_interrupts();
+}
+
 void Adafruit_OV7670::Y2RGB565(void) {
-  OV7670_Y2RGB565(buffer, _width * _height);
+  if (!whole_frame()) {
+    return; // Not a whole frame, do per strip in callback instead
+  }
+  OV7670_Y2RGB565_order(buffer, _width * _height, getByteOrder());
+}
+
+void Adafruit_OV7670::YUV2RGB565(uint16_t *dest) {
+  if (!whole_frame()) {
+    return; // Not a whole frame, do per strip in callback instead
+  }
+  OV7670_YUV2RGB565(buffer, dest ? dest : buffer, _width * _height,
+                    getByteOrder());
+}
+
+uint8_t *Adafruit_OV7670::getLuma(uint8_t *dest, OV7670_scratch *spare) {
+  if ((space != OV7670_COLOR_YUV) || ring.strip_rows || !buffer) {
+    return NULL;
+  }
+  uint32_t pixels = (uint32_t)_width * _height;
+  uint8_t *plane = (uint8_t *)buffer;
+  if (pixel_bytes() == 1) { // Camera already delivered just the Y plane
+    if (dest) {
+      memcpy(dest, plane, pixels);
+      plane = dest;
+    }
+    if (spare) {
+      OV7670_scratch_init(spare, NULL, 0); // Buffer was allocated half size
+    }
+    return plane;
+  }
+  if (spare) { // In place, the back half of the buffer is now free
+    OV7670_scratch_init(spare, dest ? NULL : plane + pixels,
+                        dest ? 0 : buffer_size - pixels);
+  }
+  if (dest) {
+    plane = dest;
+  }
+  OV7670_Y_extract(buffer, plane, pixels, getByteOrder());
+  return plane;
 }
 
 // C-ACCESSIBLE FUNCTIONS --------------------------------------------------
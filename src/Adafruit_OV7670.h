@@ -82,14 +82,32 @@ public:
                          number of pixels corresponding to the 'size'
                          argument. If you later call setSize() with an image
                          size exceeding the buffer size, it will fail.
+    @param   boot        OV7670_BOOT_SAFE (default) for the original
+                         conservative startup with fixed delays (about one
+                         second), or OV7670_BOOT_FAST to wait only as long
+                         as the camera needs (polls camera ID and VSYNC).
+                         Time taken either way is available from
+                         bootTime().
     @return  Status code. OV7670_STATUS_OK on successful init.
   */
   OV7670_status begin(OV7670_colorspace colorspace = OV7670_COLOR_RGB,
                       OV7670_size size = OV7670_SIZE_DIV4, float fps = 30.0,
-                      uint32_t bufsiz = 0);
+                      uint32_t bufsiz = 0,
+                      OV7670_boot boot = OV7670_BOOT_SAFE);
 
   /*!
-    @brief   Reads value of one register from the OV7670 camera over I2C.
+    @brief   Get time taken by the last begin() call, from entry until the
+             camera is producing frames with the requested settings (the
+             next VSYNC starts the first such frame).
+    @return  Time in microseconds.
+  */
+  uint32_t bootTime(void) { return boot_us; }
+
+  /*!
+    @brief   Reads value of one register from the OV7670 camera. Registers
+             previously written or read are returned from a RAM copy
+             without I2C traffic, except for those the camera changes on
+             its own (gain, exposure, white balance, averages, IDs).
     @param   reg  Register to read, from values defined in src/arch/ov7670.h.
     @return  Integer value: 0-255 (register contents) on successful read,
              -1 on error.
@@ -98,12 +116,54 @@ public:
 
   /*!
     @brief  Writes value of one register to the OV7670 camera over I2C.
+            The write is skipped if the camera is known to already hold
+            this value.
     @param  reg    Register to read, from values defined in src/arch/ov7670.h.
     @param  value  Value to write, 0-255.
 
   */
   void writeRegister(uint8_t reg, uint8_t value);
 
+  /*!
+    @brief   Save the camera's current register settings (as configured by
+             begin() and any later calls such as setSize() or flip()) as a
+             list of register/value pairs, for a quicker restart later via
+             useProfile(). Requires no I2C traffic.
+    @param   dest  Destination array. 256 elements is always sufficient.
+    @param   max   Number of elements in dest.
+    @param   diff  If true, registers that are at their reset values are
+                   left out (smaller, but only correct if restored right
+                   after a camera reset, which begin() does).
+    @return  Number of elements used in dest, or -1 if max is too small.
+  */
+  int saveProfile(OV7670_command *dest, int max, bool diff = false) {
+    return OV7670_profile_save(&regcache, dest, max, diff);
+  }
+
+  /*!
+    @brief  Have subsequent begin() calls restore a profile from
+            saveProfile() in one burst, rather than configuring the camera
+            with the full init tables, OV7670_set_fps() and
+            OV7670_set_size(). Pass the same colorspace and size to begin()
+            as when the profile was saved (these still set up the buffer);
+            fps is ignored, the profile sets the clock.
+    @param  saved  Profile array (may be const/flash), or NULL to go back
+                   to normal startup. Must remain valid through begin().
+    @param  len    Number of elements in saved.
+  */
+  void useProfile(const OV7670_command *saved, int len) {
+    profile = saved;
+    profile_len = saved ? len : 0;
+  }
+
+  /*!
+    @brief  Discard the RAM copy of camera registers, so subsequent reads
+            and writes all go to the camera over I2C. Only needed if
+            something else (another I2C host, a power cycle outside this
+            library's control) changes camera registers behind its back.
+  */
+  void invalidateRegisters(void) { OV7670_cache_clear(&regcache); }
+
   /*!
     @brief   Get address of image buffer being used by camera.
     @return  uint16_t pointer to image data in RGB565 format.
@@ -113,9 +173,10 @@ public:
   /*!
     @brief  Pause DMA background capture (if supported by architecture)
             before capturing, to avoid tearing. Returns as soon as the
-            current frame has finished loading. If DMA background capture
-            is not supported, this function has no effect. This is NOT a
-            camera sleep function!
+            current frame has finished loading (spinning until then, so
+            call waitFrame() first to do other work meanwhile). If DMA
+            background capture is not supported, this function has no
+            effect. This is NOT a camera sleep function!
   */
   void suspend(void);
 
@@ -125,6 +186,198 @@ public:
   */
   void resume(void);
 
+  /*!
+    @brief   Set number of frame buffers for background DMA capture. With
+             2 or more, capture continues into one buffer while the
+             application works on another -- use acquireFrame() and
+             releaseFrame() instead of getBuffer(), suspend() and resume().
+             3 buffers guarantee no frame the application hasn't seen is
+             ever overwritten by capture (only replaced by a newer one).
+             Call after begin(). Extra buffers are the same size as the
+             begin() buffer.
+    @param   count  Number of buffers, 1 (default, single buffer) to
+                    OV7670_RING_MAX.
+    @return  OV7670_STATUS_OK on success, OV7670_STATUS_ERR_MALLOC if
+             buffers couldn't be allocated (prior count remains in effect).
+  */
+  OV7670_status setBufferCount(uint8_t count);
+
+  /*!
+    @brief   Take ownership of the most recently completed frame, when
+             using multiple buffers. Capture won't touch this buffer until
+             releaseFrame() or the next acquireFrame() call. No copy is
+             made.
+    @return  Pointer to frame (RGB565 or YUV, per begin()), or NULL if no
+             frame has completed since the last call.
+  */
+  uint16_t *acquireFrame(void) {
+    frames_seen = ring.frames;
+    return OV7670_ring_acquire(&ring);
+  }
+
+  /*!
+    @brief  Return frame from acquireFrame() to the capture pool.
+  */
+  void releaseFrame(void) { OV7670_ring_release(&ring); }
+
+  /*!
+    @brief   Set aside working memory for the filters that need it
+             (image_median(), image_edges(), image_box_blur(),
+             image_local_threshold(), image_convolve()), so they don't
+             malloc() and free() on every call, fragmenting the heap over
+             time. Sized for the frame width with OV7670_scratch_bytes(),
+             and grown (only) if setSize() or setWindow() make frames
+             wider. Can be called before begin(), which then allocates it.
+    @param   radius  Largest image_median() or box filter radius to allow
+                     for (1 covers 3x3 median, edges and convolution, 2 a
+                     5x5 kernel), or 0 to free the memory and go back to
+                     the heap.
+    @return  OV7670_STATUS_OK on success, OV7670_STATUS_ERR_MALLOC if the
+             memory couldn't be allocated (filters then use the heap).
+  */
+  OV7670_status setScratch(uint8_t radius = 1);
+
+  /*!
+    @brief   Get the working memory set up by setScratch(), e.g. for the
+             image_ops.h _view() functions.
+    @return  Pointer to scratch arena, or NULL if none.
+  */
+  OV7670_scratch *getScratch(void) {
+    return scratch_radius ? &scratch : NULL;
+  }
+
+  /*!
+    @brief   Capture in strips of rows rather than whole frames, for frame
+             sizes that won't fit in RAM (e.g. 640x480 RGB is 600 KB).
+             Background DMA cycles through a set of strip buffers, and each
+             strip is handed to a callback (in interrupt context) as it
+             completes, for processing or forwarding to a display or card.
+             Must be called before begin(), which then allocates the strip
+             buffers instead of a frame buffer. getBuffer() is the first
+             strip, frameAvailable() and waitFrame() still count whole
+             frames, but the image_*() functions and Y2RGB565(), which
+             work on whole frames, do nothing (use the image_ops.h
+             functions on each strip instead). acquireFrame() and
+             setBufferCount() don't apply. On SAMD51, each strip after the
+             first is started from the DMA interrupt, so that must run
+             within a row's horizontal blanking; RP2040 chains DMA for it.
+    @param   rows   Rows per strip (e.g. 8 or 16), or 0 for normal frames.
+                    Needn't divide the frame height evenly -- the last
+                    strip of a frame is just shorter.
+    @param   count  Number of strip buffers, at least 2 so one can load
+                    while the callback has the other; up to
+                    OV7670_RING_MAX. On RP2040, a power of 2 (extras are
+                    allocated but unused).
+    @param   func   Strip callback, receiving pixels, first row number in
+                    frame, number of rows and arg.
+    @param   arg    Passed through to func.
+    @return  OV7670_STATUS_OK, or OV7670_STATUS_ERR_PERIPHERAL if capture
+             is already running (call before begin()).
+  */
+  OV7670_status setStripMode(uint16_t rows, uint8_t count,
+                             OV7670_strip_callback func, void *arg = NULL);
+
+  /*!
+    @brief   Capture only the Y (brightness) byte of each YUV pixel, for
+             code that works on grayscale anyway. The camera still sends
+             both bytes; the PIO program just doesn't keep the U/V ones,
+             so begin() allocates buffers of one byte per pixel -- half
+             the RAM and half the DMA traffic. getLuma() returns the
+             plane, getBuffer() is the same memory as uint16_t*, and
+             getView(), the image_*() functions, Y2RGB565() and
+             YUV2RGB565() (which expect two bytes per pixel) do nothing.
+             Byte order doesn't apply. Must be called before begin(),
+             and only has an effect with OV7670_COLOR_YUV.
+    @param   on  true for Y-only capture, false (default) for both bytes.
+    @return  OV7670_STATUS_OK, or OV7670_STATUS_ERR_PERIPHERAL if capture
+             is already running or the architecture can't drop bytes
+             (SAMD51's PCC stores everything it latches; use getLuma() to
+             pack the Y plane after capture instead).
+  */
+  OV7670_status setLumaCapture(bool on);
+
+  /*!
+    @brief  Set a function to be called each time background DMA capture
+            completes a frame. It runs in interrupt context, so should do
+            little more than set a flag or note the buffer -- image ops
+            belong in the main loop. With a single buffer, the next frame
+            overwrites it starting at the next VSYNC.
+    @param  func  Callback, receiving the completed buffer and arg, or
+                  NULL to remove.
+    @param  arg   Passed through to func (e.g. an object pointer).
+  */
+  void setFrameCallback(OV7670_frame_callback func, void *arg = NULL);
+
+  /*!
+    @brief  Set a function to be called (in interrupt context) every so
+            many rows as background DMA loads a frame, and once more when
+            it's complete, so processing or a display push can start on
+            the top of the frame while the rest arrives. On RP2040 this
+            counts HSYNC pulses (one interrupt per row while set); on
+            SAMD51, DMA is split into transfers of this many rows, each
+            started from the DMA interrupt, which must then run within a
+            row's horizontal blanking. Not used in strip mode (the strip
+            callback is the equivalent). Setting this after begin() waits
+            for the frame in progress, and may lose the next while DMA is
+            reconfigured.
+    @param  rows  Rows between calls (e.g. 16), or 0 to remove.
+    @param  func  Callback, receiving the frame buffer being loaded, the
+                  number of rows now valid from its top, and arg.
+    @param  arg   Passed through to func.
+  */
+  void setRowCallback(uint16_t rows, OV7670_row_callback func,
+                      void *arg = NULL);
+
+  /*!
+    @brief   Poll how far background DMA has got with the current frame,
+             from the DMA channel's remaining transfer count. With a
+             single buffer, rows this far down getBuffer() are valid and
+             can be worked on while capture continues below them (with
+             more buffers, setRowCallback() says which is loading).
+    @return  Rows of the current frame loaded so far: the full height once
+             it's complete (until the next VSYNC), 0 if none is loading.
+             In strip mode, counts from the top of the frame, not strip.
+  */
+  uint16_t rowsAvailable(void);
+
+  /*!
+    @brief   Check, without waiting, whether background capture has
+             completed a frame since the last waitFrame() or
+             acquireFrame() call.
+    @return  true if a new frame is available.
+  */
+  bool frameAvailable(void) { return ring.frames != frames_seen; }
+
+  /*!
+    @brief   Wait for background capture to complete a frame, unless one
+             already has since the last waitFrame() or acquireFrame()
+             call. Unlike suspend(), this gives up after a timeout, and
+             calls yield() while waiting. With a single buffer, follow it
+             with suspend() (which will then return at once) to keep the
+             frame intact while working on it; with more, acquireFrame().
+    @param   timeout_ms  Maximum wait, in milliseconds. 0 just polls.
+    @return  true if a new frame is available, false on timeout (e.g.
+             capture suspended, or camera not running).
+  */
+  bool waitFrame(uint32_t timeout_ms);
+
+  /*!
+    @brief  Get a consistent snapshot of background capture statistics:
+            frames captured, dropped (not captured while suspended, or
+            with multiple buffers, replaced by a newer frame before
+            acquireFrame()), torn (VSYNC arrived before all pixels were
+            loaded -- usually a PCLK signal problem), DMA restarts, and
+            VSYNC interval (last, min, max) in microseconds.
+    @param  dest  Structure to receive the statistics.
+  */
+  void getStats(OV7670_stats *dest);
+
+  /*!
+    @brief  Zero background capture statistics, e.g. after a deliberate
+            mode change that would otherwise skew the interval min/max.
+  */
+  void resetStats(void);
+
   /*!
     @brief   Get image width of camera's current resolution setting.
     @return  Width in pixels.
@@ -171,10 +424,65 @@ public:
              untilized at times, but it's favorable to entirely losing the
              camera mid-run. The default request here is CHANGE in case one
              passes an improper initial value to begin().
+    @note    Capture is suspended (after the frame in progress) while the
+             buffers are resized, then resumed. Any frame from
+             acquireFrame() or pointer from getBuffer() is invalid
+             afterward, whether or not the buffer moved; get a new one.
   */
   OV7670_status setSize(OV7670_size size,
                         OV7670_realloc allo = OV7670_REALLOC_CHANGE);
 
+  /*!
+    @brief   Change camera resolution to an exact size other than the
+             OV7670_size steps, e.g. 352x288 (CIF), 176x144 (QCIF), or a
+             display's native 240x240 or 160x128, so frames need no
+             resizing or letterboxing. The camera's downsampler and
+             fractional scaler do the work; the sensor area used is
+             cropped (centered) to the requested aspect ratio so pixels
+             stay square.
+    @param   width   Width in pixels, even, up to 640.
+    @param   height  Height in pixels, up to 480.
+    @param   allo    Camera buffer reallocation behavior, as for the
+                     OV7670_size version.
+    @return  Status code as for the OV7670_size version, or
+             OV7670_STATUS_ERR_SIZE (nothing changed) if the camera can't
+             produce that size, or capture can't take it (on RP2040 with
+             luma capture and pack32, pixels per frame or strip must be a
+             multiple of 4).
+    @note    As for the OV7670_size version, frames from acquireFrame()
+             are invalid after the call.
+  */
+  OV7670_status setSize(uint16_t width, uint16_t height,
+                        OV7670_realloc allo = OV7670_REALLOC_CHANGE);
+
+  /*!
+    @brief   Capture only a rectangle (region of interest) of the frame
+             that setSize() would give. The camera's window registers are
+             set so it only sends those pixels; DMA transfers and the
+             buffer are sized to match, so e.g. a 200x60 strip of VGA needs
+             23 KB rather than 600 KB, and a fraction of the bus time.
+             width() and height() then return the rectangle's size, and
+             image ops work on it as a whole frame. setSize() returns to
+             the full frame.
+    @param   size    Scale, as for setSize(); rectangle is in pixels of
+                     this size (e.g. 0-159 across for OV7670_SIZE_DIV4).
+    @param   x       Left edge. Rounded down to even.
+    @param   y       Top edge.
+    @param   width   Width in pixels. Rounded down to even, and clipped
+                     (as is height) to stay within the frame.
+    @param   height  Height in pixels.
+    @param   allo    Camera buffer reallocation behavior, as for setSize().
+                     CHANGE shrinks the buffer to the rectangle.
+    @return  Status code, as for setSize(), or OV7670_STATUS_ERR_SIZE
+             (nothing changed) if capture can't take the rectangle's size
+             (as for the exact-size setSize()).
+    @note    As for setSize(), frames from acquireFrame() are invalid
+             after the call.
+  */
+  OV7670_status setWindow(OV7670_size size, uint16_t x, uint16_t y,
+                          uint16_t width, uint16_t height,
+                          OV7670_realloc allo = OV7670_REALLOC_CHANGE);
+
   /*!
     @brief  Capture still image to buffer. If background DMA capture is
             supported, this has no effect; latest image is always there.
@@ -230,12 +538,85 @@ public:
     OV7670_test_pattern(this, pattern);
   }
 
+  /*!
+    @brief  Set byte order of captured pixels. The camera normally sends
+            big-endian RGB565 (as SPI displays want it), which image ops
+            must byte-swap per pixel on these little-endian processors;
+            OV7670_ORDER_LITTLE has the camera swap bytes instead, so
+            pixels are native uint16_t values (e.g. for BMP files or
+            pixel math) and the image_*() functions run without swapping.
+            Each frame buffer keeps the order it was captured in; frames
+            already loading when this is called may come out mixed. Can
+            be called before begin(). This sets the camera's order; on
+            RP2040 without pack32, capture swaps each pixel's bytes again
+            on the way to memory, so getByteOrder() reports the opposite.
+    @param  order  OV7670_ORDER_BIG (default) or OV7670_ORDER_LITTLE.
+  */
+  void setByteOrder(OV7670_order order);
+
+  /*!
+    @brief   Get byte order in memory of a captured frame (or strip).
+    @param   buf  One of the library's buffers (e.g. from acquireFrame()),
+                  or NULL for getBuffer().
+    @return  OV7670_ORDER_BIG or OV7670_ORDER_LITTLE.
+  */
+  OV7670_order getByteOrder(const uint16_t *buf = NULL) {
+    return OV7670_ring_order(&ring, buf ? buf : buffer);
+  }
+
+  /*!
+    @brief   Get a view of the camera buffer for the image_ops _view()
+             functions or the image_*() overloads taking one, to work on
+             the whole frame or (with OV7670_view_crop()) a part of it in
+             place. Format and byte order are filled in. Empty (0x0) in
+             strip mode (use OV7670_view_frame() on each strip instead)
+             or with setLumaCapture().
+    @param   buf  One of the library's buffers (e.g. from acquireFrame()),
+                  or NULL for getBuffer().
+    @return  OV7670_view of the frame.
+  */
+  OV7670_view getView(uint16_t *buf = NULL) {
+    if (!buf) {
+      buf = buffer;
+    }
+    return OV7670_view_frame(space, getByteOrder(buf), buf, _width,
+                             whole_frame() ? _height : 0);
+  }
+
+  /*!
+    @brief   Get a view of a rectangle within the camera buffer, e.g. a
+             region of interest to filter without touching the rest.
+             Clipped to the frame. For YUV, x should be even.
+    @param   x       Left edge in pixels.
+    @param   y       Top edge in pixels.
+    @param   width   Width in pixels.
+    @param   height  Height in pixels.
+    @return  OV7670_view of the rectangle.
+  */
+  OV7670_view getView(uint16_t x, uint16_t y, uint16_t width,
+                      uint16_t height) {
+    OV7670_view frame = getView();
+    return OV7670_view_crop(&frame, x, y, width, height);
+  }
+
   /*!
     @brief  Produces a negative image. This is a postprocessing effect,
             not in-camera, and must be applied to frame(s) manually.
             Image in memory will be overwritten.
   */
-  void image_negative(void) { OV7670_image_negative(buffer, _width, _height); };
+  void image_negative(void) {
+    if (whole_frame()) {
+      OV7670_image_negative(buffer, _width, _height);
+    }
+  };
+
+  /*!
+    @brief  Negative of a view (e.g. from getView()), in place.
+    @param  view  Pixels to work on.
+  */
+  void image_negative(const OV7670_view &view) {
+    OV7670_image_negative_view(&view);
+  }
 
   /*!
     @brief  Decimate an image to only it's min/max values (ostensibly
@@ -250,9 +631,21 @@ public:
                        colorspace -- use 0 to 255, not 0 to 31 or 63.
   */
   void image_threshold(uint8_t threshold = 128) {
-    OV7670_image_threshold(space, buffer, _width, _height, threshold);
+    if (whole_frame()) {
+      OV7670_image_threshold_order(space, getByteOrder(), buffer, _width,
+                                   _height, threshold);
+    }
   };
 
+  /*!
+    @brief  Threshold a view (e.g. from getView()), in place.
+    @param  view       Pixels to work on.
+    @param  threshold  Threshold level, 0-255, as above.
+  */
+  void image_threshold(const OV7670_view &view, uint8_t threshold = 128) {
+    OV7670_image_threshold_view(&view, threshold);
+  }
+
   /*!
     @brief  Decimate an image to a limited number of brightness levels or
             steps. This is a postprocessing effect, not in-camera, and must
@@ -262,9 +655,21 @@ public:
                     colorspace, 2 to 255 for YUV.
   */
   void image_posterize(uint8_t levels = 4) {
-    OV7670_image_posterize(space, buffer, _width, _height, levels);
+    if (whole_frame()) {
+      OV7670_image_posterize_order(space, getByteOrder(), buffer, _width,
+                                   _height, levels);
+    }
   };
 
+  /*!
+    @brief  Posterize a view (e.g. from getView()), in place.
+    @param  view    Pixels to work on.
+    @param  levels  Number of brightness levels, as above.
+  */
+  void image_posterize(const OV7670_view &view, uint8_t levels = 4) {
+    OV7670_image_posterize_view(&view, levels);
+  }
+
   /*!
     @brief  Mosaic or "shower door effect," downsamples an image into
             rectangular tiles, each tile's color being the average of all
@@ -274,60 +679,303 @@ public:
             image size does not divide equally by tile size, fractional
             tiles will always be along the right and/or bottom edge(s);
             top left corner is always a full tile.
-            YUV colorspace is not currently supported.
+            In YUV colorspace, only brightness (Y) is tiled unless chroma
+            is set.
     @param  tile_width   Tile width in pixels (1 to 255)
     @param  tile_height  Tile height in pixels (1 to 255)
+    @param  chroma       YUV only: tile U and V too (at half horizontal
+                         resolution, as stored).
   */
-  void image_mosaic(uint8_t tile_width = 8, uint8_t tile_height = 8) {
-    OV7670_image_mosaic(space, buffer, _width, _height, tile_width,
-                        tile_height);
+  void image_mosaic(uint8_t tile_width = 8, uint8_t tile_height = 8,
+                    bool chroma = false) {
+    if (whole_frame()) {
+      OV7670_view view = getView();
+      OV7670_image_mosaic_yuv(&view, tile_width, tile_height, chroma);
+    }
   };
 
   /*!
-    @brief  3x3 pixel median filter, reduces visual noise in image.
-            This is a postprocessing effect, not in-camera, and must be
-            applied to frame(s) manually. Image in memory will be
-            overwritten. YUV colorspace is not currently supported.
+    @brief  Mosaic a view (e.g. from getView()), in place. Tiles start
+            at the view's top left corner.
+    @param  view         Pixels to work on.
+    @param  tile_width   Tile width in pixels (1 to 255)
+    @param  tile_height  Tile height in pixels (1 to 255)
+    @param  chroma       YUV only: tile U and V too.
+  */
+  void image_mosaic(const OV7670_view &view, uint8_t tile_width = 8,
+                    uint8_t tile_height = 8, bool chroma = false) {
+    OV7670_image_mosaic_yuv(&view, tile_width, tile_height, chroma);
+  }
+
+  /*!
+    @brief   Pixel median filter, reduces visual noise in image.
+             This is a postprocessing effect, not in-camera, and must be
+             applied to frame(s) manually. Image in memory will be
+             overwritten. In YUV colorspace, only brightness (Y) is
+             filtered unless chroma is set; this is several times faster
+             than RGB. Working memory comes from setScratch() if used,
+             else the heap.
+    @param   radius  1 (default) for a 3x3 median, 2 for 5x5, 3 for 7x7,
+                     up to 7. Larger removes bigger specks, but is slower
+                     and softens the image more.
+    @param   chroma  YUV only: filter U and V too (at half horizontal
+                     resolution, as stored).
+    @return  OV7670_STATUS_OK, or OV7670_STATUS_ERR_MALLOC if working
+             memory wasn't available (image is then unchanged).
   */
-  void image_median(void) {
-    OV7670_image_median(space, buffer, _width, _height);
+  OV7670_status image_median(uint8_t radius = 1, bool chroma = false) {
+    if (!whole_frame()) {
+      return OV7670_STATUS_OK;
+    }
+    OV7670_view view = getView();
+    return OV7670_image_median_yuv(&view, radius, chroma, getScratch());
   };
 
   /*!
-    @brief  Edge detection filter.
-            This is a postprocessing effect, not in-camera, and must be
-            applied to frame(s) manually. Image in memory will be
-            overwritten. YUV colorspace is not currently supported.
-    @param  sensitivity  Smaller value = more sensitive to edge changes.
+    @brief   Median of a view (e.g. from getView()), in place. Pixels
+             outside the view aren't read; its edge pixels are repeated.
+    @param   view    Pixels to work on.
+    @param   radius  1 (default) for 3x3, 2 for 5x5, etc., as above.
+    @param   chroma  YUV only: filter U and V too.
+    @return  OV7670_STATUS_OK or OV7670_STATUS_ERR_MALLOC, as above.
   */
-  void image_edges(uint8_t sensitivity = 7) {
-    OV7670_image_edges(space, buffer, _width, _height, sensitivity);
+  OV7670_status image_median(const OV7670_view &view, uint8_t radius = 1,
+                             bool chroma = false) {
+    return OV7670_image_median_yuv(&view, radius, chroma, getScratch());
+  }
+
+  /*!
+    @brief   Edge detection filter.
+             This is a postprocessing effect, not in-camera, and must be
+             applied to frame(s) manually. Image in memory will be
+             overwritten. In YUV colorspace, only brightness (Y) is
+             filtered unless chroma is set. Working memory as for
+             image_median().
+    @param   sensitivity  Smaller value = more sensitive to edge changes.
+    @param   chroma       YUV only: filter U and V too.
+    @return  OV7670_STATUS_OK or OV7670_STATUS_ERR_MALLOC.
+  */
+  OV7670_status image_edges(uint8_t sensitivity = 7, bool chroma = false) {
+    if (!whole_frame()) {
+      return OV7670_STATUS_OK;
+    }
+    OV7670_view view = getView();
+    return OV7670_image_edges_yuv(&view, sensitivity, chroma, getScratch());
   };
 
+  /*!
+    @brief   Edge detection on a view (e.g. from getView()), in place.
+    @param   view         Pixels to work on.
+    @param   sensitivity  Smaller value = more sensitive to edge changes.
+    @param   chroma       YUV only: filter U and V too.
+    @return  OV7670_STATUS_OK or OV7670_STATUS_ERR_MALLOC.
+  */
+  OV7670_status image_edges(const OV7670_view &view, uint8_t sensitivity = 7,
+                            bool chroma = false) {
+    return OV7670_image_edges_yuv(&view, sensitivity, chroma, getScratch());
+  }
+
+  /*!
+    @brief   Box blur: each pixel becomes the average of the square around
+             it, at the same cost per pixel for any size (see
+             OV7670_image_box_blur_view()). In YUV colorspace, only
+             brightness (Y) is blurred. Working memory as for
+             image_median().
+    @param   radius  1 (default) for 3x3, 2 for 5x5, etc., up to 7.
+    @return  OV7670_STATUS_OK or OV7670_STATUS_ERR_MALLOC.
+  */
+  OV7670_status image_box_blur(uint8_t radius = 1) {
+    if (!whole_frame()) {
+      return OV7670_STATUS_OK;
+    }
+    OV7670_view view = getView();
+    return OV7670_image_box_blur_view(&view, radius, getScratch());
+  }
+
+  /*!
+    @brief   Box blur of a view (e.g. from getView()), in place.
+    @param   view    Pixels to work on.
+    @param   radius  1 (default) for 3x3, 2 for 5x5, etc., up to 7.
+    @return  OV7670_STATUS_OK or OV7670_STATUS_ERR_MALLOC.
+  */
+  OV7670_status image_box_blur(const OV7670_view &view, uint8_t radius = 1) {
+    return OV7670_image_box_blur_view(&view, radius, getScratch());
+  }
+
+  /*!
+    @brief   Adaptive threshold: pixels darker than the average of the
+             square around them by more than bias go to 0, the rest to
+             full brightness, so unevenly lit scenes (e.g. a page or
+             markers) still come out clean where image_threshold() would
+             lose half of them. In YUV colorspace, only brightness (Y).
+             Working memory as for image_median() (so with setScratch(),
+             a radius of 7 for the default).
+    @param   radius  Half-size of the square, 1 to 7 (default 7, 15x15).
+    @param   bias    How much darker than average (0-255) a pixel must be
+                     to go to 0. Default 10.
+    @return  OV7670_STATUS_OK or OV7670_STATUS_ERR_MALLOC.
+  */
+  OV7670_status image_local_threshold(uint8_t radius = 7, uint8_t bias = 10) {
+    if (!whole_frame()) {
+      return OV7670_STATUS_OK;
+    }
+    OV7670_view view = getView();
+    return OV7670_image_local_threshold_view(&view, radius, bias,
+                                             getScratch());
+  }
+
+  /*!
+    @brief   Adaptive threshold of a view (e.g. from getView()), in place.
+    @param   view    Pixels to work on.
+    @param   radius  Half-size of the square, 1 to 7 (default 7).
+    @param   bias    0-255, as above (default 10).
+    @return  OV7670_STATUS_OK or OV7670_STATUS_ERR_MALLOC.
+  */
+  OV7670_status image_local_threshold(const OV7670_view &view,
+                                      uint8_t radius = 7, uint8_t bias = 10) {
+    return OV7670_image_local_threshold_view(&view, radius, bias,
+                                             getScratch());
+  }
+
+  /*!
+    @brief   Convolve the image with a 3x3 or 5x5 integer kernel (see
+             OV7670_kernel in image_ops.h), e.g. from
+             OV7670_kernel_preset(). In YUV colorspace, only brightness
+             (Y) is affected. Working memory as for image_median(), with
+             setScratch() radius 2 for 5x5 kernels.
+    @param   kernel  Weights, scaling and mode.
+    @return  OV7670_STATUS_OK or OV7670_STATUS_ERR_MALLOC.
+  */
+  OV7670_status image_convolve(const OV7670_kernel &kernel) {
+    if (!whole_frame()) {
+      return OV7670_STATUS_OK;
+    }
+    OV7670_view view = getView();
+    return OV7670_image_convolve_view(&view, &kernel, getScratch());
+  }
+
+  /*!
+    @brief   Convolve the image with one of the stock kernels (Gaussian
+             blur, sharpen, unsharp mask, emboss, Sobel or Scharr edges).
+    @param   type  Which kernel, e.g. OV7670_KERNEL_GAUSSIAN3.
+    @return  OV7670_STATUS_OK or OV7670_STATUS_ERR_MALLOC.
+  */
+  OV7670_status image_convolve(OV7670_kernel_type type) {
+    OV7670_kernel kernel = OV7670_kernel_preset(type);
+    return image_convolve(kernel);
+  }
+
+  /*!
+    @brief   Convolve a view (e.g. from getView()) with a kernel, in place.
+    @param   view    Pixels to work on.
+    @param   kernel  Weights, scaling and mode.
+    @return  OV7670_STATUS_OK or OV7670_STATUS_ERR_MALLOC.
+  */
+  OV7670_status image_convolve(const OV7670_view &view,
+                               const OV7670_kernel &kernel) {
+    return OV7670_image_convolve_view(&view, &kernel, getScratch());
+  }
+
+  /*!
+    @brief  Run a chain of point ops (see OV7670_pipeline in image_ops.h)
+            on the image in a single pass. Tables are rebuilt first if the
+            pipeline's steps changed since last time.
+    @param  pipeline  Pipeline set up with OV7670_pipeline_init() and
+                      OV7670_pipeline_add().
+  */
+  void image_pipeline(OV7670_pipeline &pipeline) {
+    if (whole_frame()) {
+      OV7670_view view = getView();
+      OV7670_pipeline_apply(&pipeline, &view);
+    }
+  }
+
+  /*!
+    @brief  Run a chain of point ops on a view (e.g. from getView()).
+    @param  view      Pixels to work on.
+    @param  pipeline  Pipeline set up with OV7670_pipeline_init() and
+                      OV7670_pipeline_add().
+  */
+  void image_pipeline(const OV7670_view &view, OV7670_pipeline &pipeline) {
+    OV7670_pipeline_apply(&pipeline, &view);
+  }
+
   /*!
     @brief  Convert Y (brightness) component YUV image in RAM to RGB565
-            big-endian format for preview on TFT display. Camera buffer is
+            for preview on TFT display, in the buffer's byte order (see
+            setByteOrder()). Camera buffer is
             overwritten in-place, Y is truncated and UV elements are lost.
             No practical use outside TFT preview. If you need actual
-            grayscale 0-255 data, just access the low byte of each 16-bit
-            YUV pixel.
+            grayscale 0-255 data, use getLuma().
   */
   void Y2RGB565(void);
 
+  /*!
+    @brief  Convert YUV image in RAM to full-color RGB565 (BT.601, fixed
+            point), in the buffer's byte order, e.g. to preview frames
+            captured as YUV for analysis without switching the camera to
+            RGB.
+    @param  dest  Buffer of at least width * height uint16_t's for the
+                  result, or NULL (default) to convert the camera buffer
+                  in place.
+  */
+  void YUV2RGB565(uint16_t *dest = NULL);
+
+  /*!
+    @brief   Get the Y (brightness) plane of a YUV frame as one byte per
+             pixel, packed rows of width bytes, e.g. for grayscale
+             analysis or to keep a frame in half the memory. Unless dest
+             is given, the camera buffer is packed in place (call
+             suspend() first so DMA doesn't overwrite it), and its back
+             half is free until capture resumes. With setLumaCapture()
+             the camera buffer already is the plane, and is returned (or
+             copied to dest) as is.
+    @param   dest   Buffer of at least width * height bytes for the plane,
+                    or NULL (default) to pack it into the camera buffer.
+    @param   spare  If non-NULL, receives the freed back half of the
+                    camera buffer as an OV7670_scratch arena (e.g. for
+                    filters on the plane), or an empty one if nothing was
+                    freed.
+    @return  Pointer to the Y plane, or NULL if not YUV, in strip mode, or
+             no buffer.
+  */
+  uint8_t *getLuma(uint8_t *dest = NULL, OV7670_scratch *spare = NULL);
+
 private:
   OV7670_status arch_begin(OV7670_colorspace colorspace, OV7670_size size,
-                           float fps);
-  TwoWire *wire;             ///< I2C interface
-  uint16_t *buffer;          ///< Camera buffer allocated by lib
-  uint32_t buffer_size;      ///< Size of camera buffer, in bytes
-  OV7670_pins pins;          ///< Camera physical connections
-  OV7670_arch arch;          ///< Architecture-specific peripheral info
-  uint16_t _width;           ///< Current settings width in pixels
-  uint16_t _height;          ///< Current settings height in pixels
-  OV7670_colorspace space;   ///< RGB or YUV colorspace
-  const uint8_t i2c_address; ///< I2C address
-  const bool arch_defaults;  ///< If set, ignore arch struct, use defaults
-  camera_t camera_type;      ///< Camera model
+                           float fps, OV7670_boot boot);
+  void arch_update(void);
+  bool arch_size_ok(uint16_t width, uint16_t rows) const;
+  OV7670_status resize(uint16_t new_width, uint16_t new_height,
+                       OV7670_realloc allo);
+  OV7670_status scratch_fit(void);
+  uint8_t pixel_bytes(void) const { // Bytes per pixel in camera buffers
+    return (luma && (space == OV7670_COLOR_YUV)) ? 1 : 2;
+  }
+  bool whole_frame(void) const { // Buffer is a frame the image ops handle
+    return !ring.strip_rows && (pixel_bytes() == 2);
+  }
+  TwoWire *wire;                 ///< I2C interface
+  uint16_t *buffer;              ///< Camera buffer allocated by lib
+  uint32_t buffer_size;          ///< Size of camera buffer, in bytes
+  OV7670_pins pins;              ///< Camera physical connections
+  OV7670_arch arch;              ///< Architecture-specific peripheral info
+  OV7670_regcache regcache;      ///< Shadow copy of camera registers
+  OV7670_ring ring;              ///< Frame buffers for DMA capture
+  uint16_t _width;               ///< Current settings width in pixels
+  uint16_t _height;              ///< Current settings height in pixels
+  uint32_t boot_us;              ///< Duration of last begin(), microseconds
+  const OV7670_command *profile; ///< Profile for begin(), if any
+  uint32_t frames_seen;          ///< ring.frames at last wait/acquire
+  uint8_t strip_count;           ///< Strip buffers for begin() to allocate
+  uint8_t scratch_radius;        ///< Median radius scratch is for, 0 = none
+  OV7670_scratch scratch;        ///< Filter working memory, if any
+  bool luma;                     ///< setLumaCapture() setting
+  uint16_t profile_len;          ///< Number of commands in profile
+  OV7670_colorspace space;       ///< RGB or YUV colorspace
+  const uint8_t i2c_address;     ///< I2C address
+  const bool arch_defaults;      ///< If set, ignore arch struct, use defaults
+  camera_t camera_type;          ///< Camera model
 };
 
 // C-ACCESSIBLE FUNCTIONS --------------------------------------------------
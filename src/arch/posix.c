@@ -0,0 +1,489 @@
+// SPDX-FileCopyrightText: 2020 P Burgess for Adafruit Industries
+//
+// SPDX-License-Identifier: MIT
+
+// This is the desktop (Linux, macOS) "architecture" for OV7670 code. There
+// is no camera or peripheral to configure. Instead, a simulated camera is
+// implemented here: a 256-byte register file that reacts to the registers
+// governing reset, output format, frame size and clocking, and a frame
+// generator that renders a test pattern or image file at the size and
+// timing those registers imply. This lets the device-agnostic parts
+// (ov7670.c, image_ops.c) be built, timed and debugged on a desktop
+// machine. It also stands in for the platform layer (which on Arduino is
+// Adafruit_OV7670.cpp), providing the print and register functions that
+// ov7670.c requires.
+//
+// The simulation is behavioral, not cycle-accurate, and makes a few
+// simplifications worth knowing about:
+// - Frame timing is 784 x 510 pixel clocks (2 PCLKs per pixel), the same
+//   VGA timing that OV7670_set_fps() assumes. PCLK is XCLK times the DBLV
+//   PLL ratio divided by CLKRC. Night mode and dummy lines aren't modeled.
+// - The sensor's active area is taken to be the window OV7670_set_size()
+//   programs at VGA size. Sub-VGA windows on real hardware are nudged a
+//   few pixels to compensate for downsampler pipeline delay, this isn't
+//   modeled, so simulated frames at those sizes are shifted very slightly.
+// - Downsampling and scaling use the nearest scene pixel, no averaging.
+// - DCW and scaler output is clocked by a divided PCLK (COM14) and DSP
+//   clock (SCALING_PCLK_DIV). HREF lasts as long at any divider, so a
+//   line has room for the window width divided by the slower of those;
+//   pixels beyond that are lost, dropped evenly across the line. With
+//   COM14 DCWEN clear, neither DCW nor scaling takes effect. Dividing
+//   less than the output allows isn't an error here (on hardware the
+//   spare PCLKs are outside HREF), but OV7670_sim_pclk_hz() shows it.
+// - COM7 preset sizes (QVGA, CIF, QCIF) override the window registers,
+//   unless COM14 enables manual scaling.
+
+#if !defined(ARDUINO) && (defined(__linux__) || defined(__APPLE__))
+#define _POSIX_C_SOURCE 199309L // For nanosleep(), must precede #includes
+#include "ov7670.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Scene is rendered over this many pixels of sensor. HSTART/VSTART values
+// of SIM_H0/SIM_V0 map to its top-left corner; see notes above.
+#define SIM_WIDTH 640
+#define SIM_HEIGHT 480
+#define SIM_H0 162
+#define SIM_V0 9
+#define SIM_LINE_PCLKS (784 * 2) // PCLKs per line, incl. horizontal blank
+#define SIM_FRAME_LINES 510      // Lines per frame, incl. vertical blank
+#define SIM_I2C_HZ 100000        // Same bus speed as Adafruit_OV7670.cpp
+#define SIM_IMAGE_MAX 8192       // Largest scene image width or height
+
+// TIME -----------------------------------------------------------------
+
+static uint64_t sim_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void sim_sleep_until(uint64_t when_ns) {
+  uint64_t now;
+  while ((now = sim_now_ns()) < when_ns) {
+    uint64_t ns = when_ns - now;
+    struct timespec ts = {ns / 1000000000, ns % 1000000000};
+    nanosleep(&ts, NULL);
+  }
+}
+
+// Sensor PCLK, before any DCW & scaling divider: XCLK times the DBLV PLL
+// ratio, divided per CLKRC. Frame timing follows this one.
+static uint64_t sim_sensor_pclk_hz(OV7670_arch *arch) {
+  static const uint8_t pll_ratio[] = {1, 4, 6, 8}; // DBLV[7:6]
+  uint8_t clkrc = arch->reg[OV7670_REG_CLKRC];
+  uint32_t div = (clkrc & OV7670_CLK_EXT) ? 1 : (clkrc & OV7670_CLK_SCALE) + 1;
+  return (uint64_t)OV7670_XCLK_HZ * pll_ratio[arch->reg[OV7670_REG_DBLV] >> 6] /
+         div;
+}
+
+uint64_t OV7670_sim_frame_ns(OV7670_arch *arch) {
+  return (uint64_t)SIM_LINE_PCLKS * SIM_FRAME_LINES * 1000000000 /
+         sim_sensor_pclk_hz(arch);
+}
+
+// Output PCLK divider as a power of 2 (0-4): COM14[2:0] if COM14 DCWEN is
+// set, else none. -1 for dividers the datasheet doesn't allow (over 16).
+static int sim_pclk_shift(const uint8_t *reg) {
+  if (!(reg[OV7670_REG_COM14] & OV7670_COM14_DCWEN)) {
+    return 0;
+  }
+  int shift = reg[OV7670_REG_COM14] & OV7670_COM14_PCLK_MASK;
+  return (shift <= 4) ? shift : -1;
+}
+
+// Same for the DSP scaler's clock: SCALING_PCLK_DIV[2:0], used only if
+// COM14 enables manual scaling and the bypass bit is clear.
+static int sim_dsp_shift(const uint8_t *reg) {
+  uint8_t div = reg[OV7670_REG_SCALING_PCLK_DIV];
+  if (!(reg[OV7670_REG_COM14] & OV7670_COM14_MANUAL) ||
+      (div & OV7670_PCLK_DIV_BYPASS)) {
+    return 0;
+  }
+  int shift = div & OV7670_PCLK_DIV_MASK;
+  return (shift <= 4) ? shift : -1;
+}
+
+uint32_t OV7670_sim_pclk_hz(OV7670_arch *arch, uint8_t *div) {
+  int shift = sim_pclk_shift(arch->reg);
+  if (div) {
+    *div = 1 << ((shift >= 0) ? shift : 0);
+  }
+  return (shift >= 0) ? sim_sensor_pclk_hz(arch) >> shift : 0;
+}
+
+// Clock or PLL changed, or camera reset: frame timing starts over from
+// here, with frame numbering continuing where it left off.
+static void sim_retime(OV7670_arch *arch) {
+  uint64_t now = sim_now_ns();
+  if (arch->epoch_ns) {
+    arch->epoch_frame += (now - arch->epoch_ns) / OV7670_sim_frame_ns(arch);
+  }
+  arch->epoch_ns = now;
+}
+
+// Power-on register values are the datasheet defaults that ov7670.c
+// knows of, anything else resets to 0.
+static void sim_reset(OV7670_arch *arch) {
+  for (int i = 0; i < 256; i++) {
+    int value = OV7670_reset_default(i);
+    arch->reg[i] = (value >= 0) ? value : 0;
+  }
+  sim_retime(arch);
+}
+
+// FRAME GEOMETRY --------------------------------------------------------
+
+// Get sensor window (relative to SIM_H0, SIM_V0) and output frame size.
+static void sim_geometry(OV7670_arch *arch, int *x0, int *y0, int *win_w,
+                         int *win_h, uint16_t *width, uint16_t *height) {
+  uint8_t *reg = arch->reg;
+  int hstart = (reg[OV7670_REG_HSTART] << 3) | (reg[OV7670_REG_HREF] & 7);
+  int hstop = (reg[OV7670_REG_HSTOP] << 3) | ((reg[OV7670_REG_HREF] >> 3) & 7);
+  int vstart = (reg[OV7670_REG_VSTART] << 2) | (reg[OV7670_REG_VREF] & 3);
+  int vstop = (reg[OV7670_REG_VSTOP] << 2) | ((reg[OV7670_REG_VREF] >> 2) & 3);
+  *x0 = hstart - SIM_H0;
+  *y0 = vstart - SIM_V0;
+  *win_w = (hstop - hstart + 784) % 784; // HSTOP may wrap around
+  *win_h = (vstop > vstart) ? vstop - vstart : 0;
+  if (*win_w > SIM_WIDTH) {
+    *win_w = SIM_WIDTH;
+  }
+  if (*win_h > SIM_HEIGHT) {
+    *win_h = SIM_HEIGHT;
+  }
+
+  int pclk = sim_pclk_shift(reg), dsp = sim_dsp_shift(reg);
+  if ((pclk < 0) || (dsp < 0)) { // No usable output at all
+    *width = *height = 0;
+    return;
+  }
+
+  switch ((reg[OV7670_REG_COM14] & OV7670_COM14_MANUAL)
+              ? 0
+              : reg[OV7670_REG_COM7] & OV7670_COM7_SIZE_MASK) {
+  case OV7670_COM7_SIZE_QVGA:
+    *width = 320, *height = 240;
+    return;
+  case OV7670_COM7_SIZE_CIF:
+    *width = 352, *height = 288;
+    return;
+  case OV7670_COM7_SIZE_QCIF:
+    *width = 176, *height = 144;
+    return;
+  }
+
+  int w = *win_w, h = *win_h;
+  bool dsp_clock = reg[OV7670_REG_COM14] & OV7670_COM14_DCWEN;
+  if (dsp_clock && (reg[OV7670_REG_COM3] & OV7670_COM3_DCWEN)) { // 1,2,4,8
+    uint8_t dcw = reg[OV7670_REG_SCALING_DCWCTR];
+    w >>= dcw & 3;
+    h >>= (dcw >> 4) & 3;
+  }
+  if (dsp_clock && (reg[OV7670_REG_COM3] & OV7670_COM3_SCALEEN)) { // 0x20/n
+    uint8_t xsc = reg[OV7670_REG_SCALING_XSC] & 0x7F;
+    uint8_t ysc = reg[OV7670_REG_SCALING_YSC] & 0x7F;
+    w = xsc ? w * 0x20 / xsc : w;
+    h = ysc ? h * 0x20 / ysc : h;
+  }
+  // 2 PCLKs per pixel, HREF the same length at any divider
+  int room = *win_w >> ((pclk > dsp) ? pclk : dsp);
+  *width = (w < room) ? w : room;
+  *height = h;
+}
+
+void OV7670_sim_frame_size(OV7670_arch *arch, uint16_t *width,
+                           uint16_t *height) {
+  int x0, y0, win_w, win_h;
+  sim_geometry(arch, &x0, &y0, &win_w, &win_h, width, height);
+}
+
+void OV7670_sim_window(OV7670_arch *arch, uint16_t *width, uint16_t *height) {
+  int x0, y0, win_w, win_h;
+  uint16_t out_w, out_h;
+  sim_geometry(arch, &x0, &y0, &win_w, &win_h, &out_w, &out_h);
+  *width = win_w;
+  *height = win_h;
+}
+
+// SCENE RENDERING -------------------------------------------------------
+
+// Scene color at sensor pixel (x,y), 0-255 per channel
+static void sim_scene(OV7670_arch *arch, int x, int y, uint32_t *seed,
+                      uint8_t rgb[3]) {
+  switch (arch->source) {
+  default:
+  case OV7670_SIM_COLOR_BARS: {
+    uint8_t bar = 7 - x * 8 / SIM_WIDTH; // White at left, black at right
+    rgb[0] = (bar & 2) ? 255 : 0;
+    rgb[1] = (bar & 4) ? 255 : 0;
+    rgb[2] = (bar & 1) ? 255 : 0;
+    break;
+  }
+  case OV7670_SIM_GRADIENT:
+    rgb[0] = x * 255 / (SIM_WIDTH - 1);
+    rgb[1] = y * 255 / (SIM_HEIGHT - 1);
+    rgb[2] = 255 - (rgb[0] + rgb[1]) / 2;
+    break;
+  case OV7670_SIM_CHECKERBOARD:
+    rgb[0] = rgb[1] = rgb[2] = ((x ^ y) & 32) ? 255 : 0;
+    break;
+  case OV7670_SIM_NOISE:
+    *seed = *seed * 1103515245 + 12345;
+    rgb[0] = *seed >> 24;
+    rgb[1] = *seed >> 16;
+    rgb[2] = *seed >> 8;
+    break;
+  case OV7670_SIM_IMAGE: {
+    uint32_t iy = y * arch->image_height / SIM_HEIGHT;
+    uint32_t ix = x * arch->image_width / SIM_WIDTH;
+    const uint8_t *p = &arch->image[(iy * arch->image_width + ix) * 3];
+    rgb[0] = p[0];
+    rgb[1] = p[1];
+    rgb[2] = p[2];
+    break;
+  }
+  }
+}
+
+// Camera test pattern at output pixel (x,y) of a width x height frame
+static void sim_test_pattern(uint8_t pattern, int x, int y, uint16_t width,
+                             uint16_t height, uint8_t rgb[3]) {
+  if (pattern == OV7670_TEST_PATTERN_SHIFTING_1) {
+    rgb[0] = rgb[1] = rgb[2] = 1 << (x & 7);
+  } else {
+    uint8_t bar = 7 - x * 8 / width;
+    uint8_t fade = (pattern == OV7670_TEST_PATTERN_COLOR_BAR_FADE)
+                       ? y * 255 / height // Fade to white toward bottom
+                       : 0;
+    rgb[0] = (bar & 2) ? 255 : fade;
+    rgb[1] = (bar & 4) ? 255 : fade;
+    rgb[2] = (bar & 1) ? 255 : fade;
+  }
+}
+
+// Render frame from sensor to dest, truncated to max_pixels, in the
+// output format selected by COM7 (and COM3 byte swap).
+static void sim_render(OV7670_arch *arch, uint16_t *dest, uint32_t max_pixels,
+                       uint32_t frame) {
+  uint8_t *reg = arch->reg;
+  int x0, y0, win_w, win_h;
+  uint16_t width, height;
+  sim_geometry(arch, &x0, &y0, &win_w, &win_h, &width, &height);
+  uint32_t num_pixels = width * height;
+  if (num_pixels > max_pixels) {
+    num_pixels = max_pixels;
+  }
+  if ((arch->source == OV7670_SIM_IMAGE) && !arch->image) {
+    arch->source = OV7670_SIM_COLOR_BARS;
+  }
+
+  uint8_t pattern = (reg[OV7670_REG_SCALING_XSC] >> 7) |
+                    ((reg[OV7670_REG_SCALING_YSC] >> 6) & 2);
+  if (reg[OV7670_REG_COM7] & OV7670_COM7_COLORBAR) {
+    pattern = OV7670_TEST_PATTERN_COLOR_BAR;
+  }
+  bool rgb565 = (reg[OV7670_REG_COM7] & OV7670_COM7_PIXEL_MASK) ==
+                OV7670_COM7_RGB;
+  bool swap = reg[OV7670_REG_COM3] & OV7670_COM3_SWAP;
+  bool mirror = reg[OV7670_REG_MVFP] & OV7670_MVFP_MIRROR;
+  bool vflip = reg[OV7670_REG_MVFP] & OV7670_MVFP_VFLIP;
+  uint32_t seed = frame * 2654435761u;
+  uint8_t *out = (uint8_t *)dest;
+
+  for (uint32_t i = 0; i < num_pixels; i++) {
+    int x = i % width, y = i / width;
+    uint8_t rgb[3];
+    if (pattern) {
+      sim_test_pattern(pattern, x, y, width, height, rgb);
+    } else {
+      // Nearest sensor pixel to center of output pixel, clipped to sensor
+      int sx = x0 + (2 * x + 1) * win_w / (2 * width);
+      int sy = y0 + (2 * y + 1) * win_h / (2 * height);
+      sx = (sx < 0) ? 0 : (sx >= SIM_WIDTH) ? SIM_WIDTH - 1 : sx;
+      sy = (sy < 0) ? 0 : (sy >= SIM_HEIGHT) ? SIM_HEIGHT - 1 : sy;
+      sim_scene(arch, mirror ? SIM_WIDTH - 1 - sx : sx,
+                vflip ? SIM_HEIGHT - 1 - sy : sy, &seed, rgb);
+    }
+    uint8_t hi, lo;
+    if (rgb565) { // RGB565, big-endian
+      uint16_t c =
+          ((rgb[0] & 0xF8) << 8) | ((rgb[1] & 0xFC) << 3) | (rgb[2] >> 3);
+      hi = c >> 8;
+      lo = c & 0xFF;
+    } else { // YUV422 (YUYV order), full-range BT.601
+      hi = (77 * rgb[0] + 150 * rgb[1] + 29 * rgb[2]) >> 8; // Y
+      int c = (x & 1) ? (128 * rgb[0] - 107 * rgb[1] - 21 * rgb[2]) // V
+                      : (-43 * rgb[0] - 85 * rgb[1] + 128 * rgb[2]); // U
+      lo = (c >> 8) + 128;
+    }
+    // First byte out of camera is first byte in memory
+    out[i * 2] = swap ? lo : hi;
+    out[i * 2 + 1] = swap ? hi : lo;
+  }
+}
+
+// Each supported architecture MUST provide this function with this name,
+// arguments and return type. Starting XCLK powers up the simulated camera
+// with its registers at default values.
+OV7670_status OV7670_arch_begin(OV7670_host *host) {
+  OV7670_cache_clear(&host->arch->cache);
+  host->arch->epoch_ns = 0;
+  host->arch->epoch_frame = host->arch->frame = 0;
+  sim_reset(host->arch);
+  return OV7670_STATUS_OK;
+}
+
+// VSYNC pulse is the first 3 lines of each frame (per datasheet VGA
+// timing), active high unless COM10 says otherwise.
+bool OV7670_arch_vsync(OV7670_host *host) {
+  uint64_t period = OV7670_sim_frame_ns(host->arch);
+  uint64_t into_frame = (sim_now_ns() - host->arch->epoch_ns) % period;
+  bool pulse = into_frame < period * 3 / SIM_FRAME_LINES;
+  return pulse ^ !!(host->arch->reg[OV7670_REG_COM10] & OV7670_COM10_VS_NEG);
+}
+
+uint32_t OV7670_capture(OV7670_arch *arch, uint16_t *dest, uint16_t width,
+                        uint16_t height) {
+  // Like the hardware capture functions, wait for the NEXT frame to start
+  // (a frame already in progress is missed), then for its last active
+  // line (VSTOP) to be output.
+  uint64_t period = OV7670_sim_frame_ns(arch);
+  uint64_t now = sim_now_ns();
+  uint32_t frame = arch->epoch_frame + (now - arch->epoch_ns) / period + 1;
+  if (frame <= arch->frame) {
+    frame = arch->frame + 1; // Never deliver the same frame twice
+  }
+  int vstop = (arch->reg[OV7670_REG_VSTOP] << 2) |
+              ((arch->reg[OV7670_REG_VREF] >> 2) & 3);
+  if (vstop >= SIM_FRAME_LINES) {
+    vstop = SIM_FRAME_LINES - 1;
+  }
+  // Pixels are rendered BEFORE waiting, so time spent rendering doesn't
+  // push the next call past the start of the following frame (on hardware
+  // the transfer overlaps the frame).
+  sim_render(arch, dest, (uint32_t)width * height, frame);
+  sim_sleep_until(arch->epoch_ns + (frame - arch->epoch_frame) * period +
+                  period * (vstop + 1) / SIM_FRAME_LINES);
+  return arch->frame = frame;
+}
+
+bool OV7670_sim_load(OV7670_arch *arch, const char *filename) {
+  FILE *file = fopen(filename, "rb");
+  if (!file) {
+    return false;
+  }
+  char magic[3] = {0};
+  unsigned int width = 0, height = 0, maxval = 0;
+  int n = fscanf(file, "%2s", magic);
+  // Header fields are whitespace-separated and may have # comments
+  unsigned int *field[] = {&width, &height, &maxval};
+  for (int i = 0; (n == 1) && (i < 3); i++) {
+    int c;
+    while (((c = fgetc(file)) == '#') || (c == ' ') || (c == '\t') ||
+           (c == '\r') || (c == '\n')) {
+      if (c == '#') {
+        while (((c = fgetc(file)) != '\n') && (c != EOF))
+          ;
+      }
+    }
+    ungetc(c, file);
+    n = fscanf(file, "%u", field[i]);
+  }
+  fgetc(file); // Single whitespace char before pixel data
+  bool gray = !strcmp(magic, "P5");
+  uint8_t *image = NULL;
+  // Size is limited so bytes can't overflow (and it's plenty for a scene)
+  if ((n == 1) && (gray || !strcmp(magic, "P6")) && width && height &&
+      (width <= SIM_IMAGE_MAX) && (height <= SIM_IMAGE_MAX) &&
+      (maxval == 255) &&
+      (image = (uint8_t *)malloc((size_t)width * height * 3))) {
+    uint32_t num_pixels = width * height;
+    size_t bytes = num_pixels * (gray ? 1 : 3);
+    if (fread(image, 1, bytes, file) == bytes) {
+      if (gray) { // Expand to RGB in-place, working backward
+        for (uint32_t i = num_pixels; i--;) {
+          image[i * 3] = image[i * 3 + 1] = image[i * 3 + 2] = image[i];
+        }
+      }
+      free(arch->image);
+      arch->image = image;
+      arch->image_width = width;
+      arch->image_height = height;
+      arch->source = OV7670_SIM_IMAGE;
+    } else {
+      free(image);
+      image = NULL;
+    }
+  }
+  fclose(file);
+  return image != NULL;
+}
+
+// PLATFORM FUNCTIONS ------------------------------------------------------
+
+// These are normally provided by the platform layer (see end of
+// Adafruit_OV7670.cpp). Here, the platform pointer is the OV7670_host.
+
+void OV7670_print(char *str) { fputs(str, stderr); }
+
+// Wait as long as an I2C transaction of this many bits (incl. start, stop
+// and ACKs) would take.
+static void sim_i2c(uint32_t bits) {
+  sim_sleep_until(sim_now_ns() + (uint64_t)bits * 1000000000 / SIM_I2C_HZ);
+}
+
+int OV7670_read_register(void *platform, uint8_t reg) {
+  OV7670_arch *arch = ((OV7670_host *)platform)->arch;
+  int value = OV7670_cache_read(&arch->cache, reg);
+  if (value < 0) {
+    sim_i2c(2 * (1 + 2 * 9 + 1)); // Address+reg write, then address+read
+    arch->i2c_reads++;
+    value = arch->reg[reg];
+    OV7670_cache_store(&arch->cache, reg, value);
+  }
+  return value;
+}
+
+void OV7670_write_register(void *platform, uint8_t reg, uint8_t value) {
+  OV7670_arch *arch = ((OV7670_host *)platform)->arch;
+  if (!OV7670_cache_write(&arch->cache, reg, value)) {
+    return;
+  }
+  sim_i2c(1 + 3 * 9 + 1); // Address, reg, value
+  arch->i2c_writes++;
+  OV7670_cache_written(&arch->cache, reg, value, true); // Always ACKed
+  if ((reg == OV7670_REG_COM7) && (value & OV7670_COM7_RESET)) {
+    sim_reset(arch); // Reset bit is self-clearing, not stored
+    return;
+  }
+  if ((reg == OV7670_REG_PID) || (reg == OV7670_REG_VER) ||
+      (reg == OV7670_REG_MIDH) || (reg == OV7670_REG_MIDL)) {
+    return; // Read-only
+  }
+  if (((reg == OV7670_REG_CLKRC) || (reg == OV7670_REG_DBLV)) &&
+      (value != arch->reg[reg])) {
+    sim_retime(arch); // Finish timing at old rate before changing
+  }
+  arch->reg[reg] = value;
+}
+
+// DEVICE-SPECIFIC FUNCTIONS FOR NON-ARDUINO PLATFORMS ---------------------
+
+void OV7670_delay_ms(uint32_t ms) {
+  struct timespec ts = {ms / 1000, (long)(ms % 1000) * 1000000L};
+  while (nanosleep(&ts, &ts))
+    ; // Resume if interrupted by a signal
+}
+
+uint32_t OV7670_micros(void) { return sim_now_ns() / 1000; } // Wraps, ok
+
+// No pins or interrupts on the desktop, these do nothing.
+void OV7670_pin_output(OV7670_pin pin) { (void)pin; }
+void OV7670_pin_write(OV7670_pin pin, bool hi) { (void)pin, (void)hi; }
+void OV7670_disable_interrupts(void) {}
+void OV7670_enable_interrupts(void) {}
+
+#endif // end __linux__ || __APPLE__
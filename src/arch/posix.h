@@ -0,0 +1,114 @@
+// SPDX-FileCopyrightText: 2020 P Burgess for Adafruit Industries
+//
+// SPDX-License-Identifier: MIT
+
+#pragma once
+
+// Desktop (Linux, macOS) build of the architecture- and platform-neutral
+// code, so image_ops.c and ov7670.c can be compiled, timed and debugged
+// without camera hardware (see extras/host). In place of a camera there's
+// a simulated OV7670: a register file that responds to the same writes as
+// the real thing, and frames rendered from a test pattern or image file at
+// the size and rate those registers imply. This is both architecture AND
+// platform in the terms used elsewhere -- there's no Arduino layer above
+// it, so functions normally provided by Adafruit_OV7670.cpp are in
+// posix.c. Arduino never defines __linux__ or __APPLE__ when building for
+// a microcontroller, so this does not affect those builds.
+#if !defined(ARDUINO) && (defined(__linux__) || defined(__APPLE__))
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef int8_t OV7670_pin;
+
+// No clock is generated on the desktop, but this is the XCLK frequency
+// the simulated camera runs at, and OV7670_set_fps() uses it for its
+// PLL/divider math, same as with real hardware.
+#define OV7670_XCLK_HZ 24000000 ///< XCLK to camera, 8-24 MHz
+
+/** Scene sources for the simulated camera */
+typedef enum {
+  OV7670_SIM_COLOR_BARS = 0, ///< Eight vertical color bars
+  OV7670_SIM_GRADIENT,       ///< Smooth RGB gradient
+  OV7670_SIM_CHECKERBOARD,   ///< 32x32 pixel black & white squares
+  OV7670_SIM_NOISE,          ///< Random pixels, changes every frame
+  OV7670_SIM_IMAGE,          ///< Image loaded with OV7670_sim_load()
+} OV7670_sim_source;
+
+// Device-specific structure attached to the OV7670_host.arch pointer.
+// Elements are maintained by posix.c, but source can be set directly, and
+// the I2C counters reset for profiling. Register access is timed as 100 KHz
+// I2C would be, and goes through the register cache as on Arduino.
+typedef struct {
+  uint8_t reg[256];         ///< Simulated camera register file
+  OV7670_sim_source source; ///< What the camera is "looking at"
+  uint8_t *image;           ///< RGB888 pixels from OV7670_sim_load()
+  uint16_t image_width;     ///< Width of loaded image, in pixels
+  uint16_t image_height;    ///< Height of loaded image, in pixels
+  uint64_t epoch_ns;        ///< Start time of frame epoch_frame
+  uint32_t epoch_frame;     ///< Frame number when timing last changed
+  uint32_t frame;           ///< Number of the last frame captured
+  OV7670_regcache cache;    ///< Shadow registers (this is the platform too)
+  uint32_t i2c_reads;       ///< Register reads that went to the "bus"
+  uint32_t i2c_writes;      ///< Register writes that went to the "bus"
+} OV7670_arch;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Arduino maps these to its own functions at the top of ov7670.h. There
+// is no equivalent here, so they're implemented in posix.c. On this
+// platform, the 'platform' pointer passed to the mid-layer C functions
+// is the OV7670_host struct itself.
+extern void OV7670_delay_ms(uint32_t ms);
+extern uint32_t OV7670_micros(void);
+extern void OV7670_pin_output(OV7670_pin pin);
+extern void OV7670_pin_write(OV7670_pin pin, bool hi);
+extern void OV7670_disable_interrupts(void);
+extern void OV7670_enable_interrupts(void);
+
+// Non-DMA capture function. Blocks until the simulated camera finishes
+// its next frame (at the rate set by CLKRC and DBLV), then copies up to
+// width * height pixels of it to dest, same as a DMA transfer of that
+// length would. Frame size and format follow the camera registers, so if
+// those don't match width and height, neither will the image (again, same
+// as real hardware). Returns the frame number, which will skip ahead if
+// calls are less frequent than the camera frame rate.
+extern uint32_t OV7670_capture(OV7670_arch *arch, uint16_t *dest,
+                               uint16_t width, uint16_t height);
+
+// Load a binary PPM (P6) or PGM (P5) image file as the simulated camera's
+// scene (stretched to fill the sensor), and select OV7670_SIM_IMAGE as the
+// source. Returns false on error (source is then unchanged).
+extern bool OV7670_sim_load(OV7670_arch *arch, const char *filename);
+
+// Get the output frame size implied by the current register settings:
+// COM7 preset sizes, or HSTART/HSTOP/HREF + VSTART/VSTOP/VREF window
+// through the COM3-enabled downsampler (SCALING_DCWCTR) and scaler
+// (SCALING_XSC/YSC), which only run with COM14 DCWEN set. Width is also
+// limited by what the divided PCLK (COM14) and DSP clock
+// (SCALING_PCLK_DIV) can carry in a line.
+extern void OV7670_sim_frame_size(OV7670_arch *arch, uint16_t *width,
+                                  uint16_t *height);
+
+// Get the frame period, in nanoseconds, implied by XCLK and the current
+// CLKRC and DBLV register settings.
+extern uint64_t OV7670_sim_frame_ns(OV7670_arch *arch);
+
+// Get the sensor window, in sensor pixels, that the frame comes from
+// (before downsampling and scaling).
+extern void OV7670_sim_window(OV7670_arch *arch, uint16_t *width,
+                              uint16_t *height);
+
+// Get the output PCLK frequency: the sensor's pixel clock (per XCLK, CLKRC
+// and DBLV) through the COM14 DCW & scaling divider, which is stored in
+// div (1-16) if not NULL. 0 if COM14 asks for a divider the camera
+// doesn't have.
+extern uint32_t OV7670_sim_pclk_hz(OV7670_arch *arch, uint8_t *div);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif // end __linux__ || __APPLE__
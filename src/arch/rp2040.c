@@ -9,11 +9,13 @@
 // be platform neutral and RP2040-specific.
 #if defined(ARDUINO_ARCH_RP2040)
 #include "ov7670.h"
+#include <string.h>
 
-// PIO code in this table is modified at runtime so that PCLK is
+// PIO code in this table is copied and modified at runtime so that PCLK is
 // configurable (rather than fixed GP## or PIN offset). Data pins
-// must be contiguous but are otherwise configurable.
-static uint16_t ov7670_pio_opcodes[] = {
+// must be contiguous but are otherwise configurable. The table itself is
+// left as-is, as each camera may use different pins.
+static const uint16_t ov7670_pio_opcodes[] = {
 #if 0
     // Since PCLK is masked through HSYNC, and FIFO is cleared on VSYNC,
     // no pins other than PCLK need the wait checks.
@@ -30,12 +32,24 @@ static uint16_t ov7670_pio_opcodes[] = {
 #endif
 };
 
-struct pio_program ov7670_pio_program = {
-    .instructions = ov7670_pio_opcodes,
-    .length = sizeof ov7670_pio_opcodes / sizeof ov7670_pio_opcodes[0],
-    .origin = -1,
+#define OV7670_PIO_LEN                                                         \
+  (sizeof ov7670_pio_opcodes / sizeof ov7670_pio_opcodes[0])
+
+// Luma-only YUV capture (arch->luma): same, but the second byte of each
+// pixel (U or V) is waited out rather than read, so only Y reaches the
+// FIFO. Camera must send Y first (big-endian order, no COM3_SWAP).
+static const uint16_t ov7670_pio_luma_opcodes[] = {
+    0b0010000010000000, // WAIT 1 GPIO 0 (mask in HSYNC pin before use)
+    0b0010000010000000, // WAIT 1 GPIO 0 (mask in PCLK pin before use)
+    0b0100000000001000, // IN PINS 8 -- Y into RX FIFO
+    0b0010000000000000, // WAIT 0 GPIO 0 (mask in PCLK pin before use)
+    0b0010000010000000, // WAIT 1 GPIO 0 (mask in PCLK pin) -- U or V...
+    0b0010000000000000, // WAIT 0 GPIO 0 (mask in PCLK pin) -- ...skipped
 };
 
+#define OV7670_PIO_LUMA_LEN                                                    \
+  (sizeof ov7670_pio_luma_opcodes / sizeof ov7670_pio_luma_opcodes[0])
+
 // Each supported architecture MUST provide this function with this name,
 // arguments and return type. It receives a pointer to a structure with
 // at least a list of pins, and usually additional device-specific data
@@ -80,23 +94,49 @@ OV7670_status OV7670_arch_begin(OV7670_host *host) {
     gpio_set_dir(host->pins->data[i], GPIO_IN);
   }
 
-  // Initially by default this always uses pio0, but I suppose this could be
-  // written to use whatever pio has resources.
-  host->arch->pio = pio0;
-
   // Mask the GPIO pin used PCLK into the PIO opcodes -- see notes at top
+  uint16_t opcodes[OV7670_PIO_LUMA_LEN]; // The longer of the two
+  uint8_t len = OV7670_PIO_LEN;
+  if (host->arch->luma) {
+    len = OV7670_PIO_LUMA_LEN;
+    memcpy(opcodes, ov7670_pio_luma_opcodes, sizeof ov7670_pio_luma_opcodes);
+    opcodes[4] |= (host->pins->pclk & 31);
+    opcodes[5] |= (host->pins->pclk & 31);
+  } else {
+    memcpy(opcodes, ov7670_pio_opcodes, sizeof ov7670_pio_opcodes);
+  }
 #if 0
-  ov7670_pio_opcodes[0] |= (host->pins->pclk & 31);
-  ov7670_pio_opcodes[1] |= (host->pins->pclk & 31);
+  opcodes[0] |= (host->pins->pclk & 31);
+  opcodes[1] |= (host->pins->pclk & 31);
 #else
-  ov7670_pio_opcodes[0] |= (host->pins->hsync & 31);
-  ov7670_pio_opcodes[1] |= (host->pins->pclk & 31);
-  ov7670_pio_opcodes[3] |= (host->pins->pclk & 31);
+  opcodes[0] |= (host->pins->hsync & 31);
+  opcodes[1] |= (host->pins->pclk & 31);
+  opcodes[3] |= (host->pins->pclk & 31);
 #endif
-
-  // Here's where resource check & switch to pio1 might go
-  uint offset = pio_add_program(host->arch->pio, &ov7670_pio_program);
-  host->arch->sm = pio_claim_unused_sm(host->arch->pio, true); // 0-3
+  struct pio_program program = {
+      .instructions = opcodes,
+      .length = len,
+      .origin = -1,
+  };
+
+  // Use pio0 if it has room for the program and a free state machine,
+  // else pio1 (e.g. a second camera, or pio0 in use by something else).
+  // Program space isn't shared between cameras even if pins match; at
+  // four (or six) instructions, there's room for plenty.
+  PIO pios[] = {pio0, pio1};
+  int sm = -1;
+  for (uint8_t i = 0; (i < 2) && (sm < 0); i++) {
+    if (pio_can_add_program(pios[i], &program)) {
+      sm = pio_claim_unused_sm(pios[i], false); // 0-3, or -1 if none
+      host->arch->pio = pios[i];
+    }
+  }
+  if (sm < 0) {
+    return OV7670_STATUS_ERR_PERIPHERAL;
+  }
+  host->arch->sm = sm;
+  uint offset = pio_add_program(host->arch->pio, &program);
+  host->arch->offset = offset;
 
   // host->pins->data[0] is data bit 0. PIO code requires all 8 data be
   // contiguous.
@@ -105,10 +145,19 @@ OV7670_status OV7670_arch_begin(OV7670_host *host) {
 
   pio_sm_config c = pio_get_default_sm_config();
   c.pinctrl = 0; // SDK fails to set this
-  sm_config_set_wrap(&c, offset, offset + ov7670_pio_program.length - 1);
+  sm_config_set_wrap(&c, offset, offset + program.length - 1);
 
   sm_config_set_in_pins(&c, host->pins->data[0]);
-  sm_config_set_in_shift(&c, false, true, 16); // 1 pixel (16b) ISR to FIFO
+  if (host->arch->pack32) {
+    // 2 pixels (32b) ISR to FIFO (4 with luma). Shifting right, the first
+    // byte in ends up in the low byte of the word, the first in memory.
+    // The 16-bit push below has it in the high byte, so lands second.
+    sm_config_set_in_shift(&c, true, true, 32);
+  } else if (host->arch->luma) {
+    sm_config_set_in_shift(&c, false, true, 8); // 1 Y byte ISR to FIFO
+  } else {
+    sm_config_set_in_shift(&c, false, true, 16); // 1 pixel (16b) ISR to FIFO
+  }
   sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_RX);
 
   pio_sm_init(host->arch->pio, host->arch->sm, offset, &c);
@@ -133,6 +182,12 @@ OV7670_status OV7670_arch_begin(OV7670_host *host) {
   return OV7670_STATUS_OK;
 }
 
+// Each supported architecture MUST provide this function too, for polling
+// VSYNC (e.g. fast boot waits on frames rather than a fixed delay).
+bool OV7670_arch_vsync(OV7670_host *host) {
+  return gpio_get(host->pins->vsync);
+}
+
 // Non-DMA capture function using previously-initialized peripherals.
 void OV7670_capture(uint16_t *dest, uint16_t width, uint16_t height,
                     volatile uint32_t *vsync_reg, uint32_t vsync_bit,
@@ -169,6 +224,7 @@ void OV7670_capture(uint16_t *dest, uint16_t width, uint16_t height,
 // Arduino), those device-specific functions can be declared here, with a
 // platform-specific #ifdef around them. These functions may include:
 // OV7670_delay_ms(x)
+// OV7670_micros()
 // OV7670_pin_output(pin)
 // OV7670_pin_write(pin, hi)
 // OV7670_disable_interrupts()
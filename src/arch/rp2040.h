@@ -27,14 +27,57 @@ typedef int8_t OV7670_pin;
 #define OV7670_XCLK_HZ 12500000 ///< XCLK to camera, 8-24 MHz
 
 // Device-specific structure attached to the OV7670_host.arch pointer.
+// Other than pack32 and chain, which are user settings, everything here is
+// filled in by OV7670_arch_begin() and the platform layer (luma from
+// setLumaCapture() in the Arduino class), one per camera;
+// interrupts find theirs by VSYNC pin or DMA channel, so multiple cameras
+// can capture at once (each needs its own PIO state machine and DMA
+// channel).
+//
+// pack32 has the PIO push two pixels per 32-bit FIFO word and DMA move
+// words, rather than a 16-bit push and transfer per pixel: half the FIFO
+// and bus traffic, leaving more for e.g. a concurrent SPI display DMA.
+// Bytes then land in memory in the order they arrive from the camera
+// (same as the SAMD51 PCC), whereas the 16-bit path stores each pixel's
+// two bytes swapped. getByteOrder() reports which, per buffer, and image
+// ops follow it. Pixels per frame must be even, which all OV7670_size
+// settings are.
+//
+// luma has the PIO drop the U and V bytes of YUV data, so only Y reaches
+// memory: a contiguous 8-bit plane, half the size of the pixels it came
+// from, with half the DMA traffic. DMA moves single bytes, or with pack32,
+// four per word (pixels per frame or strip must then be a multiple of 4;
+// setSize() and setWindow() refuse other sizes with
+// OV7670_STATUS_ERR_SIZE).
+//
+// chain uses a second (control) DMA channel to re-arm the data channel
+// the moment a frame completes, cycling through the frame buffers, rather
+// than the VSYNC interrupt doing it. Frame starts then don't depend on
+// interrupt latency. Interrupts still run for bookkeeping (frame count,
+// callback, stats, suspend) and to resync after lost pixels, but needn't
+// be timely. Since capture no longer waits on the application, a frame
+// from acquireFrame() is only safe until capture comes back around to
+// that buffer (with N buffers, N-1 frames later).
 typedef struct {
-  PIO pio;                       ///< PIO peripheral (derived from pins)
+  bool pack32;                   ///< Pack 2 pixels per PIO push/DMA beat
+  bool chain;                    ///< Re-arm DMA via control channel
+  bool luma;                     ///< YUV capture keeps only Y bytes
+  PIO pio;                       ///< PIO peripheral (pio0 or pio1)
   uint8_t sm;                    ///< State machine #
+  uint8_t offset;                ///< Program location in PIO memory
   int dma_channel;               ///< DMA channel #
   dma_channel_config dma_config; ///< DMA configuration
+  uint32_t dma_count;            ///< DMA transfers per frame
+  int ctrl_channel;              ///< Control DMA channel # if chained
+  uint8_t chain_len;             ///< Entries used in chain_table
+  /// Buffers for control channel to load (aligned for DMA read ring wrap)
+  uint16_t *chain_table[OV7670_RING_MAX] __attribute__((aligned(32)));
   uint32_t pclk_mask;            ///< GPIO bitmask for PCLK pin
   uint32_t vsync_mask;           ///< GPIO bitmask for VSYNC pin
   uint32_t hsync_mask;           ///< GPIO bitmask for HSYNC pin
+  OV7670_ring *ring;             ///< Frame buffer(s) DMA loads into
+  volatile bool frame_ready;     ///< true at end-of-frame
+  volatile bool suspended;       ///< If set, DMA is paused
 } OV7670_arch;
 
 #ifdef __cplusplus
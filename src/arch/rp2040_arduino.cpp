@@ -25,71 +25,283 @@ arch_begin() and capture() in each .cpp and call it done.
 #include "wiring_private.h" // pinPeripheral() function
 #include <Arduino.h>
 
-// Because interrupts exist outside the class context, but our interrupt
-// needs to access to object- and arch-specific data like the camera buffer
-// and DMA settings, pointers are kept (initialized in the begin() function).
-// This does mean that only a single OV7670 can be active.
-Adafruit_OV7670 *platformptr = NULL; // Camera buffer, size, etc.
-OV7670_arch *archptr = NULL;         // DMA settings
+// Interrupts exist outside the class context, but need object- and
+// arch-specific data like the frame buffer(s) and DMA settings. Each
+// camera's arch struct holds all of that, and these tables (filled in by
+// arch_begin() and arch_update()) find the right one by VSYNC or HSYNC pin
+// or DMA channel, so any number of cameras can run at once, resources
+// permitting. GPIO and DMA interrupt handlers are shared by all cameras.
+static OV7670_arch *vsync_arch[NUM_BANK0_GPIOS]; // Indexed by VSYNC pin
+static OV7670_arch *hsync_arch[NUM_BANK0_GPIOS]; // Indexed by HSYNC pin
+static OV7670_arch *dma_arch[NUM_DMA_CHANNELS];  // Indexed by DMA channel
 
 // INTERRUPT HANDLING AND RELATED CODE -------------------------------------
 
-static volatile bool frameReady = false; // true at end-of-frame
-static volatile bool suspended = false;
+// Stop capture DMA (control channel first if chained, else it would just
+// re-trigger the data channel). Channel IRQ is masked during the abort,
+// as abort can raise a spurious completion interrupt (RP2040-E13) that
+// would pass a partial frame off as complete.
+static void ov7670_dma_stop(OV7670_arch *arch) {
+  dma_channel_set_irq0_enabled(arch->dma_channel, false);
+  if (arch->chain) {
+    dma_channel_abort(arch->ctrl_channel);
+  }
+  dma_channel_abort(arch->dma_channel);
+  dma_hw->ints0 = 1u << arch->dma_channel;
+  dma_channel_set_irq0_enabled(arch->dma_channel, true);
+}
 
-// To do: use the arch state variable to detect when a VSYNC IRQ occurs
-// before the last DMA transfer is complete (suggesting one or more pixels
-// dropped, likely bad PCLK signal). If that happens, abort the DMA
-// transfer and return, skip frames and  don't begin next DMA until abort
-// has completed (this is what state var is for, to detect if in this
-// holding pattern).
+// After a DMA abort, a partial pixel (or pixel pair) may be left in the
+// PIO's ISR, which would offset every pixel after. Empty it and restart
+// the program.
+static void ov7670_pio_restart(OV7670_arch *arch) {
+  pio_sm_restart(arch->pio, arch->sm);
+  pio_sm_exec(arch->pio, arch->sm, pio_encode_jmp(arch->offset));
+}
+
+// Pixels per DMA transfer, as a power of 2: 1 pixel (16 bits, or one Y
+// byte with luma), or with pack32, 2 pixels (4 Y's) per 32-bit word.
+static uint8_t ov7670_dma_shift(OV7670_arch *arch) {
+  return arch->pack32 ? (arch->luma ? 2 : 1) : 0;
+}
+
+// Pixels the data channel has stored in the current transfer (frame or
+// strip). Only meaningful while the channel is busy.
+static uint32_t ov7670_pixels_loaded(OV7670_arch *arch) {
+  uint32_t left = dma_hw->ch[arch->dma_channel].transfer_count;
+  return (arch->dma_count - left) << ov7670_dma_shift(arch);
+}
 
 // Pin interrupt on VSYNC calls this to start DMA transfer (unless suspended).
-static void ov7670_vsync_irq(uint gpio, uint32_t events) {
-  if (!suspended) {
-    frameReady = false;
-    // Clear PIO FIFOs and start DMA transfer
-    pio_sm_clear_fifos(archptr->pio, archptr->sm);
-    dma_channel_start(archptr->dma_channel);
+// A VSYNC arriving before the last DMA transfer is complete means one or
+// more pixels were dropped (likely bad PCLK signal). That transfer is
+// aborted so the new frame starts clean, and ring/stats note the torn
+// frame.
+//
+// In chained mode (arch->chain), the control channel has already re-armed
+// the data channel for this frame, so this only starts it when idle
+// (first frame or after suspend) and checks alignment. A transfer with
+// less than half its pixels to go must be the last frame's, missing
+// pixels; one with more is this frame's, and just means this interrupt
+// was late, which is harmless here (up to half a frame late, anyway).
+static void ov7670_vsync_irq(OV7670_arch *arch) {
+  OV7670_stats_vsync(&arch->ring->stats);
+  if (arch->suspended) {
+    arch->ring->stats.dropped++;
+  } else if (arch->ring->strip_rows) {
+    // Strips always restart from the first row and table entry at VSYNC.
+    // Rows were still due if a transfer's in progress: either the last,
+    // partial strip, or pixels were lost.
+    bool busy = dma_channel_is_busy(arch->dma_channel);
+    if (busy) {
+      ov7670_dma_stop(arch);
+      ov7670_pio_restart(arch);
+    }
+    arch->frame_ready = OV7670_ring_strip_vsync(arch->ring, busy);
+    pio_sm_clear_fifos(arch->pio, arch->sm);
+    dma_channel_set_read_addr(arch->ctrl_channel, arch->chain_table, false);
+    dma_channel_start(arch->ctrl_channel);
+  } else if (arch->chain) {
+    arch->frame_ready = false;
+    if (dma_channel_is_busy(arch->dma_channel)) {
+      if (dma_hw->ch[arch->dma_channel].transfer_count >=
+          arch->dma_count / 2) {
+        return; // All's well
+      }
+      ov7670_dma_stop(arch);
+      ov7670_pio_restart(arch);
+      arch->ring->stats.restarts++;
+      arch->ring->stats.torn++;
+    }
+    pio_sm_clear_fifos(arch->pio, arch->sm);
+    dma_channel_start(arch->ctrl_channel); // Loads next buffer, triggers
+  } else {
+    arch->frame_ready = false;
+    if (dma_channel_is_busy(arch->dma_channel)) {
+      ov7670_dma_stop(arch);
+      ov7670_pio_restart(arch);
+      arch->ring->stats.restarts++;
+    }
+    // Clear PIO FIFOs and start DMA transfer. Channel MUST be given the
+    // dest address each time, it's advanced by the prior transfer (and
+    // may rotate through a ring of buffers).
+    pio_sm_clear_fifos(arch->pio, arch->sm);
+    dma_channel_set_write_addr(arch->dma_channel,
+                               OV7670_ring_start(arch->ring), true);
+  }
+}
+
+// Falling HSYNC (end of a row) with a row callback set: pass the row
+// count on to the ring, which calls back every row_step rows. Rows are
+// counted from DMA progress rather than HSYNC pulses, so a late interrupt
+// or lost pixels can't make this run ahead of the data.
+static void ov7670_hsync_irq(OV7670_arch *arch) {
+  OV7670_ring *ring = arch->ring;
+  if (!dma_channel_is_busy(arch->dma_channel)) {
+    return; // Between frames
+  }
+  uint16_t *frame;
+  if (arch->chain) { // Loading the buffer before the next table entry
+    uint8_t next = (dma_hw->ch[arch->ctrl_channel].read_addr -
+                    (uintptr_t)arch->chain_table) /
+                   sizeof(uint16_t *);
+    frame = arch->chain_table[(next + arch->chain_len - 1) %
+                              arch->chain_len];
+  } else if (ring->filling >= 0) {
+    frame = ring->buf[ring->filling];
+  } else {
+    return;
+  }
+  OV7670_ring_rows(ring, frame, ov7670_pixels_loaded(arch) / ring->row_width);
+}
+
+// The GPIO interrupt callback is one per core, shared by all pins, so
+// this sorts out whose VSYNC or HSYNC it is.
+static void ov7670_gpio_irq(uint gpio, uint32_t events) {
+  if (vsync_arch[gpio]) {
+    ov7670_vsync_irq(vsync_arch[gpio]);
+  } else if (hsync_arch[gpio]) {
+    ov7670_hsync_irq(hsync_arch[gpio]);
   }
 }
 
+// DMA transfer(s) completed. Unchained, next one is set up at VSYNC. If
+// chained, the control channel has already started the next one, and this
+// is only bookkeeping: the buffer just finished is the one before the
+// table entry the control channel last read (it's advanced past that
+// one). Only channels belonging to cameras are handled (and cleared), the
+// handler is shared.
 static void ov7670_dma_finish_irq() {
-  // DMA transfer completed. Set up (but do not trigger) next one.
-  frameReady = true;
-  // Channel MUST be reconfigured each time (to reset the dest address).
-  dma_channel_set_write_addr(archptr->dma_channel,
-                             (uint8_t *)(platformptr->getBuffer()), false);
-  dma_hw->ints0 = 1u << archptr->dma_channel; // Clear IRQ
+  for (uint8_t ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+    OV7670_arch *arch = dma_arch[ch];
+    if (arch && (dma_hw->ints0 & (1u << ch))) {
+      dma_hw->ints0 = 1u << ch; // Clear IRQ
+      if (arch->ring->strip_rows) {
+        // Next strip's already loading (chained), this is the callback
+        if (OV7670_ring_strip_done(arch->ring)) {
+          arch->frame_ready = true;
+        }
+        continue;
+      }
+      if (arch->chain) {
+        uint8_t next = (dma_hw->ch[arch->ctrl_channel].read_addr -
+                        (uintptr_t)arch->chain_table) /
+                       sizeof(uint16_t *);
+        uint8_t n = arch->chain_len;
+        arch->ring->filling = (next + n - 2) % n;
+      }
+      OV7670_ring_done(arch->ring);
+      arch->frame_ready = true;
+    }
+  }
 }
 
 // This is NOT a sleep function, it just pauses background DMA.
 
 void Adafruit_OV7670::suspend(void) {
-  while (!frameReady)
-    ;               // Wait for current frame to finish loading
-  suspended = true; // Don't load next frame (camera runs, DMA stops)
+  while (!arch.frame_ready)
+    ;                    // Wait for current frame to finish loading
+  arch.suspended = true; // Don't load next frame (camera runs, DMA stops)
+  if (arch.chain) {
+    // Chained DMA's already re-armed, stop it before next frame's data
+    ov7670_dma_stop(&arch);
+    ov7670_pio_restart(&arch);
+  }
 }
 
 // NOT a wake function, just resumes background DMA.
 
 void Adafruit_OV7670::resume(void) {
-  frameReady = false;
-  suspended = false; // Resume DMA transfers
+  arch.frame_ready = false;
+  arch.suspended = false; // Resume DMA transfers (at next VSYNC)
+}
+
+OV7670_status Adafruit_OV7670::setLumaCapture(bool on) {
+  if (buffer) {
+    return OV7670_STATUS_ERR_PERIPHERAL; // Too late, already started
+  }
+  luma = on; // arch_begin() passes this to the PIO setup
+  return OV7670_STATUS_OK;
+}
+
+uint16_t Adafruit_OV7670::rowsAvailable(void) {
+  if (arch.frame_ready) {
+    return _height;
+  }
+  uint16_t rows = 0;
+  OV7670_disable_interrupts(); // Don't let the next strip start mid-way
+  if (dma_channel_is_busy(arch.dma_channel)) {
+    rows = ov7670_pixels_loaded(&arch) / _width;
+    if (ring.strip_rows) {
+      rows += ring.strip_row;
+    }
+  }
+  OV7670_enable_interrupts();
+  return rows;
+}
+
+// DMA can only move whole transfers, so pixels per frame (or strip) must
+// fill them. With pack32 that's 2 pixels, which widths always are (even),
+// but 4 with luma; a remainder would sit in the PIO's ISR and turn up at
+// the start of the next frame.
+bool Adafruit_OV7670::arch_size_ok(uint16_t width, uint16_t rows) const {
+  return !arch.pack32 || (pixel_bytes() == 2) ||
+         !(((uint32_t)width * rows) & 3);
+}
+
+// Bring DMA in line with current frame size and buffer(s), after
+// setSize(), setBufferCount() or setRowCallback(). HSYNC interrupt is
+// enabled only while a row callback needs it. If chained (always, in
+// strip mode), this rebuilds the control channel's address table; next
+// VSYNC after resume() starts it again. Callers have capture suspended
+// (or not yet started), and suspend() has already stopped a chain, which
+// would otherwise have re-armed the data channel on a buffer that may
+// since have been freed. The table is walked by the control channel's
+// read ring, which must be a power of two in size, so only the first 1,
+// 2, 4 or 8 ring buffers are used.
+void Adafruit_OV7670::arch_update(void) {
+  uint16_t rows = ring.strip_rows ? ring.strip_rows : _height;
+  arch.dma_count = (_width * rows) >> ov7670_dma_shift(&arch);
+  bool row_irq = ring.row_callback && !ring.strip_rows;
+  hsync_arch[pins.hsync] = row_irq ? &arch : NULL;
+  gpio_set_irq_enabled(pins.hsync, GPIO_IRQ_EDGE_FALL, row_irq);
+  if (!arch.chain) {
+    dma_channel_set_trans_count(arch.dma_channel, arch.dma_count, false);
+    return;
+  }
+  OV7670_disable_interrupts();
+  uint8_t n = 1, bits = 2; // 1 pointer = 4 byte ring = 2 bits
+  while ((n * 2) <= ring.count) {
+    n *= 2;
+    bits++;
+  }
+  for (uint8_t i = 0; i < n; i++) {
+    arch.chain_table[i] = ring.buf[i];
+  }
+  arch.chain_len = ring.strip_buffers = n;
+  dma_channel_config c = dma_channel_get_default_config(arch.ctrl_channel);
+  channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+  channel_config_set_read_increment(&c, true);
+  channel_config_set_write_increment(&c, false);
+  channel_config_set_ring(&c, false, bits); // Wrap read around table
+  dma_channel_configure(arch.ctrl_channel, &c,
+                        &dma_hw->ch[arch.dma_channel].al2_write_addr_trig,
+                        arch.chain_table, 1, false);
+  dma_channel_set_trans_count(arch.dma_channel, arch.dma_count, false);
+  OV7670_enable_interrupts();
 }
 
 OV7670_status Adafruit_OV7670::arch_begin(OV7670_colorspace colorspace,
-                                          OV7670_size size, float fps) {
+                                          OV7670_size size, float fps,
+                                          OV7670_boot boot) {
 
   // BASE INITIALIZATION (PLATFORM-AGNOSTIC) -------------------------------
   // This calls the device-neutral C init function OV7670_begin(), which in
   // turn calls the device-specific C init OV7670_arch_begin() in samd51.c.
   // So many layers. It's like an ogre.
 
-  // I'm not sure what Past Me was thinking with the host struct here as
-  // a local variable passed to OV7670_begin() and then just goes away.
-  // Maybe it was supposed to be a static global in this file (replacing
-  // the separate archptr and platformptr pointers)?
+  // host is only needed through OV7670_begin(); anything interrupts
+  // need later is in the arch struct (see notes at top).
   OV7670_host host;
   host.arch = &arch; // Point to struct in Adafruit_OV7670 class
   host.pins = &pins; // Point to struct in Adafruit_OV7670 class
@@ -97,9 +309,14 @@ OV7670_status Adafruit_OV7670::arch_begin(OV7670_colorspace colorspace,
     // See SAMD code for what could go here
   }
   host.platform = this; // Pointer back to Arduino_OV7670 object
+  // Saved registers (if any) replace init tables in OV7670_begin()
+  host.profile = profile;
+  host.profile_len = profile_len;
+
+  arch.luma = (pixel_bytes() == 1); // PIO program depends on it
 
   OV7670_status status;
-  status = OV7670_begin(&host, colorspace, size, fps);
+  status = OV7670_begin(&host, colorspace, size, fps, boot);
   if (status != OV7670_STATUS_OK) {
     return status;
   }
@@ -114,35 +331,72 @@ OV7670_status Adafruit_OV7670::arch_begin(OV7670_colorspace colorspace,
 
   // ARDUINO-SPECIFIC EXTRA INITIALIZATION ---------------------------------
 
-  // See notes at top re: pointers
-  archptr = &arch;    // For access to DMA settings
-  platformptr = this; // For access to buffer & dimensions
+  arch.ring = &ring; // For frame buffer(s)
+  arch.frame_ready = false;
+  arch.suspended = false;
 
   // SET UP DMA ------------------------------------------------------------
 
   arch.dma_channel = dma_claim_unused_channel(false); // don't panic
+  if (arch.dma_channel < 0) {
+    return OV7670_STATUS_ERR_PERIPHERAL;
+  }
 
   arch.dma_config = dma_channel_get_default_config(arch.dma_channel);
-  channel_config_set_transfer_data_size(&arch.dma_config, DMA_SIZE_16);
+  channel_config_set_transfer_data_size(
+      &arch.dma_config, arch.pack32 ? DMA_SIZE_32
+                        : arch.luma ? DMA_SIZE_8
+                                    : DMA_SIZE_16);
+  // The 16-bit PIO push is (first << 8 | second), which DMA stores as a
+  // little-endian halfword, second byte first: each pixel's bytes land
+  // swapped from the order the camera sends them, as they always have on
+  // this path. pack32 shifts the other way and keeps camera order, as do
+  // single Y bytes. The ring notes which, so getByteOrder() and the image
+  // ops see what's really in memory.
+  ring.swapped = !arch.pack32 && !arch.luma;
   channel_config_set_read_increment(&arch.dma_config, false);
   channel_config_set_write_increment(&arch.dma_config, true);
   // Set PIO RX as DMA trigger. Input shift register saturates at 16 bits
-  // (1 pixel), configured in data size above and in PIO setup elsewhere.
+  // (1 pixel; 8 bits, 1 Y, with luma) or with pack32, 32 bits (2 pixels
+  // or 4 Y's), configured in data size above and in PIO setup elsewhere.
   channel_config_set_dreq(&arch.dma_config,
                           pio_get_dreq(arch.pio, arch.sm, false));
+  if (ring.strip_rows) {
+    arch.chain = true; // Strips are always chained, see arch_update()
+  }
+  if (arch.chain) {
+    // Each completed frame (or strip) triggers the control channel, which
+    // writes the next buffer address to this channel's write-address-and-
+    // trigger register, so capture continues with no CPU involvement.
+    arch.ctrl_channel = dma_claim_unused_channel(false);
+    if (arch.ctrl_channel < 0) {
+      dma_channel_unclaim(arch.dma_channel);
+      return OV7670_STATUS_ERR_PERIPHERAL;
+    }
+    channel_config_set_chain_to(&arch.dma_config, arch.ctrl_channel);
+  }
   // Set up initial DMA xfer, but don't trigger (that's done in interrupt)
   dma_channel_configure(arch.dma_channel, &arch.dma_config, getBuffer(),
-                        &arch.pio->rxf[arch.sm], width() * height(), false);
+                        &arch.pio->rxf[arch.sm], 0, false);
+  arch_update(); // Transfer count, and control channel if chained
 
-  // Set up end-of-DMA interrupt
+  // Set up end-of-DMA interrupt. Handler is shared (with other cameras
+  // and anything else using DMA_IRQ_0), installed by the first camera.
+  static bool dma_irq_installed = false;
+  dma_arch[arch.dma_channel] = &arch;
   dma_channel_set_irq0_enabled(arch.dma_channel, true);
-  irq_set_exclusive_handler(DMA_IRQ_0, ov7670_dma_finish_irq);
-  irq_set_enabled(DMA_IRQ_0, true);
+  if (!dma_irq_installed) {
+    irq_add_shared_handler(DMA_IRQ_0, ov7670_dma_finish_irq,
+                           PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_0, true);
+    dma_irq_installed = true;
+  }
 
   // SET UP VSYNC INTERRUPT ------------------------------------------------
 
+  vsync_arch[pins.vsync] = &arch;
   gpio_set_irq_enabled_with_callback(pins.vsync, GPIO_IRQ_EDGE_RISE, true,
-                                     &ov7670_vsync_irq);
+                                     &ov7670_gpio_irq);
 
   return status;
 }
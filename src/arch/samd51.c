@@ -206,6 +206,18 @@ OV7670_status OV7670_arch_begin(OV7670_host *host) {
   return OV7670_STATUS_OK;
 }
 
+// Each supported architecture MUST provide this function too, for polling
+// VSYNC (e.g. fast boot waits on frames rather than a fixed delay).
+bool OV7670_arch_vsync(OV7670_host *host) {
+  (void)host; // PCC pins are fixed, VSYNC is always DEN1
+#if defined(ARDUINO)
+  return PORT->Group[g_APinDescription[PIN_PCC_DEN1].ulPort].IN.reg &
+         (1ul << g_APinDescription[PIN_PCC_DEN1].ulPin);
+#else
+  return false; // CircuitPython, etc. read DEN1 pin here
+#endif
+}
+
 // Non-DMA capture function using previously-initialized PCC peripheral.
 void OV7670_capture(uint32_t *dest, uint16_t width, uint16_t height,
                     volatile uint32_t *vsync_reg, uint32_t vsync_bit,
@@ -240,6 +252,7 @@ void OV7670_capture(uint32_t *dest, uint16_t width, uint16_t height,
 // Arduino), those device-specific functions can be declared here, with a
 // platform-specific #ifdef around them. These functions may include:
 // OV7670_delay_ms(x)
+// OV7670_micros()
 // OV7670_pin_output(pin)
 // OV7670_pin_write(pin, hi)
 // OV7670_disable_interrupts()
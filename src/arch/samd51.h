@@ -23,9 +23,19 @@ typedef int8_t OV7670_pin;
 #define OV7670_XCLK_HZ 24000000 ///< XCLK to camera, 8-24 MHz
 
 // Device-specific structure attached to the OV7670_host.arch pointer.
+// Only timer and xclk_pdec are user settings, the rest is DMA state
+// maintained by the platform layer. The SAMD51 has one PCC peripheral,
+// so only one camera can capture at a time.
 typedef struct {
-  void *timer;    ///< TC or TCC peripheral base address for XCLK out
-  bool xclk_pdec; ///< If true, XCLK needs special PDEC pin mux
+  void *timer;               ///< TC or TCC peripheral for XCLK out
+  bool xclk_pdec;            ///< If true, XCLK needs special PDEC pin mux
+  void *dma;                 ///< DMA channel (platform-specific type)
+  void *descriptor;          ///< DMA descriptor (platform-specific type)
+  uint32_t dma_count;        ///< 32-bit words in current DMA transfer
+  volatile uint16_t dma_row; ///< First row of current DMA transfer
+  OV7670_ring *ring;         ///< Frame buffer(s) DMA loads into
+  volatile bool frame_ready; ///< true at end-of-frame
+  volatile bool suspended;   ///< If set, DMA is paused
 } OV7670_arch;
 
 #ifdef __cplusplus
@@ -29,57 +29,172 @@ arch_begin() and capture() in each .cpp and call it done.
 #include <Adafruit_ZeroDMA.h>
 #include <Arduino.h>
 
-// Because interrupts exist outside the class context, but our interrupt
-// needs to access to an active ZeroDMA object, a separate ZeroDMA pointer
-// is kept (initialized in the begin() function). This does mean that only
-// a single OV7670 can be active (probably no big deal, as there's only a
-// single parallel capture peripheral).
-
-static Adafruit_ZeroDMA dma;
-static DmacDescriptor *descriptor;       ///< DMA descriptor
-static volatile bool frameReady = false; // true at end-of-frame
-static volatile bool suspended = false;
+// Each camera's DMA channel, descriptor and capture flags are in its arch
+// struct; the DMA callback finds the right one by channel. The VSYNC pin
+// interrupt can't be told apart that way, but the SAMD51 has a single
+// PCC, with fixed pins, so there's only ever one camera capturing. That
+// one is pcc_arch, claimed in arch_begin().
+static OV7670_arch *pcc_arch = NULL;       // Camera using the PCC
+static OV7670_arch *dma_arch[DMAC_CH_NUM]; // Indexed by DMA channel
 
 // INTERRUPT HANDLING AND RELATED CODE -------------------------------------
 
+// Start a DMA transfer of some rows to dest, first of which is frame row
+// 'row' (for rowsAvailable()).
+static void ov7670_dma_start(OV7670_arch *arch, uint16_t *dest, uint16_t row,
+                             uint16_t rows) {
+  Adafruit_ZeroDMA *dma = (Adafruit_ZeroDMA *)arch->dma;
+  arch->dma_row = row;
+  arch->dma_count = (uint32_t)arch->ring->row_width * rows / 2;
+  dma->changeDescriptor((DmacDescriptor *)arch->descriptor, NULL, dest,
+                        arch->dma_count);
+  (void)dma->startJob();
+}
+
+// Words the current DMA transfer has yet to move. The DMAC's ACTIVE
+// register has the count for whichever channel it's serving right now;
+// otherwise, it's in the channel's write-back descriptor.
+static uint32_t ov7670_dma_left(Adafruit_ZeroDMA *dma) {
+  uint8_t ch = dma->getChannel();
+  if (DMAC->ACTIVE.bit.ABUSY && (DMAC->ACTIVE.bit.ID == ch)) {
+    return DMAC->ACTIVE.bit.BTCNT;
+  }
+  return ((DmacDescriptor *)DMAC->WRBADDR.reg)[ch].BTCNT.reg;
+}
+
 // Pin interrupt on VSYNC calls this to start DMA transfer (unless suspended).
+// Destination is set anew each frame, as it may rotate through a ring of
+// buffers (or have been moved by setSize() reallocation). If the prior
+// transfer is still going, pixels were lost (PCLK glitch or similar); it's
+// aborted so this frame starts clean, and ring/stats note the torn frame.
+// In strip mode, every frame starts from the first strip; a transfer
+// still active is either the last (partial) strip or lost pixels. With a
+// row callback, the frame is loaded row_step rows per transfer.
 static void startFrame(void) {
-  if (!suspended) {
-    frameReady = false;
-    (void)dma.startJob();
+  OV7670_arch *arch = pcc_arch;
+  OV7670_ring *ring = arch->ring;
+  OV7670_stats_vsync(&ring->stats);
+  if (!arch->suspended) {
+    Adafruit_ZeroDMA *dma = (Adafruit_ZeroDMA *)arch->dma;
+    arch->frame_ready = false;
+    bool busy = dma->isActive();
+    if (busy) {
+      dma->abort();
+    }
+    if (ring->strip_rows) {
+      arch->frame_ready = OV7670_ring_strip_vsync(ring, busy);
+      ov7670_dma_start(arch, OV7670_ring_strip_buffer(ring), 0,
+                       ring->strip_rows);
+    } else {
+      if (busy) {
+        ring->stats.restarts++;
+      }
+      uint16_t rows = ring->strip_height;
+      if (ring->row_callback && (ring->row_step < rows)) {
+        rows = ring->row_step;
+      }
+      ov7670_dma_start(arch, OV7670_ring_start(ring), 0, rows);
+    }
+  } else {
+    arch->ring->stats.dropped++;
   }
 }
 
-// End-of-DMA-transfer callback
-static void dmaCallback(Adafruit_ZeroDMA *dma) { frameReady = true; }
+// End-of-DMA-transfer callback. In strip mode, or a frame loaded in parts
+// for the row callback, the next transfer is started from here, before
+// the next row's pixels arrive.
+static void dmaCallback(Adafruit_ZeroDMA *dma) {
+  OV7670_arch *arch = dma_arch[dma->getChannel()];
+  OV7670_ring *ring = arch->ring;
+  if (ring->strip_rows) {
+    if (OV7670_ring_strip_done(ring)) {
+      arch->frame_ready = true; // Next strip starts at VSYNC
+    } else {
+      ov7670_dma_start(arch, OV7670_ring_strip_buffer(ring), ring->strip_row,
+                       ring->strip_rows);
+    }
+    return;
+  }
+  uint16_t row = arch->dma_row + arch->dma_count * 2 / ring->row_width;
+  if (ring->row_callback && (row < ring->strip_height) &&
+      (ring->filling >= 0)) {
+    uint16_t *frame = ring->buf[ring->filling];
+    uint16_t rows = ring->strip_height - row;
+    if (rows > ring->row_step) {
+      rows = ring->row_step;
+    }
+    ov7670_dma_start(arch, frame + (uint32_t)row * ring->row_width, row,
+                     rows);
+    OV7670_ring_rows(ring, frame, row);
+    return;
+  }
+  OV7670_ring_done(ring);
+  arch->frame_ready = true;
+}
 
 // Since ZeroDMA suspend/resume functions don't yet work, these functions
-// use static vars to indicate whether to trigger DMA transfers or hold off
+// use flags to indicate whether to trigger DMA transfers or hold off
 // (camera keeps running, data is simply ignored without a DMA transfer).
 
 // This is NOT a sleep function, it just pauses background DMA.
 
 void Adafruit_OV7670::suspend(void) {
-  while (!frameReady)
-    ;               // Wait for current frame to finish loading
-  suspended = true; // Don't load next frame (camera runs, DMA stops)
+  while (!arch.frame_ready)
+    ;                    // Wait for current frame to finish loading
+  arch.suspended = true; // Don't load next frame (camera runs, DMA stops)
 }
 
 // NOT a wake function, just resumes background DMA.
 
 void Adafruit_OV7670::resume(void) {
-  frameReady = false;
-  suspended = false; // Resume DMA transfers
+  arch.frame_ready = false;
+  arch.suspended = false; // Resume DMA transfers
 }
 
+// The PCC stores every byte it's given, so luma-only capture isn't
+// possible here; OV7670_Y_extract() after capture does the same job.
+OV7670_status Adafruit_OV7670::setLumaCapture(bool on) {
+  return on ? OV7670_STATUS_ERR_PERIPHERAL : OV7670_STATUS_OK;
+}
+
+uint16_t Adafruit_OV7670::rowsAvailable(void) {
+  Adafruit_ZeroDMA *dma = (Adafruit_ZeroDMA *)arch.dma;
+  if (arch.frame_ready) {
+    return _height;
+  }
+  uint16_t rows = 0;
+  OV7670_disable_interrupts(); // Keep dma_row & count in step with DMAC
+  if (dma && dma->isActive()) {
+    rows = arch.dma_row + (arch.dma_count - ov7670_dma_left(dma)) * 2 / _width;
+  }
+  OV7670_enable_interrupts();
+  return rows;
+}
+
+// PCC moves 4 bytes at a time, 2 pixels, and widths are always even.
+bool Adafruit_OV7670::arch_size_ok(uint16_t width, uint16_t rows) const {
+  (void)width, (void)rows;
+  return true;
+}
+
+// Ring's buffer count may have changed, after setSize() or
+// setBufferCount(). DMA transfer size and address are set per transfer,
+// from the ring, so nothing else to do.
+void Adafruit_OV7670::arch_update(void) { ring.strip_buffers = ring.count; }
+
 OV7670_status Adafruit_OV7670::arch_begin(OV7670_colorspace colorspace,
-                                          OV7670_size size, float fps) {
+                                          OV7670_size size, float fps,
+                                          OV7670_boot boot) {
 
   // BASE INITIALIZATION (PLATFORM-AGNOSTIC) -------------------------------
   // This calls the device-neutral C init function OV7670_begin(), which in
   // turn calls the device-specific C init OV7670_arch_begin() in samd51.c.
   // So many layers. It's like an ogre.
 
+  if (pcc_arch && (pcc_arch != &arch)) {
+    return OV7670_STATUS_ERR_PERIPHERAL; // Another camera has the PCC
+  }
+
   OV7670_host host;
   host.arch = &arch; // Point to struct in Adafruit_OV7670 class
   host.pins = &pins; // Point to struct in Adafruit_OV7670 class
@@ -88,9 +203,12 @@ OV7670_status Adafruit_OV7670::arch_begin(OV7670_colorspace colorspace,
     arch.xclk_pdec = false; // and default pin MUX
   }
   host.platform = this; // Pointer back to Arduino_OV7670 object
+  // Saved registers (if any) replace init tables in OV7670_begin()
+  host.profile = profile;
+  host.profile_len = profile_len;
 
   OV7670_status status;
-  status = OV7670_begin(&host, colorspace, size, fps);
+  status = OV7670_begin(&host, colorspace, size, fps, boot);
   if (status != OV7670_STATUS_OK) {
     return status;
   }
@@ -98,20 +216,40 @@ OV7670_status Adafruit_OV7670::arch_begin(OV7670_colorspace colorspace,
   // ARDUINO-SPECIFIC EXTRA INITIALIZATION ---------------------------------
   // Sets up DMA for the parallel capture controller.
 
-  ZeroDMAstatus dma_status = dma.allocate();
-  // To do: handle dma_status here, map to OV7670_status on error
-  dma.setAction(DMA_TRIGGER_ACTON_BEAT);
-  dma.setTrigger(PCC_DMAC_ID_RX);
-  dma.setCallback(dmaCallback);
-  dma.setPriority(DMA_PRIORITY_3);
-
-  // Use 32-bit PCC transfers (4 bytes accumulate in RHR.reg)
-  descriptor = dma.addDescriptor((void *)(&PCC->RHR.reg), // Move from here
-                                 (void *)buffer,          // to here
-                                 _width * _height / 2,    // this many
-                                 DMA_BEAT_SIZE_WORD,      // 32-bit words
-                                 false,                   // Don't src++
-                                 true);                   // Do dest++
+  arch.ring = &ring; // For frame buffer(s)
+  arch.frame_ready = false;
+  arch.suspended = false;
+
+  // DMA channel object lives as long as the program (as with the PCC,
+  // there's no arch teardown yet), and is kept if begin() is repeated.
+  Adafruit_ZeroDMA *dma = (Adafruit_ZeroDMA *)arch.dma;
+  if (!dma) {
+    dma = new Adafruit_ZeroDMA;
+    if (!dma) {
+      return OV7670_STATUS_ERR_MALLOC;
+    }
+    if (dma->allocate() != DMA_STATUS_OK) {
+      delete dma;
+      return OV7670_STATUS_ERR_PERIPHERAL;
+    }
+    arch.dma = dma;
+    dma->setAction(DMA_TRIGGER_ACTON_BEAT);
+    dma->setTrigger(PCC_DMAC_ID_RX);
+    dma->setCallback(dmaCallback);
+    dma->setPriority(DMA_PRIORITY_3);
+
+    // Use 32-bit PCC transfers (4 bytes accumulate in RHR.reg)
+    arch.descriptor =
+        dma->addDescriptor((void *)(&PCC->RHR.reg), // Move from here
+                           (void *)buffer,          // to here
+                           _width * _height / 2,    // this many
+                           DMA_BEAT_SIZE_WORD,      // 32-bit words
+                           false,                   // Don't src++
+                           true);                   // Do dest++
+  }
+  dma_arch[dma->getChannel()] = &arch;
+  pcc_arch = &arch;
+  arch_update(); // Transfer count for current size or strip mode
 
   // A pin FALLING interrupt is used to detect the start of a new frame.
   // Seems like the PCC RXBUFF and/or ENDRX interrupts could take care
@@ -3,25 +3,220 @@
 // SPDX-License-Identifier: MIT
 
 #include "image_ops.h"
+#include <stdlib.h>
+#include <string.h>
 
 // These functions are preceded by "OV7670" even though they're not tied to
 // the camera hardware, just that they're part of this lib. These are not
 // in-camera effects, though some might be possible to implement as such.
 
+// Ops that work on whole RGB565 values are written once, as always-inline
+// functions taking a 'swap' flag, and instantiated twice by the _order()
+// entry points: big-endian data (straight from the camera) with swap set,
+// native little-endian data (OV7670_COM3_SWAP) without, so that version
+// has no per-pixel byte swaps at all. The original functions without
+// _order assume big-endian, as before.
+#define OV7670_SPECIALIZE static inline __attribute__((always_inline))
+
+// Row buffers of the 3x3 filters (see the median notes further down), and
+// of 5x5 convolution, are this many rows longer than the window (size 3
+// or 5), and this many bytes per channel.
+#define OV7670_FILTER_SLACK 32
+#define OV7670_FILTER_CHANNEL_BYTES(width, size)                               \
+  ((uint32_t)((width) + (size)-1) * (size) + OV7670_FILTER_SLACK)
+
+// Convolution's row buffers for three channels, 32-bit aligned, then two
+// rows of 16-bit column sums for separable kernels.
+#define OV7670_CONV_ROWS_BYTES(width, size)                                    \
+  ((OV7670_FILTER_CHANNEL_BYTES(width, size) * 3 + 3) & ~3)
+#define OV7670_CONV_BYTES(width, size)                                         \
+  (OV7670_CONV_ROWS_BYTES(width, size) + (uint32_t)((width) + (size)-1) * 4)
+
+// Pixel to/from native RGB565, if swap is set
+OV7670_SPECIALIZE uint16_t ov7670_swap(uint16_t pixel, bool swap) {
+  return swap ? __builtin_bswap16(pixel) : pixel;
+}
+
+OV7670_view OV7670_view_frame(OV7670_colorspace space, OV7670_order order,
+                              uint16_t *pixels, uint16_t width,
+                              uint16_t height) {
+  OV7670_view view = {pixels, width, height, (uint32_t)width * 2, space,
+                      order};
+  return view;
+}
+
+OV7670_view OV7670_view_crop(const OV7670_view *view, uint16_t x,
+                             uint16_t y, uint16_t width, uint16_t height) {
+  OV7670_view crop = *view;
+  if ((x >= view->width) || (y >= view->height)) {
+    crop.width = crop.height = 0;
+  } else {
+    if (width > view->width - x) {
+      width = view->width - x;
+    }
+    if (height > view->height - y) {
+      height = view->height - y;
+    }
+    crop.pixels = OV7670_view_row(view, y) + x;
+    crop.width = width;
+    crop.height = height;
+  }
+  return crop;
+}
+
+void OV7670_scratch_init(OV7670_scratch *scratch, void *base,
+                         uint32_t size) {
+  scratch->base = (uint8_t *)base;
+  scratch->size = size;
+  scratch->used = 0;
+}
+
+uint32_t OV7670_scratch_bytes(uint16_t width, uint8_t radius) {
+  uint32_t bytes = OV7670_CONV_BYTES(width, 3); // 3x3 filters, the most
+  if (radius > 7) {
+    radius = 7;
+  }
+  if (radius > 1) { // Larger medians, 5x5 convolution
+    uint32_t median = (uint32_t)(width + radius * 2) * (radius * 2 + 1) * 3;
+    bytes = OV7670_CONV_BYTES(width, 5);
+    if (median > bytes) {
+      bytes = median;
+    }
+  }
+  return (bytes + 3) & ~3; // As rounded by ov7670_scratch_alloc()
+}
+
+// Working memory for a filter: from the caller's scratch arena if given,
+// else the heap. Arena blocks are 32-bit aligned and handed out in
+// sequence, so must be freed in reverse order.
+static void *ov7670_scratch_alloc(OV7670_scratch *scratch, uint32_t bytes) {
+  if (!scratch) {
+    return malloc(bytes);
+  }
+  bytes = (bytes + 3) & ~3;
+  if (bytes > scratch->size - scratch->used) {
+    return NULL;
+  }
+  void *ptr = &scratch->base[scratch->used];
+  scratch->used += bytes;
+  return ptr;
+}
+
+static void ov7670_scratch_free(OV7670_scratch *scratch, void *ptr) {
+  if (!scratch) {
+    free(ptr);
+  } else {
+    scratch->used = (uint8_t *)ptr - scratch->base;
+  }
+}
+
+// Point ops (the same thing to every pixel) don't care where rows break,
+// so a view is handled as a series of runs of consecutive pixels: just
+// one run for a packed image, else one per row. Returns the number of
+// runs, and sets run_pixels to the length of each.
+static uint16_t ov7670_runs(const OV7670_view *view, uint32_t *run_pixels) {
+  *run_pixels = view->width;
+  if (view->stride == (uint32_t)view->width * 2) {
+    *run_pixels *= view->height;
+    return view->height ? 1 : 0;
+  }
+  return view->height;
+}
+
+// Ops that look at neighboring pixels (mosaic, median, edges) handle YUV
+// as separate 8-bit planes, no unpacking: Y for every pixel, and U and V
+// each shared by a pair of pixels, so half as many across. Y is the first
+// byte of each pixel in big-endian order, the second in little; U and V
+// are the other byte, of even and odd pixels respectively.
+typedef struct {
+  uint8_t *base;   // First sample of top row
+  uint32_t stride; // Bytes from one row to the next
+  uint16_t width;  // Samples per row (0 if none, e.g. V of 1 pixel)
+  uint16_t height; // Rows
+  uint8_t step;    // Bytes from one sample to the next along a row
+} ov7670_plane;
+
+// Y (0), U (1) or V (2) plane of a YUV view.
+static ov7670_plane ov7670_yuv_plane(const OV7670_view *view, uint8_t which) {
+  ov7670_plane plane;
+  uint8_t luma = (view->order == OV7670_ORDER_BIG) ? 0 : 1; // Y byte
+  plane.base = (uint8_t *)view->pixels;
+  plane.stride = view->stride;
+  plane.height = view->height;
+  if (which == 0) {
+    plane.base += luma;
+    plane.width = view->width;
+    plane.step = 2;
+  } else {
+    plane.base += (luma ^ 1) + (which - 1) * 2;
+    plane.width = (which == 1) ? (view->width + 1) / 2 : view->width / 2;
+    plane.step = 4;
+  }
+  return plane;
+}
+
+// First sample of row y of a plane.
+static inline uint8_t *ov7670_plane_row(const ov7670_plane *plane,
+                                        uint16_t y) {
+  return plane->base + (uint32_t)y * plane->stride;
+}
+
 // Negative image (avoiding 'invert' terminology as that could be confused
 // for an image flip operation, which is a different function).
 void OV7670_image_negative(uint16_t *pixels, uint16_t width, uint16_t height) {
-  // Working 32 bits at a time is slightly faster. This is dirty pool,
-  // relying on the fact that the camera lib currently only supports
-  // even image sizes (the pixel count will always be a multiple of 2)
-  // and that the image buffer, coming from malloc(), will always be
-  // on a 32-bit-safe boundary. This is one of those operations that
-  // can probably be implemented through the camera's gamma curve
+  OV7670_view view = OV7670_view_frame(OV7670_COLOR_RGB, OV7670_ORDER_BIG,
+                                       pixels, width, height);
+  OV7670_image_negative_view(&view);
+}
+
+void OV7670_image_negative_view(const OV7670_view *view) {
+  // Working 32 bits at a time is slightly faster. The camera lib only
+  // supports even image sizes, and a whole frame from malloc() is on a
+  // 32-bit-safe boundary, but a cropped view might be neither, so odd
+  // runs or starts fall back on 16 bits. This is one of those operations
+  // that can probably be implemented through the camera's gamma curve
   // settings, and if so this function will go away.
-  uint32_t *p32 = (uint32_t *)pixels;
-  uint32_t i, num_pairs = width * height / 2;
-  for (i = 0; i < num_pairs; i++) {
-    p32[i] ^= 0xFFFFFFFF;
+  uint32_t i, run_pixels;
+  uint16_t runs = ov7670_runs(view, &run_pixels);
+  for (uint16_t r = 0; r < runs; r++) {
+    uint16_t *p16 = OV7670_view_row(view, r);
+    if (!(run_pixels & 1) && !((uintptr_t)p16 & 3)) {
+      uint32_t *p32 = (uint32_t *)p16;
+      uint32_t num_pairs = run_pixels / 2;
+      for (i = 0; i < num_pairs; i++) {
+        p32[i] ^= 0xFFFFFFFF;
+      }
+    } else {
+      for (i = 0; i < run_pixels; i++) {
+        p16[i] ^= 0xFFFF;
+      }
+    }
+  }
+}
+
+// Binary threshold of RGB565 pixels, swap as per ov7670_swap().
+OV7670_SPECIALIZE void ov7670_threshold_rgb(uint16_t *pixels,
+                                            uint32_t num_pixels,
+                                            uint8_t threshold, bool swap) {
+  // Testing RGB thresholds "in place" in the packed RGB565 value
+  // avoids some bit-shifting on every pixel (just bit masking).
+  uint16_t rlimit = (threshold >> 3) << 11; // In-place 565 red threshold
+  uint16_t glimit = (threshold >> 2) << 5;  // In-place 565 green threshold
+  uint16_t blimit = (threshold >> 3);       // In-place 565 blue threshold
+  uint16_t rgb565in, rgb565out;             // Packed RGB565 pixel values
+  for (uint32_t i = 0; i < num_pixels; i++) { // For each pixel...
+    rgb565in = ov7670_swap(pixels[i], swap);  //   Native endian if needed
+    rgb565out = 0;                            //   Start with 0 result
+    if ((rgb565in & 0xF800) >= rlimit) {      //   If red exceeds limit
+      rgb565out |= 0xF800;                    //     Set all red bits
+    }
+    if ((rgb565in & 0x07E0) >= glimit) { //   Ditto, green
+      rgb565out |= 0x07E0;
+    }
+    if ((rgb565in & 0x001F) >= blimit) { //   Ditto, blue
+      rgb565out |= 0x001F;
+    }
+    pixels[i] = ov7670_swap(rgb565out, swap); //   Back to buffer's endian
   }
 }
 
@@ -31,41 +226,72 @@ void OV7670_image_negative(uint16_t *pixels, uint16_t width, uint16_t height) {
 void OV7670_image_threshold(OV7670_colorspace space, uint16_t *pixels,
                             uint16_t width, uint16_t height,
                             uint8_t threshold) {
-  uint32_t i, num_pixels = width * height;
-  if (space == OV7670_COLOR_RGB) {
-    // Testing RGB thresholds "in place" in the packed RGB565 value
-    // avoids some bit-shifting on every pixel (just bit masking).
-    uint16_t rlimit = (threshold >> 3) << 11;  // In-place 565 red threshold
-    uint16_t glimit = (threshold >> 2) << 5;   // In-place 565 green threshold
-    uint16_t blimit = (threshold >> 3);        // In-place 565 blue threshold
-    uint16_t rgb565in, rgb565out;              // Packed RGB565 pixel values
-    for (i = 0; i < num_pixels; i++) {         // For each pixel...
-      rgb565in = __builtin_bswap16(pixels[i]); //   Swap endian from cam
-      rgb565out = 0;                           //   Start with 0 result
-      if ((rgb565in & 0xF800) >= rlimit) {     //   If red exceeds limit
-        rgb565out |= 0xF800;                   //     Set all red bits
-      }
-      if ((rgb565in & 0x07E0) >= glimit) { //   Ditto, green
-        rgb565out |= 0x07E0;
+  OV7670_image_threshold_order(space, OV7670_ORDER_BIG, pixels, width,
+                               height, threshold);
+}
+
+void OV7670_image_threshold_order(OV7670_colorspace space,
+                                  OV7670_order order, uint16_t *pixels,
+                                  uint16_t width, uint16_t height,
+                                  uint8_t threshold) {
+  OV7670_view view = OV7670_view_frame(space, order, pixels, width, height);
+  OV7670_image_threshold_view(&view, threshold);
+}
+
+void OV7670_image_threshold_view(const OV7670_view *view, uint8_t threshold) {
+  uint32_t i, num_pixels;
+  uint16_t runs = ov7670_runs(view, &num_pixels);
+  for (uint16_t r = 0; r < runs; r++) {
+    uint16_t *pixels = OV7670_view_row(view, r);
+    if (view->space == OV7670_COLOR_RGB) {
+      if (view->order == OV7670_ORDER_BIG) {
+        ov7670_threshold_rgb(pixels, num_pixels, threshold, true);
+      } else {
+        ov7670_threshold_rgb(pixels, num_pixels, threshold, false);
       }
-      if ((rgb565in & 0x001F) >= blimit) { //   Ditto, blue
-        rgb565out |= 0x001F;
+    } else {                                    // YUV...
+      uint8_t *p8 = (uint8_t *)pixels;          // Separate Y's, U's, V's
+      uint32_t num_bytes = num_pixels * 2;      // 2 per pixel
+      for (i = 0; i < num_bytes; i++) {         // For each byte...
+        p8[i] = (p8[i] >= threshold) ? 255 : 0; //   Threshold to 0 or 255
       }
-      pixels[i] = __builtin_bswap16(rgb565out); //   Back to cam-native endian
-    }
-  } else {                                    // YUV...
-    uint8_t *p8 = (uint8_t *)pixels;          // Separate Y's, U's, V's
-    num_pixels *= 2;                          // Actually num bytes now
-    for (i = 0; i < num_pixels; i++) {        // For each byte...
-      p8[i] = (p8[i] >= threshold) ? 255 : 0; //   Threshold to 0 or 255
     }
   }
 }
 
+// Remap RGB565 pixels through posterize tables, swap per ov7670_swap().
+OV7670_SPECIALIZE void ov7670_posterize_rgb(uint16_t *pixels,
+                                            uint32_t num_pixels,
+                                            const uint16_t *rtable,
+                                            const uint16_t *gtable,
+                                            const uint8_t *btable,
+                                            bool swap) {
+  for (uint32_t i = 0; i < num_pixels; i++) {    // For each pixel...
+    uint16_t rgb = ov7670_swap(pixels[i], swap); // Native endian if needed
+    // Dismantle RGB into components, remap each through color table
+    rgb = rtable[rgb >> 11] | gtable[(rgb >> 6) & 31] | btable[rgb & 31];
+    pixels[i] = ov7670_swap(rgb, swap); // Back to buffer's endian
+  }
+}
+
 // Reduce color fidelity to a specified number of steps or levels.
 void OV7670_image_posterize(OV7670_colorspace space, uint16_t *pixels,
                             uint16_t width, uint16_t height, uint8_t levels) {
-  uint32_t i, num_pixels = width * height;
+  OV7670_image_posterize_order(space, OV7670_ORDER_BIG, pixels, width,
+                               height, levels);
+}
+
+void OV7670_image_posterize_order(OV7670_colorspace space,
+                                  OV7670_order order, uint16_t *pixels,
+                                  uint16_t width, uint16_t height,
+                                  uint8_t levels) {
+  OV7670_view view = OV7670_view_frame(space, order, pixels, width, height);
+  OV7670_image_posterize_view(&view, levels);
+}
+
+void OV7670_image_posterize_view(const OV7670_view *view, uint8_t levels) {
+  uint32_t i, num_pixels;
+  uint16_t r, runs = ov7670_runs(view, &num_pixels);
 
   if (levels < 1) {
     levels = 1;
@@ -73,7 +299,7 @@ void OV7670_image_posterize(OV7670_colorspace space, uint16_t *pixels,
   uint8_t lm1 = levels - 1; // Values used in fixed-
   uint8_t lm1d2 = lm1 / 2;  // point interpolation
 
-  if (space == OV7670_COLOR_RGB) {
+  if (view->space == OV7670_COLOR_RGB) {
     if (levels >= 32) {
       return;
     } else {
@@ -84,18 +310,22 @@ void OV7670_image_posterize(OV7670_colorspace space, uint16_t *pixels,
       // of green would make for posterization thresholds that are not
       // uniform and may have weird halos. So the input is decimated to
       // RGB555, posterized, and result scaled to RGB565.
-      uint16_t rtable[32], gtable[32], rgb;
+      uint16_t rtable[32], gtable[32];
       uint8_t btable[32];
       for (i = 0; i < 32; i++) { // 5 bits each
         btable[i] = (((i * levels + lm1d2) / 32) * 31 + lm1d2) / lm1;
         rtable[i] = btable[i] << 11;
         gtable[i] = (btable[i] << 6) | ((btable[i] & 0x10) << 1);
       }
-      for (i = 0; i < num_pixels; i++) {    // For each pixel...
-        rgb = __builtin_bswap16(pixels[i]); // Data from camera is big-endian
-        // Dismantle RGB into components, remap each through color table
-        rgb = rtable[rgb >> 11] | gtable[(rgb >> 6) & 31] | btable[rgb & 31];
-        pixels[i] = __builtin_bswap16(rgb); // Back to big-endian
+      for (r = 0; r < runs; r++) {
+        uint16_t *pixels = OV7670_view_row(view, r);
+        if (view->order == OV7670_ORDER_BIG) {
+          ov7670_posterize_rgb(pixels, num_pixels, rtable, gtable, btable,
+                               true);
+        } else {
+          ov7670_posterize_rgb(pixels, num_pixels, rtable, gtable, btable,
+                               false);
+        }
       }
     }
   } else { // YUV
@@ -106,19 +336,281 @@ void OV7670_image_posterize(OV7670_colorspace space, uint16_t *pixels,
       for (i = 0; i < 256; i++) {
         table[i] = (((i * levels + lm1d2) / 256) * 255 + lm1d2) / lm1;
       }
-      uint8_t *p8 = (uint8_t *)pixels;   // Separate Ys, Us, Vs
-      num_pixels *= 2;                   // Actually num bytes now
-      for (i = 0; i < num_pixels; i++) { // For each byte...
-        p8[i] = table[p8[i]];            //   Remap through lookup table
+      uint32_t num_bytes = num_pixels * 2; // 2 per pixel
+      for (r = 0; r < runs; r++) {
+        // Separate Ys, Us, Vs
+        uint8_t *p8 = (uint8_t *)OV7670_view_row(view, r);
+        for (i = 0; i < num_bytes; i++) { // For each byte...
+          p8[i] = table[p8[i]];           //   Remap through lookup table
+        }
+      }
+    }
+  }
+}
+
+// POINT OP PIPELINE -------------------------------------------------------
+
+// Negative, threshold and posterize each work on channels independently
+// (RGB565 red, green and blue, or YUV bytes), so a chain of them reduces
+// to per-channel tables, composed here by running every possible channel
+// value through each step in turn. The math matches the single-op
+// functions above, so results are identical to calling those in series.
+
+// One step applied to one channel value, 0 to max (31 or 63 for RGB565
+// red/blue and green, 255 for YUV bytes).
+static uint8_t ov7670_point(OV7670_point_op op, uint8_t param, uint8_t value,
+                            uint8_t max) {
+  uint8_t levels, lm1, lm1d2;
+  switch (op) {
+  case OV7670_POINT_NEGATIVE:
+    return max - value;
+  case OV7670_POINT_THRESHOLD: // Param is 0-255, scaled to channel range
+    return (value >= param * (max + 1) / 256) ? max : 0;
+  case OV7670_POINT_POSTERIZE:
+    levels = (param < 2) ? 2 : param;
+    lm1 = levels - 1;
+    lm1d2 = lm1 / 2;
+    if (max == 255) {
+      return (levels == 255)
+                 ? value
+                 : (((value * levels + lm1d2) / 256) * 255 + lm1d2) / lm1;
+    }
+    if (levels >= 32) {
+      return value;
+    }
+    if (max == 63) { // Green is posterized as 5 bits, then scaled to 6
+      value = ((((value >> 1) * levels + lm1d2) / 32) * 31 + lm1d2) / lm1;
+      return (value << 1) | (value >> 4);
+    }
+    return (((value * levels + lm1d2) / 32) * 31 + lm1d2) / lm1;
+  }
+  return value;
+}
+
+// Run every step of a pipeline on one channel value.
+static uint8_t ov7670_pipeline_eval(const OV7670_pipeline *pipeline,
+                                    uint8_t value, uint8_t max) {
+  for (uint8_t i = 0; i < pipeline->num_steps; i++) {
+    value = ov7670_point(pipeline->step[i].op, pipeline->step[i].param, value,
+                         max);
+  }
+  return value;
+}
+
+void OV7670_pipeline_init(OV7670_pipeline *pipeline, uint16_t *lut) {
+  pipeline->lut = lut;
+  pipeline->swap = false;
+  pipeline->lut_valid = false;
+  OV7670_pipeline_clear(pipeline);
+}
+
+void OV7670_pipeline_clear(OV7670_pipeline *pipeline) {
+  pipeline->num_steps = 0;
+  pipeline->dirty = true;
+}
+
+int8_t OV7670_pipeline_add(OV7670_pipeline *pipeline, OV7670_point_op op,
+                           uint8_t param) {
+  if (pipeline->num_steps >= OV7670_PIPELINE_MAX) {
+    return -1;
+  }
+  pipeline->step[pipeline->num_steps].op = op;
+  pipeline->step[pipeline->num_steps].param = param;
+  pipeline->dirty = true;
+  return pipeline->num_steps++;
+}
+
+void OV7670_pipeline_set(OV7670_pipeline *pipeline, uint8_t index,
+                         uint8_t param) {
+  if ((index < pipeline->num_steps) &&
+      (pipeline->step[index].param != param)) {
+    pipeline->step[index].param = param;
+    pipeline->dirty = true;
+  }
+}
+
+void OV7670_pipeline_swap(OV7670_pipeline *pipeline, bool swap) {
+  if (pipeline->swap != swap) {
+    pipeline->swap = swap;
+    pipeline->lut_valid = false; // Channel tables are unaffected
+  }
+}
+
+// Rebuild channel tables after steps change. The full table, if any, is
+// derived from these, so it's invalidated and rebuilt on demand.
+static void ov7670_pipeline_build(OV7670_pipeline *pipeline) {
+  uint16_t i;
+  for (i = 0; i < 256; i++) {
+    pipeline->yuv[i] = ov7670_pipeline_eval(pipeline, i, 255);
+  }
+  for (i = 0; i < 32; i++) {
+    pipeline->red[i] = ov7670_pipeline_eval(pipeline, i, 31) << 11;
+    pipeline->blue[i] = ov7670_pipeline_eval(pipeline, i, 31);
+  }
+  for (i = 0; i < 64; i++) {
+    pipeline->green[i] = ov7670_pipeline_eval(pipeline, i, 63) << 5;
+  }
+  pipeline->dirty = false;
+  pipeline->lut_valid = false;
+}
+
+// Full table is indexed by pixels exactly as stored, and holds results
+// exactly as they'll be stored, so byte order (and any swap between in
+// and out) costs nothing per pixel.
+static void ov7670_pipeline_build_lut(OV7670_pipeline *pipeline,
+                                      OV7670_order order) {
+  bool swap_in = (order == OV7670_ORDER_BIG);
+  bool swap_out = swap_in ^ pipeline->swap;
+  uint32_t i;
+  for (i = 0; i < 65536; i++) {
+    uint16_t rgb = swap_in ? __builtin_bswap16(i) : i;
+    rgb = pipeline->red[rgb >> 11] | pipeline->green[(rgb >> 5) & 63] |
+          pipeline->blue[rgb & 31];
+    pipeline->lut[i] = swap_out ? __builtin_bswap16(rgb) : rgb;
+  }
+  pipeline->lut_order = order;
+  pipeline->lut_valid = true;
+}
+
+// Per-channel table lookup of RGB565 pixels, swapping on the way in
+// and/or out as per ov7670_swap().
+OV7670_SPECIALIZE void ov7670_pipeline_rgb(const OV7670_pipeline *pipeline,
+                                           uint16_t *pixels,
+                                           uint32_t num_pixels, bool swap_in,
+                                           bool swap_out) {
+  const uint16_t *red = pipeline->red, *green = pipeline->green;
+  const uint16_t *blue = pipeline->blue;
+  for (uint32_t i = 0; i < num_pixels; i++) {
+    uint16_t rgb = ov7670_swap(pixels[i], swap_in);
+    rgb = red[rgb >> 11] | green[(rgb >> 5) & 63] | blue[rgb & 31];
+    pixels[i] = ov7670_swap(rgb, swap_out);
+  }
+}
+
+void OV7670_pipeline_apply(OV7670_pipeline *pipeline,
+                           const OV7670_view *view) {
+  uint32_t i, num_pixels;
+  uint16_t r, runs = ov7670_runs(view, &num_pixels);
+  if (pipeline->dirty) {
+    ov7670_pipeline_build(pipeline);
+  }
+  if (view->space == OV7670_COLOR_YUV) {
+    uint32_t num_bytes = num_pixels * 2; // 2 per pixel
+    for (r = 0; r < runs; r++) {
+      uint8_t *p8 = (uint8_t *)OV7670_view_row(view, r);
+      for (i = 0; i < num_bytes; i++) {
+        p8[i] = pipeline->yuv[p8[i]];
+      }
+    }
+  } else if (pipeline->lut) {
+    if (!pipeline->lut_valid || (pipeline->lut_order != view->order)) {
+      ov7670_pipeline_build_lut(pipeline, view->order);
+    }
+    const uint16_t *lut = pipeline->lut;
+    for (r = 0; r < runs; r++) {
+      uint16_t *pixels = OV7670_view_row(view, r);
+      for (i = 0; i < num_pixels; i++) {
+        pixels[i] = lut[pixels[i]];
+      }
+    }
+  } else {
+    bool big = (view->order == OV7670_ORDER_BIG);
+    for (r = 0; r < runs; r++) {
+      uint16_t *pixels = OV7670_view_row(view, r);
+      if (big) {
+        if (pipeline->swap) {
+          ov7670_pipeline_rgb(pipeline, pixels, num_pixels, true, false);
+        } else {
+          ov7670_pipeline_rgb(pipeline, pixels, num_pixels, true, true);
+        }
+      } else {
+        if (pipeline->swap) {
+          ov7670_pipeline_rgb(pipeline, pixels, num_pixels, false, true);
+        } else {
+          ov7670_pipeline_rgb(pipeline, pixels, num_pixels, false, false);
+        }
       }
     }
   }
 }
 
+// Mosaic of RGB565 pixels, swap as per ov7670_swap(). Tile sizes are
+// validated by the caller.
+OV7670_SPECIALIZE void ov7670_mosaic_rgb(const OV7670_view *view,
+                                         uint8_t tile_width,
+                                         uint8_t tile_height, bool swap) {
+  uint16_t width = view->width, height = view->height;
+  uint16_t tiles_across = (width + (tile_width - 1)) / tile_width;
+  uint16_t tiles_down = (height + (tile_height - 1)) / tile_height;
+  uint16_t tile_x, tile_y;
+  uint16_t x1, x2, y1, y2, xx, yy; // Tile bounds, counters
+  uint32_t pixels_in_tile;
+  uint16_t rgb;
+  uint32_t red_sum, green_sum, blue_sum;
+  uint16_t *row, *first_row;
+  for (y1 = tile_y = 0; tile_y < tiles_down; tile_y++) { // Each tile row...
+    y2 = y1 + tile_height - 1; // Last pixel row in current tile row
+    if (y2 >= height) {        // Clip to bottom of image
+      y2 = height - 1;
+    }
+    // Recalc this each tile row because tile x loop may alter it:
+    pixels_in_tile = tile_width * (y2 - y1 + 1);
+    for (x1 = tile_x = 0; tile_x < tiles_across;
+         tile_x++) {            // Each tile column...
+      x2 = x1 + tile_width - 1; // Last pixel column in current tile column
+      if (x2 >= width) {        // Clip to right of image
+        x2 = width - 1;
+        pixels_in_tile = (x2 - x1 + 1) * (y2 - y1 + 1);
+      }
+      // Accumulate red, green, blue sums for all pixels in tile
+      red_sum = green_sum = blue_sum = 0;
+      for (yy = y1; yy <= y2; yy++) { // Each pixel row in tile...
+        row = OV7670_view_row(view, yy);
+        for (xx = x1; xx <= x2; xx++) { // Each pixel column in tile...
+          rgb = ov7670_swap(row[xx], swap);
+          red_sum += rgb & 0b1111100000000000;   // Accumulate in-place,
+          green_sum += rgb & 0b0000011111100000; // no shift down needed
+          blue_sum += rgb & 0b0000000000011111;
+        }
+      }
+      red_sum = (red_sum / pixels_in_tile) & 0b1111100000000000;
+      green_sum = (green_sum / pixels_in_tile) & 0b0000011111100000;
+      blue_sum = (blue_sum / pixels_in_tile) & 0b0000000000011111;
+      rgb = ov7670_swap(red_sum | green_sum | blue_sum, swap);
+      row = OV7670_view_row(view, y1); // First row of tile
+      for (xx = x1; xx <= x2; xx++) {  // Overwrite top row of tile
+        row[xx] = rgb;                 // with averaged tile value
+      }
+      x1 += tile_width; // Advance pixel index by one tile column
+    }
+    // Duplicate scanlines to fill tiles on Y axis
+    first_row = OV7670_view_row(view, y1);
+    for (yy = y1 + 1; yy <= y2;
+         yy++) { // Each subsequent pixel row in tiles...
+      memcpy(OV7670_view_row(view, yy), first_row, width * 2);
+    }
+    y1 += tile_height; // Advance pixel index by one tile row
+  }
+}
+
 // Shower door effect.
 void OV7670_image_mosaic(OV7670_colorspace space, uint16_t *pixels,
                          uint16_t width, uint16_t height, uint8_t tile_width,
                          uint8_t tile_height) {
+  OV7670_image_mosaic_order(space, OV7670_ORDER_BIG, pixels, width, height,
+                            tile_width, tile_height);
+}
+
+void OV7670_image_mosaic_order(OV7670_colorspace space, OV7670_order order,
+                               uint16_t *pixels, uint16_t width,
+                               uint16_t height, uint8_t tile_width,
+                               uint8_t tile_height) {
+  OV7670_view view = OV7670_view_frame(space, order, pixels, width, height);
+  OV7670_image_mosaic_view(&view, tile_width, tile_height);
+}
+
+void OV7670_image_mosaic_view(const OV7670_view *view, uint8_t tile_width,
+                              uint8_t tile_height) {
   if ((tile_width <= 1) && (tile_height <= 1)) {
     return;
   }
@@ -129,65 +621,68 @@ void OV7670_image_mosaic(OV7670_colorspace space, uint16_t *pixels,
     tile_height = 1;
   }
 
-  uint8_t tiles_across = (width + (tile_width - 1)) / tile_width;
-  uint8_t tiles_down = (height + (tile_height - 1)) / tile_height;
-  uint16_t tile_x, tile_y;
-  uint16_t x1, x2, y1, y2, xx, yy; // Tile bounds, counters
-  uint32_t pixels_in_tile;
+  if (view->space == OV7670_COLOR_RGB) {
+    if (view->order == OV7670_ORDER_BIG) {
+      ov7670_mosaic_rgb(view, tile_width, tile_height, true);
+    } else {
+      ov7670_mosaic_rgb(view, tile_width, tile_height, false);
+    }
+  } else { // YUV, brightness only
+    OV7670_image_mosaic_yuv(view, tile_width, tile_height, false);
+  }
+}
 
-  if (space == OV7670_COLOR_RGB) {
-    uint16_t rgb;
-    uint32_t red_sum, green_sum, blue_sum;
-    uint32_t yy1, yy2;
-    for (y1 = tile_y = 0; tile_y < tiles_down; tile_y++) { // Each tile row...
-      y2 = y1 + tile_height - 1; // Last pixel row in current tile row
-      if (y2 >= height) {        // Clip to bottom of image
-        y2 = height - 1;
-      }
-      // Recalc this each tile row because tile x loop may alter it:
-      pixels_in_tile = tile_width * (y2 - y1 + 1);
-      for (x1 = tile_x = 0; tile_x < tiles_across;
-           tile_x++) {            // Each tile column...
-        x2 = x1 + tile_width - 1; // Last pixel column in current tile column
-        if (x2 >= width) {        // Clip to right of image
-          x2 = width - 1;
-          pixels_in_tile = (x2 - x1 + 1) * (y2 - y1 + 1);
+// Mosaic of one YUV plane, each tile written out whole (plane rows can't
+// be memcpy()'d, samples are interleaved with the other planes).
+static void ov7670_mosaic_plane(const ov7670_plane *plane, uint8_t tile_width,
+                                uint8_t tile_height) {
+  uint16_t x1, x2, y1, y2, xx, yy; // Tile bounds (x2, y2 exclusive)
+  uint8_t step = plane->step, *row;
+  for (y1 = 0; y1 < plane->height; y1 = y2) { // Each tile row...
+    y2 = (plane->height - y1 > tile_height) ? y1 + tile_height : plane->height;
+    for (x1 = 0; x1 < plane->width; x1 = x2) { // Each tile column...
+      x2 = (plane->width - x1 > tile_width) ? x1 + tile_width : plane->width;
+      uint32_t sum = 0;
+      for (yy = y1; yy < y2; yy++) {
+        row = ov7670_plane_row(plane, yy);
+        for (xx = x1; xx < x2; xx++) {
+          sum += row[xx * step];
         }
-        // Accumulate red, green, blue sums for all pixels in tile
-        red_sum = green_sum = blue_sum = 0;
-        yy2 = y1 * width;                 // Index of first pixel in tile
-        for (yy = y1; yy <= y2; yy++) {   // Each pixel row in tile...
-          for (xx = x1; xx <= x2; xx++) { // Each pixel column in tile...
-            rgb = __builtin_bswap16(pixels[yy2 + xx]);
-            red_sum += rgb & 0b1111100000000000;   // Accumulate in-place,
-            green_sum += rgb & 0b0000011111100000; // no shift down needed
-            blue_sum += rgb & 0b0000000000011111;
-          }
-          yy2 += width; // Advance by one image row
-        }
-        red_sum = (red_sum / pixels_in_tile) & 0b1111100000000000;
-        green_sum = (green_sum / pixels_in_tile) & 0b0000011111100000;
-        blue_sum = (blue_sum / pixels_in_tile) & 0b0000000000011111;
-        rgb = __builtin_bswap16(red_sum | green_sum | blue_sum);
-        yy2 = y1 * width;               // Index of first pixel in tile
-        for (xx = x1; xx <= x2; xx++) { // Overwrite top row of tile
-          pixels[yy2 + xx] = rgb;       // with averaged tile value
-        }
-        x1 += tile_width; // Advance pixel index by one tile column
       }
-      // Duplicate scanlines to fill tiles on Y axis
-      yy1 = y1 * width;  // Index of first pixel in tile
-      yy2 = yy1 + width; // Index of pixel one row down
-      for (yy = y1 + 1; yy <= y2;
-           yy++) { // Each subsequent pixel row in tiles...
-        memcpy(&pixels[yy2], &pixels[yy1], width * 2);
-        yy2 += width; // Advance destination index by one row
+      uint8_t average = sum / ((uint32_t)(x2 - x1) * (y2 - y1));
+      for (yy = y1; yy < y2; yy++) {
+        row = ov7670_plane_row(plane, yy);
+        for (xx = x1; xx < x2; xx++) {
+          row[xx * step] = average;
+        }
       }
-      y1 += tile_height; // Advance pixel index by one tile row
     }
-  } else { // YUV
-    // YUV is not handled yet because it's weird, with U & V
-    // on alternating pixels. This will require Some Doing.
+  }
+}
+
+void OV7670_image_mosaic_yuv(const OV7670_view *view, uint8_t tile_width,
+                             uint8_t tile_height, bool chroma) {
+  if (view->space != OV7670_COLOR_YUV) {
+    OV7670_image_mosaic_view(view, tile_width, tile_height);
+    return;
+  }
+  if ((tile_width <= 1) && (tile_height <= 1)) {
+    return;
+  }
+  if (tile_width < 1) {
+    tile_width = 1;
+  }
+  if (tile_height < 1) {
+    tile_height = 1;
+  }
+  ov7670_plane plane = ov7670_yuv_plane(view, 0);
+  ov7670_mosaic_plane(&plane, tile_width, tile_height);
+  if (chroma) { // Chroma tiles are half as wide, in samples
+    uint8_t chroma_width = (tile_width + 1) / 2;
+    for (uint8_t p = 1; p <= 2; p++) {
+      plane = ov7670_yuv_plane(view, p);
+      ov7670_mosaic_plane(&plane, chroma_width, tile_height);
+    }
   }
 }
 
@@ -208,7 +703,7 @@ void OV7670_image_mosaic(OV7670_colorspace space, uint16_t *pixels,
 //   comparing colors in inner loops. The 3 rows cycle while working down
 //   the image -- the 'current' row becomes the 'prior' row, the 'next'
 //   row becomes the 'current' row, and a new 'next' row is converted.
-//   Requires about 3.6K RAM overhead for a 320x240 pixel image.
+//   Requires about 3K RAM overhead for a 320 pixel wide image.
 //   Having these row buffers also means results can be written directly
 //   back into the 'current' row of the image without corrupting the
 //   results of 3x3 operations on the subsequent row.
@@ -259,7 +754,10 @@ void OV7670_image_mosaic(OV7670_colorspace space, uint16_t *pixels,
 //   string (equal to the image height) let us make the vertical change
 //   without having to move or copy any existing data to new locations,
 //   just load the new bytes. That's why the buffer allocation is somewhat
-//   more than (width * 3).
+//   more than (width * 3). The string is only OV7670_FILTER_SLACK pixels
+//   longer than the coil, though, not the image height, so memory needed
+//   depends on width alone: each time the end is reached, the rows in use
+//   are copied back to the start (a few hundred bytes, every 32 rows).
 //
 //         0 <- first byte in buffer
 //         |
@@ -273,8 +771,14 @@ void OV7670_image_mosaic(OV7670_colorspace space, uint16_t *pixels,
 //
 // - Back to the median filter specifically: finding the median in a
 //   9-element (3x3) list doesn't require sorting the whole list as is
-//   typically described. It's sufficient to identify the maximum of the
-//   least five values, or minimum of largest five, same result all around.
+//   typically described. Sort each 3-pixel column instead (3 compare-
+//   and-swaps), and the median of the 3x3 is the median of three values:
+//   the max of the three column minimums, the median of the three column
+//   medians, and the min of the three column maximums. Each column is in
+//   three neighboring 3x3 squares, so sorting it once when it enters
+//   covers all of them; moving one pixel right costs one 3-sort plus the
+//   min/max/median picks. All are min() and max(), no data-dependent
+//   branches, so it's the same speed whatever the image.
 //
 // Thank you for coming to my TED Talk.
 
@@ -286,180 +790,371 @@ void OV7670_image_mosaic(OV7670_colorspace space, uint16_t *pixels,
 // median to operate on all source image pixels, no black border or other
 // uglies. Pixels within each channel are not sequential in memory, but
 // increment by 3's -- corresponding to the prior, current and next rows.
-static void OV7670_filter_row_prep(uint16_t *src, uint8_t *r_dst,
-                                   uint16_t width, uint32_t channel_bytes) {
+// Source pixels are byte swapped first if swap is set (big-endian data).
+// The same goes for a 5x5 window with size 5: pixels then increment by
+// 5's, and 2 are duplicated at each end.
+OV7670_SPECIALIZE void OV7670_filter_row_prep(uint16_t *src, uint8_t *r_dst,
+                                              uint16_t width,
+                                              uint32_t channel_bytes,
+                                              uint8_t size, bool swap) {
   uint8_t *g_dst = &r_dst[channel_bytes];
   uint8_t *b_dst = &g_dst[channel_bytes];
+  uint8_t pad = size / 2; // Pixels duplicated at each end
 
-  uint16_t x, rgb, offset = 3;
+  uint16_t x, rgb, offset = pad * size;
   for (x = 0; x < width; x++) {        // For each pixel in row...
-    rgb = __builtin_bswap16(*src++);   // Packed RGB565 pixel
+    rgb = ov7670_swap(*src++, swap);   // Packed RGB565 pixel
     r_dst[offset] = rgb >> 11;         // Extract 5 bits red,
     g_dst[offset] = (rgb >> 5) & 0x3F; // 6 bits green,
     b_dst[offset] = rgb & 0x1F;        // 5 bits blue
-    offset += 3;
+    offset += size;
+  }
+  uint16_t first = pad * size, last = offset - size;
+  for (uint8_t p = 0; p < pad; p++, offset += size) {
+    r_dst[p * size] = r_dst[first]; // Duplicate leftmost pixel
+    g_dst[p * size] = g_dst[first];
+    b_dst[p * size] = b_dst[first];
+    r_dst[offset] = r_dst[last]; // Duplicate rightmost pixel
+    g_dst[offset] = g_dst[last];
+    b_dst[offset] = b_dst[last];
   }
-  r_dst[0] = r_dst[3]; // Duplicate leftmost pixel
-  g_dst[0] = g_dst[3];
-  b_dst[0] = b_dst[3];
-  x = offset - 3;
-  r_dst[offset] = r_dst[x]; // Duplicate rightmost pixel
-  g_dst[offset] = g_dst[x];
-  b_dst[offset] = b_dst[x];
 }
 
-// Copy a single row in the 3x3 filter weird increment-by-3 pixel format.
+// Once the filter row buffers have been stepped down to the end of their
+// tail, copy the data in use (at offset 'row' in each channel) back to
+// the start of each.
+static void ov7670_filter_rewind(uint8_t *buf, uint16_t width,
+                                 uint32_t channel_bytes, uint16_t row,
+                                 uint8_t size) {
+  for (uint8_t c = 0; c < 3; c++, buf += channel_bytes) {
+    memmove(buf, &buf[row], (uint32_t)(width + size - 1) * size);
+  }
+}
+
+// Copy a single row in the filter weird increment-by-3 (or by-size) pixel
+// format.
 static void OV7670_filter_row_copy(uint8_t *r_src, uint8_t *r_dst,
-                                   uint16_t width, uint32_t channel_bytes) {
+                                   uint16_t width, uint32_t channel_bytes,
+                                   uint8_t size) {
   uint8_t *g_src = &r_src[channel_bytes];
   uint8_t *b_src = &g_src[channel_bytes];
   uint8_t *g_dst = &r_dst[channel_bytes];
   uint8_t *b_dst = &g_dst[channel_bytes];
-  uint16_t x, offset;
+  uint32_t x, offset;
 
-  for (x = offset = 0; x < width; x++, offset += 3) {
+  for (x = offset = 0; x < width; x++, offset += size) {
     r_dst[offset] = r_src[offset];
     g_dst[offset] = g_src[offset];
     b_dst[offset] = b_src[offset];
   }
 }
 
-// Determine median value of 9-element list
-static inline uint8_t OV7670_med9(uint8_t *list) {
+// Branch-free min, max and median of 8-bit values. Most compilers turn
+// these into conditional moves or select instructions.
+static inline uint8_t ov7670_min(uint8_t a, uint8_t b) { return a < b ? a : b; }
+static inline uint8_t ov7670_max(uint8_t a, uint8_t b) { return a < b ? b : a; }
+static inline uint8_t ov7670_med3(uint8_t a, uint8_t b, uint8_t c) {
+  return ov7670_max(ov7670_min(a, b), ov7670_min(ov7670_max(a, b), c));
+}
+
+// Sort one 3-pixel column of the filter row buffer into lo, mid, hi.
+#define OV7670_SORT3(col, lo, mid, hi)                                         \
+  {                                                                            \
+    uint8_t a = (col)[0], b = (col)[1], c = (col)[2];                          \
+    uint8_t ab_lo = ov7670_min(a, b), ab_hi = ov7670_max(a, b);                \
+    lo = ov7670_min(ab_lo, c);                                                 \
+    hi = ov7670_max(ab_hi, c);                                                 \
+    mid = ov7670_max(ab_lo, ov7670_min(ab_hi, c));                             \
+  }
+
+// 3x3 medians along one row of one channel in the filter row buffer
+// (see above). With step 0 they're ORed into uint16_t out[] at the given
+// bit position (RGB565), else stored as bytes step bytes apart (a YUV
+// plane). Columns are sorted once each, as they come in on the right,
+// then reused for the two pixels after.
+OV7670_SPECIALIZE void ov7670_median_row(const uint8_t *chan, void *out,
+                                         uint16_t width, uint8_t shift,
+                                         uint8_t step) {
+  uint8_t lo0, mid0, hi0, lo1, mid1, hi1, lo2, mid2, hi2; // Left to right
+  OV7670_SORT3(&chan[0], lo0, mid0, hi0);
+  OV7670_SORT3(&chan[3], lo1, mid1, hi1);
+  chan += 6;
+  for (uint16_t x = 0; x < width; x++, chan += 3) {
+    OV7670_SORT3(chan, lo2, mid2, hi2);
+    uint8_t lo = ov7670_max(ov7670_max(lo0, lo1), lo2);
+    uint8_t hi = ov7670_min(ov7670_min(hi0, hi1), hi2);
+    uint8_t median = ov7670_med3(lo, ov7670_med3(mid0, mid1, mid2), hi);
+    if (step) {
+      ((uint8_t *)out)[x * step] = median;
+    } else {
+      ((uint16_t *)out)[x] |= median << shift;
+    }
+    lo0 = lo1, mid0 = mid1, hi0 = hi1; // Slide right one column
+    lo1 = lo2, mid1 = mid2, hi1 = hi2;
+  }
+}
+
+// The RGB565 case, not inlined (it's used three times per row).
+static void ov7670_median_row_rgb(const uint8_t *chan, uint16_t *out,
+                                  uint16_t width, uint8_t shift) {
+  ov7670_median_row(chan, out, width, shift, 0);
+}
+
+// 3x3 median of RGB565 pixels, swap as per ov7670_swap().
+OV7670_SPECIALIZE OV7670_status ov7670_median_rgb(const OV7670_view *view,
+                                                  OV7670_scratch *scratch,
+                                                  bool swap) {
+  uint16_t width = view->width, height = view->height;
+  uint8_t *buf;
+  uint32_t buf_bytes_per_channel = OV7670_FILTER_CHANNEL_BYTES(width, 3);
+  uint16_t row = 0; // Current offset into each channel's buffer
+  buf = (uint8_t *)ov7670_scratch_alloc(scratch, buf_bytes_per_channel * 3);
+  if (buf) {
+    uint8_t *rptr = buf;                          // -> red buffer
+    uint8_t *gptr = &rptr[buf_bytes_per_channel]; // -> green buffer
+    uint8_t *bptr = &gptr[buf_bytes_per_channel]; // -> blue buffer
 
-  // Find median value in a list of 9 (index 0 to 8). Ostensibly,
-  // conceptually, this would involve sorting the list (ascending or
-  // descending, doesn't matter) and returning the value at index 4.
-  // Reality is simpler, it's sufficient to take the max of the 5
-  // lowest values (or min of the 5 highest), same result.
+    // For each of the three channel pointers (rptr, gptr, bptr),
+    // ptr[0] is the first pixel of the row ABOVE the current one,
+    // ptr[1] is the first pixel of the current row (0 to height-1),
+    // ptr[2] is the first pixel of the row BELOW the current one.
+    // Horizontal pixel addresses then increment by 3's...for each
+    // column (x) in row, pixel x = ptr[x * 3 + n], where n is 0, 1, 2
+    // for the above, current, and below rows, respectively.
 
-  // Testing a couple of approaches here. Consider also, instead of
-  // having these in an inline function, do this directly in the
-  // median inner loop, with separate red/green/blue variables --
-  // should entail fewer loop iterations overall.
+    // Convert pixel data into the initial 'current' (1) row buf
+    OV7670_filter_row_prep(view->pixels, &rptr[1], width,
+                           buf_bytes_per_channel, 3, swap);
 
-#if 0 // Might be a tiny bit faster at higher optimization settings
+    // Copy pixel data from the initial (1) row to the prior (0) row buf
+    // (Because edge pixels are repeated so we can 3x3 filter full image)
+    OV7670_filter_row_copy(&rptr[1], rptr, width + 2, buf_bytes_per_channel,
+                           3);
 
-  // Need to preserve initial pixel values -- 6 of 9 will carry over
-  // from one pixel to the next, so don't modify or sort the pixels
-  // in-place. Making a copy of the list is one option. Different
-  // option, used here, is to maintain a bitmask of all 9 'available'
-  // list positions and clear bits as each of the 5 minimums is found
-  // (returning the last one).
+    uint16_t *ptr; // Dest pointer, back into source image
+    uint16_t x, y;
+    for (y = 0; y < height; y++) { // For each row of image...
+      // Set up 'below' row buffer...
+      if (y < (height - 1)) { // If current row is 0 to height-2
+        // Convert pixel data into the 'next' (2) row buf
+        OV7670_filter_row_prep(OV7670_view_row(view, y + 1), &rptr[2],
+                               width, buf_bytes_per_channel, 3, swap);
+      } else { // Last row, y = height-1
+        // Copy pixel data from current (1) row to next (2) row buf
+        // (Edge pixels are repeated so we can 3x3 filter full image)
+        OV7670_filter_row_copy(&rptr[1], &rptr[2], width + 2,
+                               buf_bytes_per_channel, 3);
+      }
 
-  uint16_t min;
-  uint8_t min_idx, i, n;
-  uint16_t active_mask = ~0; // Bitmask of active values (initially all set)
-  for (n = 0; n < 5; n++) {  // Make 5 passes...
-    min = ~0;                //   To force initial select of 1st active value
-    for(i = 0; i < 9; i++) { //   For each of 9 values...
-      // If value #i is less than min and that spot's still active...
-      if((list[i] < min) && (active_mask & (1 << i))) {
-        min = list[i];       //     Save value of new minimum
-        min_idx = i;         //     Save index of new minimum
+      // The image row is already in the row buffers, so medians can be
+      // assembled directly in it, a channel at a time
+      ptr = OV7670_view_row(view, y);
+      memset(ptr, 0, width * 2);
+      ov7670_median_row_rgb(rptr, ptr, width, 11); // 3x3 median red
+      ov7670_median_row_rgb(gptr, ptr, width, 5);  // " green
+      ov7670_median_row_rgb(bptr, ptr, width, 0);  // " blue
+      if (swap) {
+        for (x = 0; x < width; x++) {
+          ptr[x] = ov7670_swap(ptr[x], swap); // Back to buffer's endian
+        }
       }
+      if (++row > OV7670_FILTER_SLACK) { // Out of tail, move rows back
+        ov7670_filter_rewind(buf, width, buf_bytes_per_channel, row, 3);
+        row = 0;
+      }
+      rptr = &buf[row]; // Next row
+      gptr = &rptr[buf_bytes_per_channel];
+      bptr = &gptr[buf_bytes_per_channel];
     }
-    active_mask &= ~(1 << min_idx); // Take element min_idx out of running
+
+    ov7670_scratch_free(scratch, buf);
+    return OV7670_STATUS_OK;
   }
+  return OV7670_STATUS_ERR_MALLOC;
+}
 
-  return min;
+// LARGER MEDIANS -----------------------------------------------------------
 
-#else // Might be faster at 'normal' optimization settings
+// For windows bigger than 3x3, sorting gets expensive fast (25 or 49
+// values per pixel per channel), but RGB565 channels have only 32 or 64
+// possible values (YUV 256), so a histogram of the window is small. Moving one
+// pixel right removes one column of the window from the histogram and
+// adds another, and the median is tracked as a bin index plus the count
+// of pixels below it, which shifts only a little from one pixel to the
+// next (Huang's algorithm). Cost per pixel grows with window height, not
+// area. Rows are unpacked into a ring of 2 * radius + 1 rows per channel
+// (edges repeated, as with 3x3), so results can go straight back into
+// the image.
 
-  // Need to preserve initial pixel values -- 6 of 9 will carry over
-  // from one pixel to the next, so don't modify or sort the pixels
-  // in-place. A copy of the input list is made so elements can be
-  // shuffled without corrupting the original.
-  uint8_t buf[9];
-  memcpy(buf, list, 9);
+// One channel's window histogram and running median.
+typedef struct {
+  uint16_t hist[256]; // Count of window pixels at each value
+  uint16_t below;     // Count of window pixels below median
+  uint8_t median;     // Current median value
+} ov7670_median_hist;
 
-  uint8_t n, i, min, min_idx;
+// Add (1) or remove (-1) one column of the window from a histogram.
+static inline void ov7670_hist_column(ov7670_median_hist *h,
+                                      const uint8_t *col, uint8_t size,
+                                      uint32_t row_bytes, int8_t add) {
+  for (uint8_t i = 0; i < size; i++, col += row_bytes) {
+    h->hist[*col] += add;
+    h->below += (*col < h->median) ? add : 0;
+  }
+}
 
-  for (n = 0; n < 5; n++) {       // 5 min-finding passes
-    min = buf[n];                 //   Initial min guess...
-    min_idx = n;                  //   is at index 'n' (0-4)
-    for (i = n + 1; i < 9; i++) { //   Compare through end of list...
-      if (buf[i] < min) {         //     Keep track of
-        min = buf[i];             //     min value and
-        min_idx = i;              //     index of min in list
-      }
+// Histogram of the leftmost window of one channel's ring rows, values
+// 0 to bins-1 (only those bins are cleared).
+static void ov7670_hist_start(ov7670_median_hist *h, const uint8_t *chan,
+                              uint8_t size, uint32_t row_bytes,
+                              uint16_t bins) {
+  memset(h->hist, 0, bins * sizeof h->hist[0]);
+  h->below = h->median = 0;
+  for (uint8_t x = 0; x < size; x++) {
+    ov7670_hist_column(h, &chan[x], size, row_bytes, 1);
+  }
+}
+
+// Move median up or down until 'half' pixels are below it.
+static inline void ov7670_hist_median(ov7670_median_hist *h, uint16_t half) {
+  if (h->below > half) {
+    do {
+      h->below -= h->hist[--h->median];
+    } while (h->below > half);
+  } else {
+    while (h->below + h->hist[h->median] <= half) {
+      h->below += h->hist[h->median++];
     }
-    // Item at min_idx is the nth-least value in list and no longer in
-    // the running for subsequent passes...replace value currently in
-    // that position with the value at position n (no swap needed, just
-    // overwrite, because next pass starts at n+1). In some cases this
-    // moves a value to itself, that's OK.
-    buf[min_idx] = buf[n];
   }
+}
+
+// Unpack one image row into a ring row of the larger median buffers:
+// 5/6/5-bit channels, each padded by 'radius' repeated edge pixels.
+OV7670_SPECIALIZE void ov7670_median_unpack(const uint16_t *src,
+                                            uint8_t *r_dst, uint16_t width,
+                                            uint8_t radius,
+                                            uint32_t channel_bytes,
+                                            bool swap) {
+  uint8_t *g_dst = &r_dst[channel_bytes];
+  uint8_t *b_dst = &g_dst[channel_bytes];
+  uint16_t x;
+  for (x = 0; x < width; x++) {
+    uint16_t rgb = ov7670_swap(src[x], swap);
+    r_dst[radius + x] = rgb >> 11;
+    g_dst[radius + x] = (rgb >> 5) & 0x3F;
+    b_dst[radius + x] = rgb & 0x1F;
+  }
+  for (x = 0; x < radius; x++) {
+    r_dst[x] = r_dst[radius];
+    g_dst[x] = g_dst[radius];
+    b_dst[x] = b_dst[radius];
+    r_dst[radius + width + x] = r_dst[radius + width - 1];
+    g_dst[radius + width + x] = g_dst[radius + width - 1];
+    b_dst[radius + width + x] = b_dst[radius + width - 1];
+  }
+}
+
+// Median of RGB565 pixels over a (2 * radius + 1) square window, swap as
+// per ov7670_swap().
+OV7670_SPECIALIZE OV7670_status
+ov7670_median_hist_rgb(const OV7670_view *view, uint8_t radius,
+                       OV7670_scratch *scratch, bool swap) {
+  uint16_t width = view->width, height = view->height;
+  uint8_t size = radius * 2 + 1;        // Window width & height
+  uint16_t half = size * size / 2;      // Pixels below median
+  uint32_t row_bytes = width + radius * 2;
+  uint32_t channel_bytes = row_bytes * size;
+  uint8_t *buf = (uint8_t *)ov7670_scratch_alloc(scratch, channel_bytes * 3);
+  if (!buf) {
+    return OV7670_STATUS_ERR_MALLOC;
+  }
+  static const uint8_t shift[3] = {11, 5, 0};
+  ov7670_median_hist h;
+  int16_t v;
+  uint16_t x, y;
+  uint8_t c;
 
-  return min; // min of 5th pass (max of 5 least values)
+  // Ring row for image row v (-radius to height-1+radius) is
+  // (v + radius) % size, holding row v clamped to the image. Rows
+  // before the first output row's window is complete are loaded here.
+  for (v = -radius; v < radius; v++) {
+    uint16_t src = (v < 0) ? 0 : (v >= height) ? height - 1 : v;
+    ov7670_median_unpack(OV7670_view_row(view, src),
+                         &buf[((v + radius) % size) * row_bytes], width,
+                         radius, channel_bytes, swap);
+  }
+
+  for (y = 0; y < height; y++) {
+    v = y + radius; // Bottom row of this window
+    uint16_t src = (v >= height) ? height - 1 : v;
+    ov7670_median_unpack(OV7670_view_row(view, src),
+                         &buf[((v + radius) % size) * row_bytes], width,
+                         radius, channel_bytes, swap);
+    uint16_t *ptr = OV7670_view_row(view, y);
+    memset(ptr, 0, width * 2);
+    for (c = 0; c < 3; c++) {
+      uint8_t *chan = &buf[c * channel_bytes]; // Ring order doesn't matter
+      ov7670_hist_start(&h, chan, size, row_bytes, 64);
+      for (x = 0; x < width; x++) {
+        ov7670_hist_median(&h, half);
+        ptr[x] |= h.median << shift[c];
+        if (x < width - 1) { // Slide window right
+          ov7670_hist_column(&h, &chan[x], size, row_bytes, -1);
+          ov7670_hist_column(&h, &chan[x + size], size, row_bytes, 1);
+        }
+      }
+    }
+    if (swap) {
+      for (x = 0; x < width; x++) {
+        ptr[x] = ov7670_swap(ptr[x], swap);
+      }
+    }
+  }
 
-#endif // end A/B testing
+  ov7670_scratch_free(scratch, buf);
+  return OV7670_STATUS_OK;
 }
 
-// 3x3 median filter for noise reduction. Even with Clever Optimizations(tm)
-// this is a tad slow, it's just the nature of the thing...lots and lots and
-// lots of pixel comparisons. Requires a chunk of RAM temporarily,
-// ((width + 2) * 3 + height - 1) * 3 bytes, or about 3.6K for a 320x240
-// RGB image. YUV is not currently supported.
+// 3x3 median filter for noise reduction. Requires a chunk of RAM
+// temporarily, OV7670_scratch_bytes(width, 1) (about 3K for a 320 pixel
+// wide RGB image). For YUV, only Y is filtered (see
+// OV7670_image_median_yuv()).
 void OV7670_image_median(OV7670_colorspace space, uint16_t *pixels,
                          uint16_t width, uint16_t height) {
-  if (space == OV7670_COLOR_RGB) {
-    uint8_t *buf;
-    uint32_t buf_bytes_per_channel = (width + 2) * 3 + height - 1;
-    if ((buf = (uint8_t *)malloc(buf_bytes_per_channel * 3))) {
-      uint8_t *rptr = buf;                          // -> red buffer
-      uint8_t *gptr = &rptr[buf_bytes_per_channel]; // -> green buffer
-      uint8_t *bptr = &gptr[buf_bytes_per_channel]; // -> blue buffer
-
-      // For each of the three channel pointers (rptr, gptr, bptr),
-      // ptr[0] is the first pixel of the row ABOVE the current one,
-      // ptr[1] is the first pixel of the current row (0 to height-1),
-      // ptr[2] is the first pixel of the row BELOW the current one.
-      // Horizontal pixel addresses then increment by 3's...for each
-      // column (x) in row, pixel x = ptr[x * 3 + n], where n is 0, 1, 2
-      // for the above, current, and below rows, respectively.
-
-      // Convert pixel data into the initial 'current' (1) row buf
-      OV7670_filter_row_prep(pixels, &rptr[1], width, buf_bytes_per_channel);
-
-      // Copy pixel data from the initial (1) row to the prior (0) row buf
-      // (Because edge pixels are repeated so we can 3x3 filter full image)
-      OV7670_filter_row_copy(&rptr[1], rptr, width + 2, buf_bytes_per_channel);
-
-      uint16_t *ptr = pixels; // Dest pointer, back into source image
-      uint16_t x, y, offset, rgb;
-      uint8_t r_med, g_med, b_med;
-      for (y = 0; y < height; y++) { // For each row of image...
-        // Set up 'below' row buffer...
-        if (y < (height - 1)) { // If current row is 0 to height-2
-          // Convert pixel data into the 'next' (2) row buf
-          OV7670_filter_row_prep(&pixels[(y + 1) * width], &rptr[2], width,
-                                 buf_bytes_per_channel);
-        } else { // Last row, y = height-1
-          // Copy pixel data from current (1) row to next (2) row buf
-          // (Edge pixels are repeated so we can 3x3 filter full image)
-          OV7670_filter_row_copy(&rptr[1], &rptr[2], width + 2,
-                                 buf_bytes_per_channel);
-        }
+  OV7670_image_median_order(space, OV7670_ORDER_BIG, pixels, width, height);
+}
 
-        for (x = offset = 0; x < width; x++, offset += 3) { // Each column...
-          r_med = OV7670_med9(&rptr[offset]);               // 3x3 median red
-          g_med = OV7670_med9(&gptr[offset]);               // " green
-          b_med = OV7670_med9(&bptr[offset]);               // " blue
-          rgb = (r_med << 11) | (g_med << 5) | b_med;       // Recombine 565
-          *ptr++ = __builtin_bswap16(rgb);                  // back in image
-        }
-        rptr++; // Next row
-        gptr++;
-        bptr++;
-      }
+void OV7670_image_median_order(OV7670_colorspace space, OV7670_order order,
+                               uint16_t *pixels, uint16_t width,
+                               uint16_t height) {
+  OV7670_view view = OV7670_view_frame(space, order, pixels, width, height);
+  OV7670_image_median_view(&view, NULL);
+}
 
-      free(buf);
+OV7670_status OV7670_image_median_view(const OV7670_view *view,
+                                       OV7670_scratch *scratch) {
+  return OV7670_image_median_radius_view(view, 1, scratch);
+}
+
+OV7670_status OV7670_image_median_radius_view(const OV7670_view *view,
+                                              uint8_t radius,
+                                              OV7670_scratch *scratch) {
+  if (!view->width || !view->height) {
+    return OV7670_STATUS_OK;
+  }
+  if (radius > 7) {
+    radius = 7;
+  }
+  bool swap = (view->order == OV7670_ORDER_BIG);
+  if (view->space == OV7670_COLOR_RGB) {
+    if (radius <= 1) { // 3x3 sorting network
+      return swap ? ov7670_median_rgb(view, scratch, true)
+                  : ov7670_median_rgb(view, scratch, false);
     }
-  } else { // YUV
-    // Not yet supported. Tricky because of alternating U/V pixels.
+    return swap ? ov7670_median_hist_rgb(view, radius, scratch, true)
+                : ov7670_median_hist_rgb(view, radius, scratch, false);
   }
+  return OV7670_image_median_yuv(view, radius, false, scratch); // Y only
 }
 
 // EDGE DETECTION -----------------------------------------------------------
@@ -473,73 +1168,1001 @@ void OV7670_image_median(OV7670_colorspace space, uint16_t *pixels,
 // if any of those 4 exceeds a given threshold. Note to future self: might
 // instead evaluate sum-of-four rather than any-of-four.
 static inline bool OV7670_edge9(uint8_t *list, uint8_t sensitivity) {
-  int8_t center = (int16_t)list[4];                 // Must be signed!
+  int16_t center = list[4];                         // Must be signed!
   return ((abs(center - list[1]) >= sensitivity) || // left
           (abs(center - list[3]) >= sensitivity) || // up
           (abs(center - list[5]) >= sensitivity) || // down
           (abs(center - list[7]) >= sensitivity));  // right
 }
 
-// Edge detection filter. Requires a chunk of RAM temporarily,
-// ((width + 2) * 3 + height - 1) * 3 bytes, or about 3.6K for a
-// 320x240 RGB image. YUV is not currently supported.
+// Edge detection of RGB565 pixels, swap as per ov7670_swap().
+OV7670_SPECIALIZE OV7670_status ov7670_edges_rgb(const OV7670_view *view,
+                                                 uint8_t sensitivity,
+                                                 OV7670_scratch *scratch,
+                                                 bool swap) {
+  uint16_t width = view->width, height = view->height;
+  uint8_t *buf;
+  uint32_t buf_bytes_per_channel = OV7670_FILTER_CHANNEL_BYTES(width, 3);
+  uint16_t row = 0; // Current offset into each channel's buffer
+  buf = (uint8_t *)ov7670_scratch_alloc(scratch, buf_bytes_per_channel * 3);
+  if (buf) {
+    uint8_t *rptr = buf;                          // -> red buffer
+    uint8_t *gptr = &rptr[buf_bytes_per_channel]; // -> green buffer
+    uint8_t *bptr = &gptr[buf_bytes_per_channel]; // -> blue buffer
+
+    // For each of the three channel pointers (rptr, gptr, bptr),
+    // ptr[0] is the first pixel of the row ABOVE the current one,
+    // ptr[1] is the first pixel of the current row (0 to height-1),
+    // ptr[2] is the first pixel of the row BELOW the current one.
+    // Horizontal pixel addresses then increment by 3's...for each
+    // column (x) in row, pixel x = ptr[x * 3 + n], where n is 0, 1, 2
+    // for the above, current, and below rows, respectively.
+
+    // Convert pixel data into the initial 'current' (1) row buf
+    OV7670_filter_row_prep(view->pixels, &rptr[1], width,
+                           buf_bytes_per_channel, 3, swap);
+
+    // Copy pixel data from the initial (1) row to the prior (0) row buf
+    // (Because edge pixels are repeated so we can 3x3 filter full image)
+    OV7670_filter_row_copy(&rptr[1], rptr, width + 2, buf_bytes_per_channel,
+                           3);
+
+    uint8_t s2 = sensitivity * 2; // Because green has extra bit
+
+    uint16_t *ptr; // Dest pointer, back into source image
+    uint16_t x, y, offset, rgb;
+    for (y = 0; y < height; y++) { // For each row of image...
+      // Set up 'below' row buffer...
+      if (y < (height - 1)) { // If current row is 0 to height-2
+        // Convert pixel data into the 'next' (2) row buf
+        OV7670_filter_row_prep(OV7670_view_row(view, y + 1), &rptr[2],
+                               width, buf_bytes_per_channel, 3, swap);
+      } else { // Last row, y = height-1
+        // Copy pixel data from current (1) row to next (2) row buf
+        // (Edge pixels are repeated so we can 3x3 filter full image)
+        OV7670_filter_row_copy(&rptr[1], &rptr[2], width + 2,
+                               buf_bytes_per_channel, 3);
+      }
+
+      ptr = OV7670_view_row(view, y);
+      for (x = offset = 0; x < width; x++, offset += 3) {
+        rgb = ((OV7670_edge9(&rptr[offset], sensitivity) * 0xF800) |
+               (OV7670_edge9(&gptr[offset], s2) * 0x07E0) |
+               (OV7670_edge9(&bptr[offset], sensitivity) * 0x001F));
+        *ptr++ = ov7670_swap(rgb, swap);
+      }
+      if (++row > OV7670_FILTER_SLACK) { // Out of tail, move rows back
+        ov7670_filter_rewind(buf, width, buf_bytes_per_channel, row, 3);
+        row = 0;
+      }
+      rptr = &buf[row]; // Next row
+      gptr = &rptr[buf_bytes_per_channel];
+      bptr = &gptr[buf_bytes_per_channel];
+    }
+
+    ov7670_scratch_free(scratch, buf);
+    return OV7670_STATUS_OK;
+  }
+  return OV7670_STATUS_ERR_MALLOC;
+}
+
+// Edge detection filter. Requires a chunk of RAM temporarily, same as
+// the 3x3 median. For YUV, only Y is filtered.
 void OV7670_image_edges(OV7670_colorspace space, uint16_t *pixels,
                         uint16_t width, uint16_t height, uint8_t sensitivity) {
+  OV7670_image_edges_order(space, OV7670_ORDER_BIG, pixels, width, height,
+                           sensitivity);
+}
 
-  if (space == OV7670_COLOR_RGB) {
-    uint8_t *buf;
-    uint32_t buf_bytes_per_channel = (width + 2) * 3 + height - 1;
-    if ((buf = (uint8_t *)malloc(buf_bytes_per_channel * 3))) {
-      uint8_t *rptr = buf;                          // -> red buffer
-      uint8_t *gptr = &rptr[buf_bytes_per_channel]; // -> green buffer
-      uint8_t *bptr = &gptr[buf_bytes_per_channel]; // -> blue buffer
-
-      // For each of the three channel pointers (rptr, gptr, bptr),
-      // ptr[0] is the first pixel of the row ABOVE the current one,
-      // ptr[1] is the first pixel of the current row (0 to height-1),
-      // ptr[2] is the first pixel of the row BELOW the current one.
-      // Horizontal pixel addresses then increment by 3's...for each
-      // column (x) in row, pixel x = ptr[x * 3 + n], where n is 0, 1, 2
-      // for the above, current, and below rows, respectively.
-
-      // Convert pixel data into the initial 'current' (1) row buf
-      OV7670_filter_row_prep(pixels, &rptr[1], width, buf_bytes_per_channel);
-
-      // Copy pixel data from the initial (1) row to the prior (0) row buf
-      // (Because edge pixels are repeated so we can 3x3 filter full image)
-      OV7670_filter_row_copy(&rptr[1], rptr, width + 2, buf_bytes_per_channel);
-
-      uint8_t s2 = sensitivity * 2; // Because green has extra bit
-
-      uint16_t *ptr = pixels; // Dest pointer, back into source image
-      uint16_t x, y, offset, rgb;
-      for (y = 0; y < height; y++) { // For each row of image...
-        // Set up 'below' row buffer...
-        if (y < (height - 1)) { // If current row is 0 to height-2
-          // Convert pixel data into the 'next' (2) row buf
-          OV7670_filter_row_prep(&pixels[(y + 1) * width], &rptr[2], width,
-                                 buf_bytes_per_channel);
-        } else { // Last row, y = height-1
-          // Copy pixel data from current (1) row to next (2) row buf
-          // (Edge pixels are repeated so we can 3x3 filter full image)
-          OV7670_filter_row_copy(&rptr[1], &rptr[2], width + 2,
-                                 buf_bytes_per_channel);
-        }
+void OV7670_image_edges_order(OV7670_colorspace space, OV7670_order order,
+                              uint16_t *pixels, uint16_t width,
+                              uint16_t height, uint8_t sensitivity) {
+  OV7670_view view = OV7670_view_frame(space, order, pixels, width, height);
+  OV7670_image_edges_view(&view, sensitivity, NULL);
+}
+
+OV7670_status OV7670_image_edges_view(const OV7670_view *view,
+                                      uint8_t sensitivity,
+                                      OV7670_scratch *scratch) {
+  if (!view->width || !view->height) {
+    return OV7670_STATUS_OK;
+  }
+  if (view->space == OV7670_COLOR_RGB) {
+    if (view->order == OV7670_ORDER_BIG) {
+      return ov7670_edges_rgb(view, sensitivity, scratch, true);
+    } else {
+      return ov7670_edges_rgb(view, sensitivity, scratch, false);
+    }
+  }
+  return OV7670_image_edges_yuv(view, sensitivity, false, scratch); // Y only
+}
 
+// YUV FILTERS --------------------------------------------------------------
+
+// Median and edges on YUV data work a plane at a time (see ov7670_plane),
+// with the same row buffers as RGB, but one 8-bit channel instead of three
+// and nothing to unpack: each sample is just copied into place. Chroma
+// planes are half width, so they add half again to the luma cost, and
+// reuse the luma plane's working memory.
+
+// As OV7670_filter_row_prep(), for one row of a plane.
+OV7670_SPECIALIZE void ov7670_plane_row_prep(const uint8_t *src,
+                                             uint8_t *dst, uint16_t width,
+                                             uint8_t step, uint8_t size) {
+  uint8_t pad = size / 2;
+  uint32_t x, offset = pad * size;
+  for (x = 0; x < width; x++, src += step, offset += size) {
+    dst[offset] = *src;
+  }
+  uint32_t first = pad * size, last = offset - size;
+  for (uint8_t p = 0; p < pad; p++, offset += size) {
+    dst[p * size] = dst[first]; // Duplicate leftmost sample
+    dst[offset] = dst[last];    // Duplicate rightmost sample
+  }
+}
+
+// As OV7670_filter_row_copy(), for one channel.
+static void ov7670_plane_row_copy(const uint8_t *src, uint8_t *dst,
+                                  uint16_t width, uint8_t size) {
+  for (uint32_t offset = 0; offset < (uint32_t)width * size; offset += size) {
+    dst[offset] = src[offset];
+  }
+}
+
+// 3x3 median (edges false) or edge detection (edges true) of the planes of
+// a YUV view: Y, and U and V if planes is 3. Edge results are 255 or 0.
+OV7670_SPECIALIZE OV7670_status ov7670_filter_yuv(const OV7670_view *view,
+                                                  uint8_t planes,
+                                                  uint8_t sensitivity,
+                                                  OV7670_scratch *scratch,
+                                                  bool edges) {
+  uint32_t buf_bytes = OV7670_FILTER_CHANNEL_BYTES(view->width, 3);
+  uint8_t *buf = (uint8_t *)ov7670_scratch_alloc(scratch, buf_bytes);
+  if (!buf) {
+    return OV7670_STATUS_ERR_MALLOC;
+  }
+  for (uint8_t p = 0; p < planes; p++) {
+    ov7670_plane plane = ov7670_yuv_plane(view, p);
+    uint16_t width = plane.width, height = plane.height;
+    uint16_t row = 0, x, y, offset;
+    uint8_t *ptr = buf, *out; // Row buffer (as rptr in RGB), image row
+    if (!width) {
+      continue;
+    }
+    ov7670_plane_row_prep(plane.base, &ptr[1], width, plane.step, 3);
+    ov7670_plane_row_copy(&ptr[1], ptr, width + 2, 3);
+    for (y = 0; y < height; y++) {
+      if (y < (height - 1)) {
+        ov7670_plane_row_prep(ov7670_plane_row(&plane, y + 1), &ptr[2], width,
+                              plane.step, 3);
+      } else {
+        ov7670_plane_row_copy(&ptr[1], &ptr[2], width + 2, 3);
+      }
+      out = ov7670_plane_row(&plane, y);
+      if (edges) {
         for (x = offset = 0; x < width; x++, offset += 3) {
-          rgb = ((OV7670_edge9(&rptr[offset], sensitivity) * 0xF800) |
-                 (OV7670_edge9(&gptr[offset], s2) * 0x07E0) |
-                 (OV7670_edge9(&bptr[offset], sensitivity) * 0x001F));
-          *ptr++ = __builtin_bswap16(rgb);
+          out[x * plane.step] = OV7670_edge9(&ptr[offset], sensitivity) * 255;
         }
-        rptr++; // Next row
-        gptr++;
-        bptr++;
+      } else {
+        ov7670_median_row(ptr, out, width, 0, plane.step);
+      }
+      if (++row > OV7670_FILTER_SLACK) { // Out of tail, move rows back
+        memmove(buf, &buf[row], (width + 2) * 3);
+        row = 0;
       }
+      ptr = &buf[row];
+    }
+  }
+  ov7670_scratch_free(scratch, buf);
+  return OV7670_STATUS_OK;
+}
 
-      free(buf);
+// As ov7670_median_unpack(), for one row of a plane.
+static void ov7670_plane_unpack(const uint8_t *src, uint8_t *dst,
+                                uint16_t width, uint8_t radius, uint8_t step) {
+  for (uint16_t x = 0; x < width; x++, src += step) {
+    dst[radius + x] = *src;
+  }
+  memset(dst, dst[radius], radius);
+  memset(&dst[radius + width], dst[radius + width - 1], radius);
+}
+
+// Median of the planes of a YUV view over a (2 * radius + 1) square
+// window, as ov7670_median_hist_rgb() is for RGB.
+static OV7670_status ov7670_median_hist_yuv(const OV7670_view *view,
+                                            uint8_t radius, uint8_t planes,
+                                            OV7670_scratch *scratch) {
+  uint8_t size = radius * 2 + 1;   // Window width & height
+  uint16_t half = size * size / 2; // Pixels below median
+  uint8_t *buf = (uint8_t *)ov7670_scratch_alloc(
+      scratch, (uint32_t)(view->width + radius * 2) * size);
+  if (!buf) {
+    return OV7670_STATUS_ERR_MALLOC;
+  }
+  ov7670_median_hist h;
+  int16_t v;
+  uint16_t x, y;
+  for (uint8_t p = 0; p < planes; p++) {
+    ov7670_plane plane = ov7670_yuv_plane(view, p);
+    uint16_t width = plane.width, height = plane.height;
+    uint32_t row_bytes = width + radius * 2;
+    if (!width) {
+      continue;
+    }
+    for (v = -radius; v < radius; v++) { // Ring rows as in the RGB version
+      uint16_t src = (v < 0) ? 0 : (v >= height) ? height - 1 : v;
+      ov7670_plane_unpack(ov7670_plane_row(&plane, src),
+                          &buf[((v + radius) % size) * row_bytes], width,
+                          radius, plane.step);
+    }
+    for (y = 0; y < height; y++) {
+      v = y + radius; // Bottom row of this window
+      uint16_t src = (v >= height) ? height - 1 : v;
+      ov7670_plane_unpack(ov7670_plane_row(&plane, src),
+                          &buf[((v + radius) % size) * row_bytes], width,
+                          radius, plane.step);
+      uint8_t *out = ov7670_plane_row(&plane, y);
+      ov7670_hist_start(&h, buf, size, row_bytes, 256);
+      for (x = 0; x < width; x++) {
+        ov7670_hist_median(&h, half);
+        out[x * plane.step] = h.median;
+        if (x < width - 1) { // Slide window right
+          ov7670_hist_column(&h, &buf[x], size, row_bytes, -1);
+          ov7670_hist_column(&h, &buf[x + size], size, row_bytes, 1);
+        }
+      }
+    }
+  }
+  ov7670_scratch_free(scratch, buf);
+  return OV7670_STATUS_OK;
+}
+
+OV7670_status OV7670_image_median_yuv(const OV7670_view *view, uint8_t radius,
+                                      bool chroma, OV7670_scratch *scratch) {
+  if (view->space != OV7670_COLOR_YUV) {
+    return OV7670_image_median_radius_view(view, radius, scratch);
+  }
+  if (!view->width || !view->height) {
+    return OV7670_STATUS_OK;
+  }
+  if (radius > 7) {
+    radius = 7;
+  }
+  uint8_t planes = chroma ? 3 : 1;
+  if (radius <= 1) { // 3x3 sorting network
+    return ov7670_filter_yuv(view, planes, 0, scratch, false);
+  }
+  return ov7670_median_hist_yuv(view, radius, planes, scratch);
+}
+
+OV7670_status OV7670_image_edges_yuv(const OV7670_view *view,
+                                     uint8_t sensitivity, bool chroma,
+                                     OV7670_scratch *scratch) {
+  if (view->space != OV7670_COLOR_YUV) {
+    return OV7670_image_edges_view(view, sensitivity, scratch);
+  }
+  if (!view->width || !view->height) {
+    return OV7670_STATUS_OK;
+  }
+  // Sensitivity is in 5-bit RGB565 steps, YUV samples are 8 bits
+  uint8_t s8 = (sensitivity < 32) ? sensitivity * 8 : 255;
+  return ov7670_filter_yuv(view, chroma ? 3 : 1, s8, scratch, true);
+}
+
+// Y2RGB565 lives in ov7670.c with the camera code; this just walks rows.
+void OV7670_Y2RGB565_view(const OV7670_view *view) {
+  uint32_t run_pixels;
+  uint16_t runs = ov7670_runs(view, &run_pixels);
+  for (uint16_t r = 0; r < runs; r++) {
+    OV7670_Y2RGB565_order(OV7670_view_row(view, r), run_pixels, view->order);
+  }
+}
+
+// YUV TO RGB565 ------------------------------------------------------------
+
+// Full color, unlike OV7670_Y2RGB565(): BT.601 with full-range Y (as in
+// JPEG, and as Y2RGB565 treats Y), in fixed point (coefficients x256):
+//   R = Y + 1.402 (V - 128)
+//   G = Y - 0.344 (U - 128) - 0.714 (V - 128)
+//   B = Y + 1.772 (U - 128)
+// Each chroma byte's part of each channel is looked up, in 8-bit units,
+// from tables built on first use (1.5K of RAM). U and V are shared by a
+// pair of pixels (a macropixel), so the lookups are done once per pair,
+// then just added to each Y, clamped and packed as RGB565.
+static int16_t ov7670_v_red[256], ov7670_u_blue[256];
+static int8_t ov7670_u_green[256], ov7670_v_green[256];
+static bool ov7670_yuv_tables_ready = false;
+
+static void ov7670_yuv_tables(void) {
+  if (!ov7670_yuv_tables_ready) {
+    for (int16_t i = 0; i < 256; i++) {
+      int16_t c = i - 128; // Chroma is offset by 128
+      ov7670_v_red[i] = (359 * c + 128) >> 8;
+      ov7670_u_green[i] = (-88 * c + 128) >> 8;
+      ov7670_v_green[i] = (-183 * c + 128) >> 8;
+      ov7670_u_blue[i] = (454 * c + 128) >> 8;
+    }
+    ov7670_yuv_tables_ready = true;
+  }
+}
+
+static inline uint8_t ov7670_clamp8(int16_t value) {
+  return (value < 0) ? 0 : (value > 255) ? 255 : value;
+}
+
+// One RGB565 pixel from Y plus its pair's chroma terms.
+static inline uint16_t ov7670_yuv_pixel(uint8_t y, int16_t red, int16_t green,
+                                        int16_t blue) {
+  return ((ov7670_clamp8(y + red) & 0xF8) << 8) |
+         ((ov7670_clamp8(y + green) & 0xFC) << 3) |
+         (ov7670_clamp8(y + blue) >> 3);
+}
+
+// Convert len YUV pixels at src to RGB565 at dst (may be the same), swap
+// as per ov7670_swap(): after it, Y is the high byte and U or V the low.
+OV7670_SPECIALIZE void ov7670_yuv2rgb(const uint16_t *src, uint16_t *dst,
+                                      uint32_t len, bool swap) {
+  uint16_t p0, p1;
+  int16_t red, green, blue;
+  for (uint32_t pairs = len / 2; pairs--; src += 2, dst += 2) {
+    p0 = ov7670_swap(src[0], swap); // Y0, U
+    p1 = ov7670_swap(src[1], swap); // Y1, V
+    red = ov7670_v_red[p1 & 0xFF];
+    green = ov7670_u_green[p0 & 0xFF] + ov7670_v_green[p1 & 0xFF];
+    blue = ov7670_u_blue[p0 & 0xFF];
+    dst[0] = ov7670_swap(ov7670_yuv_pixel(p0 >> 8, red, green, blue), swap);
+    dst[1] = ov7670_swap(ov7670_yuv_pixel(p1 >> 8, red, green, blue), swap);
+  }
+  if (len & 1) { // Odd pixel out has U but no V, take V as neutral
+    p0 = ov7670_swap(src[0], swap);
+    green = ov7670_u_green[p0 & 0xFF];
+    blue = ov7670_u_blue[p0 & 0xFF];
+    dst[0] = ov7670_swap(ov7670_yuv_pixel(p0 >> 8, 0, green, blue), swap);
+  }
+}
+
+void OV7670_YUV2RGB565(const uint16_t *src, uint16_t *dst, uint32_t len,
+                       OV7670_order order) {
+  ov7670_yuv_tables();
+  if (order == OV7670_ORDER_BIG) {
+    ov7670_yuv2rgb(src, dst, len, true);
+  } else {
+    ov7670_yuv2rgb(src, dst, len, false);
+  }
+}
+
+void OV7670_YUV2RGB565_view(const OV7670_view *view, uint16_t *dst) {
+  uint32_t run_pixels;
+  uint16_t runs = ov7670_runs(view, &run_pixels);
+  if ((runs == 1) && (view->width & 1)) { // Keep pairs within rows
+    runs = view->height;
+    run_pixels = view->width;
+  }
+  for (uint16_t r = 0; r < runs; r++) {
+    uint16_t *src = OV7670_view_row(view, r);
+    OV7670_YUV2RGB565(src, dst ? &dst[r * run_pixels] : src, run_pixels,
+                      view->order);
+  }
+}
+
+// Y PLANE ------------------------------------------------------------------
+
+// Each Y byte moves to half its former offset or less, so compacting in
+// place never overwrites a byte that's still to be read.
+void OV7670_Y_extract(const uint16_t *src, uint8_t *dst, uint32_t len,
+                      OV7670_order order) {
+  const uint8_t *src8 = (const uint8_t *)src;
+  if (order != OV7670_ORDER_BIG) {
+    src8++; // Y is the second byte of each pixel
+  }
+  for (uint32_t i = 0; i < len; i++) {
+    dst[i] = src8[i * 2];
+  }
+}
+
+uint8_t *OV7670_Y_extract_view(const OV7670_view *view, uint8_t *dst) {
+  if (view->space != OV7670_COLOR_YUV) {
+    return NULL;
+  }
+  uint8_t *plane = dst ? dst : (uint8_t *)view->pixels;
+  uint32_t run_pixels;
+  uint16_t runs = ov7670_runs(view, &run_pixels);
+  for (uint16_t r = 0; r < runs; r++) { // Rows compact as for one run
+    OV7670_Y_extract(OV7670_view_row(view, r), &plane[r * run_pixels],
+                     run_pixels, view->order);
+  }
+  return plane;
+}
+
+// INTEGRAL IMAGES ----------------------------------------------------------
+
+// Integral rows are built from one channel of a row of pixels, unpacked
+// to bytes first, so the summing and box loops don't care which channel
+// (or byte order) it came from. hi is the offset of each pixel's high
+// byte, which is also where Y is: 0 for big-endian, 1 for little.
+
+// Channel a view is actually summed by (see OV7670_channel).
+static OV7670_channel ov7670_channel_of(const OV7670_view *view,
+                                        OV7670_channel channel) {
+  if (view->space == OV7670_COLOR_YUV) {
+    return OV7670_CHANNEL_Y;
+  }
+  return (channel == OV7670_CHANNEL_Y) ? OV7670_CHANNEL_GREEN : channel;
+}
+
+// Bits to shift a channel's values left to make them 8-bit.
+static uint8_t ov7670_channel_shift(OV7670_channel channel) {
+  return (channel == OV7670_CHANNEL_Y) ? 0
+         : (channel == OV7670_CHANNEL_GREEN) ? 2
+                                             : 3;
+}
+
+static void ov7670_channel_unpack(const uint8_t *src, uint8_t *dst,
+                                  uint16_t width, OV7670_channel channel,
+                                  uint8_t hi) {
+  uint8_t lo = hi ^ 1;
+  uint16_t x;
+  switch (channel) {
+  case OV7670_CHANNEL_RED:
+    for (x = 0; x < width; x++, src += 2) {
+      dst[x] = src[hi] >> 3;
+    }
+    break;
+  case OV7670_CHANNEL_GREEN:
+    for (x = 0; x < width; x++, src += 2) {
+      dst[x] = ((src[hi] & 7) << 3) | (src[lo] >> 5);
+    }
+    break;
+  case OV7670_CHANNEL_BLUE:
+    for (x = 0; x < width; x++, src += 2) {
+      dst[x] = src[lo] & 31;
+    }
+    break;
+  default: // Y
+    for (x = 0; x < width; x++, src += 2) {
+      dst[x] = src[hi];
+    }
+    break;
+  }
+}
+
+// Reverse of ov7670_channel_unpack(), other channels left as they were.
+static void ov7670_channel_pack(const uint8_t *src, uint8_t *dst,
+                                uint16_t width, OV7670_channel channel,
+                                uint8_t hi) {
+  uint8_t lo = hi ^ 1;
+  uint16_t x;
+  switch (channel) {
+  case OV7670_CHANNEL_RED:
+    for (x = 0; x < width; x++, dst += 2) {
+      dst[hi] = (dst[hi] & 0x07) | (src[x] << 3);
+    }
+    break;
+  case OV7670_CHANNEL_GREEN:
+    for (x = 0; x < width; x++, dst += 2) {
+      dst[hi] = (dst[hi] & 0xF8) | (src[x] >> 3);
+      dst[lo] = (dst[lo] & 0x1F) | (src[x] << 5);
+    }
+    break;
+  case OV7670_CHANNEL_BLUE:
+    for (x = 0; x < width; x++, dst += 2) {
+      dst[lo] = (dst[lo] & 0xE0) | src[x];
+    }
+    break;
+  default: // Y
+    for (x = 0; x < width; x++, dst += 2) {
+      dst[hi] = src[x];
+    }
+    break;
+  }
+}
+
+// Integral row (width + 1 entries) from the one above it and a row of
+// channel values: each entry is the one above plus the row's sum so far.
+static void ov7670_integral_row(const uint8_t *values, uint16_t width,
+                                const void *above, void *out, bool wide) {
+  uint32_t sum = 0;
+  if (wide) {
+    const uint32_t *a = (const uint32_t *)above;
+    uint32_t *o = (uint32_t *)out;
+    o[0] = 0;
+    for (uint16_t x = 0; x < width; x++) {
+      sum += values[x];
+      o[x + 1] = a[x + 1] + sum;
+    }
+  } else {
+    const uint16_t *a = (const uint16_t *)above;
+    uint16_t *o = (uint16_t *)out;
+    o[0] = 0;
+    for (uint16_t x = 0; x < width; x++) {
+      sum += values[x];
+      o[x + 1] = a[x + 1] + sum;
+    }
+  }
+}
+
+uint32_t OV7670_integral_bytes(uint16_t width, uint16_t height, bool wide) {
+  return (uint32_t)(width + 1) * (height + 1) * (wide ? 4 : 2) + width;
+}
+
+void OV7670_integral_build(OV7670_integral *integral, void *mem, bool wide,
+                           const OV7670_view *view, OV7670_channel channel) {
+  uint16_t width = view->width, height = view->height;
+  uint32_t row_bytes = (uint32_t)(width + 1) * (wide ? 4 : 2);
+  uint8_t *sums = (uint8_t *)mem;
+  uint8_t *values = &sums[row_bytes * (height + 1)]; // Past the table
+  uint8_t hi = (view->order == OV7670_ORDER_BIG) ? 0 : 1;
+  channel = ov7670_channel_of(view, channel);
+  integral->sums = mem;
+  integral->width = width;
+  integral->height = height;
+  integral->max = 255 >> ov7670_channel_shift(channel);
+  integral->wide = wide;
+  memset(sums, 0, row_bytes); // Nothing above the first row
+  for (uint16_t y = 0; y < height; y++) {
+    ov7670_channel_unpack((const uint8_t *)OV7670_view_row(view, y), values,
+                          width, channel, hi);
+    ov7670_integral_row(values, width, &sums[y * row_bytes],
+                        &sums[(y + 1) * row_bytes], wide);
+  }
+}
+
+// Tiles are as wide as the rectangle if that fits the limit, else as wide
+// as the limit (one row each), and as many rows as fit. Each tile's sum
+// is below 65536, so exact, and they add up in 32 bits.
+uint32_t OV7670_integral_sum_tiled(const OV7670_integral *integral,
+                                   uint16_t x, uint16_t y, uint16_t width,
+                                   uint16_t height) {
+  uint16_t limit = 65535 / integral->max; // Most pixels per tile
+  uint16_t tile_w = (width < limit) ? width : limit;
+  uint16_t tile_h = limit / tile_w;
+  uint32_t sum = 0;
+  for (uint16_t ty = 0; ty < height; ty += tile_h) {
+    uint16_t h = (height - ty < tile_h) ? height - ty : tile_h;
+    for (uint16_t tx = 0; tx < width; tx += tile_w) {
+      uint16_t w = (width - tx < tile_w) ? width - tx : tile_w;
+      sum += OV7670_integral_sum(integral, x + tx, y + ty, w, h);
+    }
+  }
+  return sum;
+}
+
+uint8_t OV7670_integral_mean(const OV7670_integral *integral, uint16_t x,
+                             uint16_t y, uint16_t width, uint16_t height) {
+  if ((x >= integral->width) || (y >= integral->height)) {
+    return 0;
+  }
+  if (width > integral->width - x) {
+    width = integral->width - x;
+  }
+  if (height > integral->height - y) {
+    height = integral->height - y;
+  }
+  uint32_t area = (uint32_t)width * height;
+  if (!area) {
+    return 0;
+  }
+  return (OV7670_integral_sum(integral, x, y, width, height) + area / 2) /
+         area;
+}
+
+// Box blur (threshold false) or local threshold (true) of one channel of
+// a view. The summed-area table is never whole: a ring of radius * 2 + 2
+// 16-bit integral rows holds just those the current output row's boxes
+// span, each built (from the original pixels, which are only overwritten
+// once no later box covers them) as the bottom of the window reaches it.
+// Radius is at most 7, so box sums stay under 65536 (15 x 15 x 255) and
+// the 16-bit entries are exact. Averages multiply by a reciprocal with 24
+// fraction bits, rounded up, which is exact for sums this size.
+OV7670_SPECIALIZE OV7670_status ov7670_box(const OV7670_view *view,
+                                           OV7670_channel channel,
+                                           uint8_t radius, uint8_t bias,
+                                           OV7670_scratch *scratch,
+                                           bool threshold) {
+  uint16_t width = view->width, height = view->height;
+  uint8_t slots = radius * 2 + 2, size = radius * 2 + 1;
+  uint32_t row_entries = width + 1;
+  uint16_t *ring = (uint16_t *)ov7670_scratch_alloc(
+      scratch, slots * row_entries * 2 + width);
+  if (!ring) {
+    return OV7670_STATUS_ERR_MALLOC;
+  }
+  uint8_t *values = (uint8_t *)&ring[slots * row_entries];
+  uint8_t hi = (view->order == OV7670_ORDER_BIG) ? 0 : 1;
+  uint8_t shift = ov7670_channel_shift(channel);
+  uint8_t white = 255 >> shift;
+  uint32_t recip[15]; // 2^24 / area, per box width, for this row's height
+  uint16_t x, y, built = 0, rows = 0;
+  memset(ring, 0, row_entries * 2); // Integral row 0, nothing above
+  for (y = 0; y < height; y++) {
+    uint16_t top = (y > radius) ? y - radius : 0;
+    uint16_t bottom = (height - y > radius) ? y + radius + 1 : height;
+    while (built < bottom) { // Add integral rows down to the window bottom
+      ov7670_channel_unpack((const uint8_t *)OV7670_view_row(view, built),
+                            values, width, channel, hi);
+      uint16_t *above = &ring[(built % slots) * row_entries];
+      built++;
+      ov7670_integral_row(values, width, above,
+                          &ring[(built % slots) * row_entries], false);
+    }
+    if (bottom - top != rows) { // Only changes near the top and bottom
+      rows = bottom - top;
+      for (uint8_t cols = 1; cols <= size; cols++) {
+        uint32_t area = rows * cols;
+        recip[cols - 1] = ((1UL << 24) + area - 1) / area;
+      }
+    }
+    const uint16_t *t = &ring[(top % slots) * row_entries];
+    const uint16_t *b = &ring[(bottom % slots) * row_entries];
+    uint8_t *out = (uint8_t *)OV7670_view_row(view, y);
+    if (threshold) { // Compare against this row's own values
+      ov7670_channel_unpack(out, values, width, channel, hi);
+    }
+    for (x = 0; x < width; x++) {
+      uint16_t left = (x > radius) ? x - radius : 0;
+      uint16_t right = (width - x > radius) ? x + radius + 1 : width;
+      uint16_t cols = right - left;
+      uint16_t sum = b[right] - b[left] - t[right] + t[left];
+      if (threshold) { // Black if value < mean - bias, all in 8-bit units
+        uint32_t area = (uint32_t)rows * cols;
+        values[x] =
+            (((values[x] << shift) + bias) * area < ((uint32_t)sum << shift))
+                ? 0
+                : white;
+      } else {
+        values[x] = ((sum + rows * cols / 2) * recip[cols - 1]) >> 24;
+      }
+    }
+    ov7670_channel_pack(values, out, width, channel, hi);
+  }
+  ov7670_scratch_free(scratch, ring);
+  return OV7670_STATUS_OK;
+}
+
+// Box filter of each channel in turn: Y, or red, green and blue, each a
+// pass of its own, so scratch is only ever one channel's ring.
+static OV7670_status ov7670_box_view(const OV7670_view *view, uint8_t radius,
+                                     uint8_t bias, OV7670_scratch *scratch,
+                                     bool threshold) {
+  if (!view->width || !view->height) {
+    return OV7670_STATUS_OK;
+  }
+  if (radius < 1) {
+    radius = 1;
+  } else if (radius > 7) {
+    radius = 7;
+  }
+  OV7670_channel first = OV7670_CHANNEL_RED, last = OV7670_CHANNEL_BLUE;
+  if (view->space == OV7670_COLOR_YUV) {
+    first = last = OV7670_CHANNEL_Y;
+  }
+  for (uint8_t c = first; c <= last; c++) {
+    OV7670_status status;
+    if (threshold) {
+      status = ov7670_box(view, (OV7670_channel)c, radius, bias, scratch,
+                          true);
+    } else {
+      status = ov7670_box(view, (OV7670_channel)c, radius, 0, scratch, false);
+    }
+    if (status != OV7670_STATUS_OK) {
+      return status;
+    }
+  }
+  return OV7670_STATUS_OK;
+}
+
+OV7670_status OV7670_image_box_blur_view(const OV7670_view *view,
+                                         uint8_t radius,
+                                         OV7670_scratch *scratch) {
+  return ov7670_box_view(view, radius, 0, scratch, false);
+}
+
+OV7670_status OV7670_image_local_threshold_view(const OV7670_view *view,
+                                                uint8_t radius, uint8_t bias,
+                                                OV7670_scratch *scratch) {
+  return ov7670_box_view(view, radius, bias, scratch, true);
+}
+
+// CONVOLUTION --------------------------------------------------------------
+
+// Convolution runs on the median's row buffers (see the notes there), 3 or
+// 5 rows deep, so each column of a window is consecutive bytes and moving
+// right is a step of size. Full kernels multiply all size x size samples
+// by their weights. Separable ones take the vertical taps down every
+// column of the buffers first, into a row of 16-bit column sums, then
+// the horizontal taps along that -- vertical before horizontal so the
+// existing row buffers serve, the same result either way, as nothing is
+// rounded in between.
+
+static const OV7670_kernel ov7670_kernels[] = {
+    // Gaussian 3x3, 1 2 1 each way, sum 16
+    {{1, 2, 1, 1, 2, 1}, 0, 3, 4, true, false},
+    // Gaussian 5x5, 1 4 6 4 1 each way, sum 256
+    {{1, 4, 6, 4, 1, 1, 4, 6, 4, 1}, 0, 5, 8, true, false},
+    // Sharpen, sum 1
+    {{0, -1, 0,  //
+      -1, 5, -1, //
+      0, -1, 0},
+     0, 3, 0, false, false},
+    // Unsharp mask, twice the pixel less the 5x5 Gaussian, x256
+    {{-1, -4, -6, -4, -1,    //
+      -4, -16, -24, -16, -4, //
+      -6, -24, 476, -24, -6, //
+      -4, -16, -24, -16, -4, //
+      -1, -4, -6, -4, -1},
+     0, 5, 8, false, false},
+    // Emboss, sum 0, on mid-gray
+    {{-2, -1, 0, //
+      -1, 0, 1,  //
+      0, 1, 2},
+     128, 3, 0, false, false},
+    // Sobel, |Gx| + |Gy| up to 2040, scaled to 255
+    {{-1, 0, 1, //
+      -2, 0, 2, //
+      -1, 0, 1},
+     0, 3, 3, false, true},
+    // Scharr, |Gx| + |Gy| up to 8160, scaled to 255
+    {{-3, 0, 3,   //
+      -10, 0, 10, //
+      -3, 0, 3},
+     0, 3, 5, false, true},
+};
+
+OV7670_kernel OV7670_kernel_preset(OV7670_kernel_type type) {
+  if ((unsigned)type >= sizeof ov7670_kernels / sizeof ov7670_kernels[0]) {
+    type = OV7670_KERNEL_GAUSSIAN3;
+  }
+  return ov7670_kernels[type];
+}
+
+// Weighted sum of the window whose top-left sample is col, weights
+// transposed (row and column swapped) if set.
+OV7670_SPECIALIZE int32_t ov7670_window_sum(const uint8_t *col,
+                                            const int16_t *weights,
+                                            uint8_t size, bool transpose) {
+  int32_t sum = 0;
+  for (uint8_t j = 0; j < size; j++, col += size) { // Each column
+    for (uint8_t i = 0; i < size; i++) {            // Each row
+      sum += weights[transpose ? j * size + i : i * size + j] * col[i];
+    }
+  }
+  return sum;
+}
+
+// Vertical taps down each of columns columns of the row buffers.
+OV7670_SPECIALIZE void ov7670_column_sums(const uint8_t *col,
+                                          const int16_t *taps, int16_t *sums,
+                                          uint16_t columns, uint8_t size) {
+  for (uint16_t x = 0; x < columns; x++, col += size) {
+    int32_t sum = 0;
+    for (uint8_t i = 0; i < size; i++) {
+      sum += taps[i] * col[i];
+    }
+    sums[x] = sum;
+  }
+}
+
+// Horizontal taps along column sums.
+OV7670_SPECIALIZE int32_t ov7670_row_sum(const int16_t *sums,
+                                         const int16_t *taps, uint8_t size) {
+  int32_t sum = 0;
+  for (uint8_t j = 0; j < size; j++) {
+    sum += taps[j] * sums[j];
+  }
+  return sum;
+}
+
+// Convolution sum to an output sample: shifted down (rounding), biased
+// and clipped to 0-max.
+static inline uint8_t ov7670_conv_result(int32_t sum, uint8_t shift,
+                                         int16_t bias, uint8_t max) {
+  if (shift) {
+    sum = (sum + (1 << (shift - 1))) >> shift;
+  }
+  sum += bias;
+  return (sum < 0) ? 0 : (sum > max) ? max : sum;
+}
+
+// One row of convolution results from one channel of the row buffers (chan
+// is the window's top row), stored as ov7670_median_row() does: step 0
+// ORs them into uint16_t out[] at bit position shift, else bytes step
+// apart. sums is room for two rows of column sums, for separable kernels.
+OV7670_SPECIALIZE void ov7670_conv_row(const uint8_t *chan, void *out,
+                                       uint16_t width, uint8_t shift,
+                                       uint8_t step,
+                                       const OV7670_kernel *kernel,
+                                       int16_t bias, uint8_t max,
+                                       int16_t *sums, uint8_t size) {
+  int16_t w[25]; // Local copy, so stores to out can't alias it
+  memcpy(w, kernel->weights, sizeof w);
+  bool separable = kernel->separable, gradient = kernel->gradient;
+  uint8_t div = kernel->shift;
+  uint16_t columns = width + size - 1;
+  uint16_t x;
+  int32_t sum;
+  if (separable) {
+    ov7670_column_sums(chan, &w[size], sums, columns, size);
+    if (gradient) { // Transposed: the taps change places
+      ov7670_column_sums(chan, w, &sums[columns], columns, size);
+    }
+  }
+  for (x = 0; x < width; x++, chan += size) {
+    if (separable) {
+      sum = ov7670_row_sum(&sums[x], w, size);
+      if (gradient) {
+        sum = abs(sum) + abs(ov7670_row_sum(&sums[columns + x], &w[size],
+                                            size));
+      }
+    } else {
+      sum = ov7670_window_sum(chan, w, size, false);
+      if (gradient) {
+        sum = abs(sum) + abs(ov7670_window_sum(chan, w, size, true));
+      }
+    }
+    uint8_t result = ov7670_conv_result(sum, div, bias, max);
+    if (step) {
+      ((uint8_t *)out)[x * step] = result;
+    } else {
+      ((uint16_t *)out)[x] |= result << shift;
+    }
+  }
+}
+
+// Each window size as a function of its own (used for every channel and
+// row), so the loops over it unroll.
+typedef void (*ov7670_conv_func)(const uint8_t *, void *, uint16_t, uint8_t,
+                                 uint8_t, const OV7670_kernel *, int16_t,
+                                 uint8_t, int16_t *);
+
+static void ov7670_conv_row3(const uint8_t *chan, void *out, uint16_t width,
+                             uint8_t shift, uint8_t step,
+                             const OV7670_kernel *kernel, int16_t bias,
+                             uint8_t max, int16_t *sums) {
+  ov7670_conv_row(chan, out, width, shift, step, kernel, bias, max, sums, 3);
+}
+
+static void ov7670_conv_row5(const uint8_t *chan, void *out, uint16_t width,
+                             uint8_t shift, uint8_t step,
+                             const OV7670_kernel *kernel, int16_t bias,
+                             uint8_t max, int16_t *sums) {
+  ov7670_conv_row(chan, out, width, shift, step, kernel, bias, max, sums, 5);
+}
+
+// Convolution of RGB565 pixels, swap as per ov7670_swap(). As the 3x3
+// median, but the row buffers are size rows deep: the window's top row is
+// at rptr[0] and its bottom row at rptr[size - 1], loaded from image row
+// y + size / 2 (or repeating the last row, past the bottom).
+OV7670_SPECIALIZE OV7670_status ov7670_convolve_rgb(
+    const OV7670_view *view, const OV7670_kernel *kernel,
+    OV7670_scratch *scratch, bool swap) {
+  uint16_t width = view->width, height = view->height;
+  uint8_t size = kernel->size, pad = size / 2, s;
+  uint32_t buf_bytes_per_channel = OV7670_FILTER_CHANNEL_BYTES(width, size);
+  uint32_t buf_bytes = OV7670_CONV_ROWS_BYTES(width, size);
+  uint8_t *buf = (uint8_t *)ov7670_scratch_alloc(
+      scratch, kernel->separable ? OV7670_CONV_BYTES(width, size) : buf_bytes);
+  if (!buf) {
+    return OV7670_STATUS_ERR_MALLOC;
+  }
+  int16_t *sums = (int16_t *)&buf[buf_bytes];
+  ov7670_conv_func row_func = (size == 5) ? ov7670_conv_row5 : ov7670_conv_row3;
+  int16_t bias5 = kernel->bias >> 3, bias6 = kernel->bias >> 2;
+  uint16_t row = 0; // Current offset into each channel's buffer
+  uint8_t *rptr = buf;
+
+  // Rows above the image repeat its first row
+  OV7670_filter_row_prep(view->pixels, &rptr[pad], width,
+                         buf_bytes_per_channel, size, swap);
+  for (s = 0; s < pad; s++) {
+    OV7670_filter_row_copy(&rptr[pad], &rptr[s], width + size - 1,
+                           buf_bytes_per_channel, size);
+  }
+  for (s = pad + 1; s < size - 1; s++) { // Rows below it, but the last
+    if (s - pad < height) {
+      OV7670_filter_row_prep(OV7670_view_row(view, s - pad), &rptr[s], width,
+                             buf_bytes_per_channel, size, swap);
+    } else {
+      OV7670_filter_row_copy(&rptr[s - 1], &rptr[s], width + size - 1,
+                             buf_bytes_per_channel, size);
+    }
+  }
+
+  for (uint16_t y = 0; y < height; y++) {
+    if (y + pad < height) { // Bottom row of window
+      OV7670_filter_row_prep(OV7670_view_row(view, y + pad), &rptr[size - 1],
+                             width, buf_bytes_per_channel, size, swap);
+    } else {
+      OV7670_filter_row_copy(&rptr[size - 2], &rptr[size - 1],
+                             width + size - 1, buf_bytes_per_channel, size);
+    }
+    uint16_t *ptr = OV7670_view_row(view, y);
+    memset(ptr, 0, width * 2);
+    row_func(rptr, ptr, width, 11, 0, kernel, bias5, 31, sums);
+    row_func(&rptr[buf_bytes_per_channel], ptr, width, 5, 0, kernel, bias6,
+             63, sums);
+    row_func(&rptr[buf_bytes_per_channel * 2], ptr, width, 0, 0, kernel,
+             bias5, 31, sums);
+    if (swap) {
+      for (uint16_t x = 0; x < width; x++) {
+        ptr[x] = ov7670_swap(ptr[x], swap); // Back to buffer's endian
+      }
+    }
+    if (++row > OV7670_FILTER_SLACK) { // Out of tail, move rows back
+      ov7670_filter_rewind(buf, width, buf_bytes_per_channel, row, size);
+      row = 0;
+    }
+    rptr = &buf[row];
+  }
+  ov7670_scratch_free(scratch, buf);
+  return OV7670_STATUS_OK;
+}
+
+// Convolution of the Y plane of a YUV view, as ov7670_convolve_rgb() with
+// one channel, and as ov7670_filter_yuv() for the plane.
+static OV7670_status ov7670_convolve_yuv(const OV7670_view *view,
+                                         const OV7670_kernel *kernel,
+                                         OV7670_scratch *scratch) {
+  ov7670_plane plane = ov7670_yuv_plane(view, 0);
+  uint16_t width = plane.width, height = plane.height;
+  uint8_t size = kernel->size, pad = size / 2, s;
+  uint32_t buf_bytes = (OV7670_FILTER_CHANNEL_BYTES(width, size) + 3) & ~3;
+  uint32_t sums_bytes = (uint32_t)(width + size - 1) * 4;
+  uint8_t *buf = (uint8_t *)ov7670_scratch_alloc(
+      scratch, buf_bytes + (kernel->separable ? sums_bytes : 0));
+  if (!buf) {
+    return OV7670_STATUS_ERR_MALLOC;
+  }
+  int16_t *sums = (int16_t *)&buf[buf_bytes];
+  ov7670_conv_func row_func = (size == 5) ? ov7670_conv_row5 : ov7670_conv_row3;
+  uint16_t row = 0;
+  uint8_t *ptr = buf;
+
+  ov7670_plane_row_prep(plane.base, &ptr[pad], width, plane.step, size);
+  for (s = 0; s < pad; s++) {
+    ov7670_plane_row_copy(&ptr[pad], &ptr[s], width + size - 1, size);
+  }
+  for (s = pad + 1; s < size - 1; s++) {
+    if (s - pad < height) {
+      ov7670_plane_row_prep(ov7670_plane_row(&plane, s - pad), &ptr[s], width,
+                            plane.step, size);
+    } else {
+      ov7670_plane_row_copy(&ptr[s - 1], &ptr[s], width + size - 1, size);
+    }
+  }
+
+  for (uint16_t y = 0; y < height; y++) {
+    if (y + pad < height) {
+      ov7670_plane_row_prep(ov7670_plane_row(&plane, y + pad),
+                            &ptr[size - 1], width, plane.step, size);
+    } else {
+      ov7670_plane_row_copy(&ptr[size - 2], &ptr[size - 1], width + size - 1,
+                            size);
+    }
+    row_func(ptr, ov7670_plane_row(&plane, y), width, 0, plane.step, kernel,
+             kernel->bias, 255, sums);
+    if (++row > OV7670_FILTER_SLACK) { // Out of tail, move rows back
+      memmove(buf, &buf[row], (uint32_t)(width + size - 1) * size);
+      row = 0;
+    }
+    ptr = &buf[row];
+  }
+  ov7670_scratch_free(scratch, buf);
+  return OV7670_STATUS_OK;
+}
+
+OV7670_status OV7670_image_convolve_view(const OV7670_view *view,
+                                         const OV7670_kernel *kernel,
+                                         OV7670_scratch *scratch) {
+  if (!view->width || !view->height ||
+      ((kernel->size != 3) && (kernel->size != 5))) {
+    return OV7670_STATUS_OK;
+  }
+  if (view->space == OV7670_COLOR_RGB) {
+    if (view->order == OV7670_ORDER_BIG) {
+      return ov7670_convolve_rgb(view, kernel, scratch, true);
+    } else {
+      return ov7670_convolve_rgb(view, kernel, scratch, false);
     }
-  } else { // YUV
-    // Not yet supported. Tricky because of alternating U/V pixels.
   }
+  return ov7670_convolve_yuv(view, kernel, scratch); // Y only
 }
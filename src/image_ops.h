@@ -11,6 +11,145 @@
 // to implement as such. Image is overwritten -- destination buffer is
 // always the same as the source buffer, same dimensions, same colorspace.
 
+// Functions that work on RGB565 values come in two forms: the original,
+// for big-endian pixels as the camera sends them, and an _order() version
+// for data in either byte order (see OV7670_order). With
+// OV7670_ORDER_LITTLE, the latter runs without any per-pixel byte swaps.
+// YUV data is worked on bytewise, so order doesn't matter there, nor for
+// OV7670_image_negative().
+
+// Each op also has a _view() version working on an OV7670_view, which
+// describes a rectangle of pixels that needn't be a whole, tightly packed
+// frame: a crop, tile or strip of a larger buffer, with its own row
+// stride. These work in place on just those pixels, nothing is copied out
+// of the larger image. The other forms are shorthand for a view of a
+// packed width x height image.
+
+/** Image or sub-rectangle of one, as worked on by the _view() ops */
+typedef struct {
+  uint16_t *pixels;        ///< Top-left pixel
+  uint16_t width;          ///< Width in pixels
+  uint16_t height;         ///< Height in pixels
+  uint32_t stride;         ///< Bytes from the start of one row to the next
+  OV7670_colorspace space; ///< Pixel format, RGB565 or YUV
+  OV7670_order order;      ///< Byte order of pixels (Y first if BIG)
+} OV7670_view;
+
+/** Point ops that can be chained in an OV7670_pipeline */
+typedef enum {
+  OV7670_POINT_NEGATIVE = 0, ///< As OV7670_image_negative(), no parameter
+  OV7670_POINT_THRESHOLD,    ///< As OV7670_image_threshold(), param 0-255
+  OV7670_POINT_POSTERIZE,    ///< As OV7670_image_posterize(), param levels
+} OV7670_point_op;
+
+#define OV7670_PIPELINE_MAX 8 ///< Most steps in one OV7670_pipeline
+
+// A chain of point ops (the same function of each pixel's own value,
+// nothing else) compiled into lookup tables, so applying any number of
+// them is a single pass over the image. The ops available all work on
+// each color channel on its own, so by default the tables are per channel
+// (32 + 64 + 32 entries for RGB565, 256 for YUV bytes, all in the struct);
+// a caller-supplied 65536-entry table instead makes RGB565 a single
+// lookup per pixel, at the cost of 128 KB. Either way, tables are rebuilt
+// lazily, on the first apply after steps or parameters change. Elements
+// are maintained by the OV7670_pipeline_*() functions, don't set them.
+typedef struct {
+  struct {
+    OV7670_point_op op; ///< Operation
+    uint8_t param;      ///< Threshold level or posterize levels
+  } step[OV7670_PIPELINE_MAX];
+  uint16_t *lut;          ///< Full RGB565 table, or NULL for per-channel
+  uint16_t red[32];       ///< Red channel table, in place in 565 value
+  uint16_t green[64];     ///< Green channel table, in place in 565 value
+  uint16_t blue[32];      ///< Blue channel table
+  uint8_t yuv[256];       ///< Table for Y, U and V bytes
+  uint8_t num_steps;      ///< Number of steps in use
+  bool swap;              ///< Output in opposite byte order to input
+  bool dirty;             ///< Steps changed since tables were built
+  bool lut_valid;         ///< lut[] built (for lut_order input)
+  OV7670_order lut_order; ///< Input byte order lut[] was built for
+} OV7670_pipeline;
+
+// Filters that look at neighboring pixels (median, edges) need working
+// memory, a few rows' worth. The original forms malloc() and free() it on
+// each call, and quietly do nothing if that fails. The _view() forms can
+// take an OV7670_scratch arena instead -- memory set aside once, e.g. at
+// startup, sized with OV7670_scratch_bytes() -- and never touch the heap,
+// returning OV7670_STATUS_ERR_MALLOC if the arena is too small (or with a
+// NULL arena, if malloc() fails). Don't share one arena between code in an
+// interrupt (e.g. a strip callback) and code it might interrupt.
+
+/** Caller-supplied working memory for the _view() filters */
+typedef struct {
+  uint8_t *base; ///< Start of memory
+  uint32_t size; ///< Size of memory, in bytes
+  uint32_t used; ///< Bytes currently lent to a filter
+} OV7670_scratch;
+
+// A summed-area table (integral image) holds, for each point, the sum of
+// one channel over every pixel above and left of it, so the sum over any
+// rectangle is four lookups however large it is -- box averages, local
+// means, feature sums. Entries are 32 bits, or to halve the memory, 16
+// bits kept modulo 65536: a lookup's sum is still exact as long as the
+// true sum can't reach 65536 (up to 257 Y samples, e.g. 16x16, or 1040
+// green ones), the wraparound cancelling in the subtraction. Larger boxes
+// are summed as several tiles within that limit, so results are always
+// exact, but cost more lookups the larger the box. The box filters below
+// keep only a few rows of such a table, so need no more memory than a
+// median.
+
+/** Channel summed by OV7670_integral_build() and the box filters */
+typedef enum {
+  OV7670_CHANNEL_Y = 0, ///< Y of YUV, 0-255 (green of RGB565)
+  OV7670_CHANNEL_RED,   ///< Red of RGB565, 0-31 (Y of YUV)
+  OV7670_CHANNEL_GREEN, ///< Green of RGB565, 0-63 (Y of YUV)
+  OV7670_CHANNEL_BLUE,  ///< Blue of RGB565, 0-31 (Y of YUV)
+} OV7670_channel;
+
+/** Summed-area table of one channel of a view */
+typedef struct {
+  void *sums;      ///< (width + 1) x (height + 1) entries, first row & col 0
+  uint16_t width;  ///< Width of the image summed, in pixels
+  uint16_t height; ///< Height of the image summed, in pixels
+  uint8_t max;     ///< Largest value of the channel (255, 63 or 31)
+  bool wide;       ///< uint32_t entries, else uint16_t (modulo 65536)
+} OV7670_integral;
+
+// Convolution replaces each pixel with a weighted sum of the square of
+// pixels around it, 3x3 or 5x5: blur, sharpen, emboss, gradients, all the
+// same code with different integer weights. The sum is divided by a power
+// of 2 (shift, rounded), offset by bias, and clipped. A separable kernel
+// (one that's a horizontal row of taps times a vertical column, as
+// Gaussians are) gives its two sets of taps instead of the whole square,
+// and runs in 2 * size multiplies per pixel rather than size * size; the
+// vertical taps' sum over any column of 8-bit samples must fit in 16 bits
+// (taps adding up to 128 or less, in absolute value, always do). A
+// gradient kernel is also applied transposed (e.g. Sobel X, then Sobel Y),
+// giving |Gx| + |Gy|, an edge strength with no preferred direction. The
+// OV7670_kernel_preset() kernels cover the common cases.
+
+/** Integer convolution kernel for OV7670_image_convolve_view() */
+typedef struct {
+  int16_t weights[25]; ///< size x size, row-major, or if separable, size
+                       ///< horizontal taps then size vertical
+  int16_t bias;        ///< Added to results, in 8-bit units (e.g. 128)
+  uint8_t size;        ///< 3 or 5
+  uint8_t shift;       ///< Results are divided by 1 << shift, rounded
+  bool separable;      ///< weights are horizontal & vertical taps
+  bool gradient;       ///< Result is |kernel| + |transposed kernel|
+} OV7670_kernel;
+
+/** Kernels available from OV7670_kernel_preset() */
+typedef enum {
+  OV7670_KERNEL_GAUSSIAN3 = 0, ///< 3x3 Gaussian blur (separable 1 2 1)
+  OV7670_KERNEL_GAUSSIAN5,     ///< 5x5 Gaussian blur (separable 1 4 6 4 1)
+  OV7670_KERNEL_SHARPEN,       ///< 3x3 sharpen (5 center, -1 each side)
+  OV7670_KERNEL_UNSHARP,       ///< 5x5 unsharp mask (2x - 5x5 Gaussian)
+  OV7670_KERNEL_EMBOSS,        ///< 3x3 emboss, relief on mid-gray
+  OV7670_KERNEL_SOBEL,         ///< 3x3 Sobel gradient magnitude
+  OV7670_KERNEL_SCHARR,        ///< 3x3 Scharr gradient magnitude
+} OV7670_kernel_type;
+
 // These are declared in an extern "C" so Arduino platform C++ code can
 // access them.
 
@@ -18,11 +157,40 @@
 extern "C" {
 #endif
 
+// First pixel of row y of a view.
+static inline uint16_t *OV7670_view_row(const OV7670_view *view, uint16_t y) {
+  return (uint16_t *)((uint8_t *)view->pixels + (uint32_t)y * view->stride);
+}
+
+// Set up an arena in memory of the given size (ideally 32-bit aligned).
+extern void OV7670_scratch_init(OV7670_scratch *scratch, void *base,
+                                uint32_t size);
+
+// Bytes of scratch arena any filter needs for images up to width pixels
+// wide, for median or box filter windows up to the given radius (1 for
+// 3x3, the other filters' size). The memory needed depends on width only,
+// not height.
+extern uint32_t OV7670_scratch_bytes(uint16_t width, uint8_t radius);
+
+// View of a whole, packed image (stride is width * 2).
+extern OV7670_view OV7670_view_frame(OV7670_colorspace space,
+                                     OV7670_order order, uint16_t *pixels,
+                                     uint16_t width, uint16_t height);
+
+// View of a rectangle within another view, clipped to its bounds (a
+// rectangle wholly outside returns a 0x0 view, which ops ignore). Same
+// stride, format and byte order as the original. With YUV data, keep x
+// even so rows still start on a Y/U pair.
+extern OV7670_view OV7670_view_crop(const OV7670_view *view, uint16_t x,
+                                    uint16_t y, uint16_t width,
+                                    uint16_t height);
+
 // Image invert -- produces a negative image. This could probably be done
 // in-camera with a different gamma curve or something, but for now it's
 // available as a postprocess filter. Works in RGB and YUV colorspaces.
 extern void OV7670_image_negative(uint16_t *pixels, uint16_t width,
                                   uint16_t height);
+extern void OV7670_image_negative_view(const OV7670_view *view);
 
 // Image threshold -- decimates an image to only its min/max values
 // (ostensibly "black and white," but works on color channels separately
@@ -31,6 +199,12 @@ extern void OV7670_image_negative(uint16_t *pixels, uint16_t width,
 extern void OV7670_image_threshold(OV7670_colorspace space, uint16_t *pixels,
                                    uint16_t width, uint16_t height,
                                    uint8_t threshold);
+extern void OV7670_image_threshold_order(OV7670_colorspace space,
+                                         OV7670_order order, uint16_t *pixels,
+                                         uint16_t width, uint16_t height,
+                                         uint8_t threshold);
+extern void OV7670_image_threshold_view(const OV7670_view *view,
+                                        uint8_t threshold);
 
 // Image posterize -- decimates an image to a limited number of brightness
 // levels -- 2 to 32 levels in RGB colorspace, 2 to 255 levels in YUV.
@@ -39,6 +213,12 @@ extern void OV7670_image_threshold(OV7670_colorspace space, uint16_t *pixels,
 extern void OV7670_image_posterize(OV7670_colorspace space, uint16_t *pixels,
                                    uint16_t width, uint16_t height,
                                    uint8_t levels);
+extern void OV7670_image_posterize_order(OV7670_colorspace space,
+                                         OV7670_order order, uint16_t *pixels,
+                                         uint16_t width, uint16_t height,
+                                         uint8_t levels);
+extern void OV7670_image_posterize_view(const OV7670_view *view,
+                                        uint8_t levels);
 
 // Image mosaic -- or "shower door effect," downsamples an image into
 // rectangular "tiles" of selectable width and height, each tile's color
@@ -52,15 +232,204 @@ extern void OV7670_image_posterize(OV7670_colorspace space, uint16_t *pixels,
 extern void OV7670_image_mosaic(OV7670_colorspace space, uint16_t *pixels,
                                 uint16_t width, uint16_t height,
                                 uint8_t tile_width, uint8_t tile_height);
+extern void OV7670_image_mosaic_order(OV7670_colorspace space,
+                                      OV7670_order order, uint16_t *pixels,
+                                      uint16_t width, uint16_t height,
+                                      uint8_t tile_width, uint8_t tile_height);
+extern void OV7670_image_mosaic_view(const OV7670_view *view,
+                                     uint8_t tile_width, uint8_t tile_height);
 
-// 3x3 median filter, WIP, not yet available
+// 3x3 median filter. Reduces pixel "snow" while keeping edges.
+// For YUV, only Y is filtered (see OV7670_image_median_yuv()).
 extern void OV7670_image_median(OV7670_colorspace space, uint16_t *pixels,
                                 uint16_t width, uint16_t height);
+extern void OV7670_image_median_order(OV7670_colorspace space,
+                                      OV7670_order order, uint16_t *pixels,
+                                      uint16_t width, uint16_t height);
+extern OV7670_status OV7670_image_median_view(const OV7670_view *view,
+                                              OV7670_scratch *scratch);
 
-// Edge detection, WIP, not yet available
+// Median filter over a larger square window, (2 * radius + 1) pixels on
+// a side: 2 for 5x5, 3 for 7x7, up to 7. Removes bigger specks but
+// softens more. Radius 1 is the same as OV7670_image_median_view(). Needs
+// about (width + 2 * radius) * (2 * radius + 1) * 3 bytes of scratch,
+// e.g. 7K for 7x7 on a 320 pixel wide image.
+extern OV7670_status OV7670_image_median_radius_view(const OV7670_view *view,
+                                                     uint8_t radius,
+                                                     OV7670_scratch *scratch);
+
+// Edge detection, WIP. For YUV, only Y (see OV7670_image_edges_yuv()).
 extern void OV7670_image_edges(OV7670_colorspace space, uint16_t *pixels,
                                uint16_t width, uint16_t height,
                                uint8_t sensitivity);
+extern void OV7670_image_edges_order(OV7670_colorspace space,
+                                     OV7670_order order, uint16_t *pixels,
+                                     uint16_t width, uint16_t height,
+                                     uint8_t sensitivity);
+extern OV7670_status OV7670_image_edges_view(const OV7670_view *view,
+                                             uint8_t sensitivity,
+                                             OV7670_scratch *scratch);
+
+// YUV versions of mosaic, median and edges work directly on the 8-bit
+// Y bytes, a single channel with nothing to unpack, so they're several
+// times cheaper than RGB565 -- handy for grayscale vision work. The plain
+// and _view() forms do Y only when given YUV data, leaving U and V as
+// they were; these can optionally do U and V too (chroma true), each at
+// half horizontal resolution as stored (mosaic tiles are half as many
+// samples wide, rounding up, and median & edges windows are 3 chroma
+// samples, 6 pixels, across). Edges output is 255 or 0 in each plane
+// filtered, and sensitivity is scaled to 8-bit samples (x8). Given RGB565
+// data, these are the same as the _view() versions, chroma ignored.
+extern void OV7670_image_mosaic_yuv(const OV7670_view *view,
+                                    uint8_t tile_width, uint8_t tile_height,
+                                    bool chroma);
+extern OV7670_status OV7670_image_median_yuv(const OV7670_view *view,
+                                             uint8_t radius, bool chroma,
+                                             OV7670_scratch *scratch);
+extern OV7670_status OV7670_image_edges_yuv(const OV7670_view *view,
+                                            uint8_t sensitivity, bool chroma,
+                                            OV7670_scratch *scratch);
+
+// Start an empty pipeline (applying it then changes nothing). lut is
+// space for 65536 uint16_t's (128 KB) for the single-lookup RGB565 table,
+// or NULL to use only the small per-channel tables in the struct.
+extern void OV7670_pipeline_init(OV7670_pipeline *pipeline, uint16_t *lut);
+
+// Remove all steps from a pipeline.
+extern void OV7670_pipeline_clear(OV7670_pipeline *pipeline);
+
+// Append a step to a pipeline; steps run in the order added. param is the
+// threshold level or posterize levels, as for the single-op functions
+// (ignored for OV7670_POINT_NEGATIVE). Returns the step's index for
+// OV7670_pipeline_set(), or -1 if the pipeline is full.
+extern int8_t OV7670_pipeline_add(OV7670_pipeline *pipeline,
+                                  OV7670_point_op op, uint8_t param);
+
+// Change the parameter of an existing step, e.g. a threshold following a
+// slider. Tables are only rebuilt if the value actually changes.
+extern void OV7670_pipeline_set(OV7670_pipeline *pipeline, uint8_t index,
+                                uint8_t param);
+
+// Fuse a byte swap into the pipeline: RGB565 output is then in the
+// opposite byte order to the view's (e.g. camera big-endian in, native
+// little-endian out for a BMP file), at no extra cost per pixel. The
+// view struct isn't changed, so track the new order yourself. YUV data
+// is never swapped.
+extern void OV7670_pipeline_swap(OV7670_pipeline *pipeline, bool swap);
+
+// Run a pipeline's steps on a view, in one pass, rebuilding its tables
+// first if needed.
+extern void OV7670_pipeline_apply(OV7670_pipeline *pipeline,
+                                  const OV7670_view *view);
+
+// OV7670_Y2RGB565_order() on each row of a YUV view. The view's pixels
+// are RGB565 afterward, though the struct still says YUV.
+extern void OV7670_Y2RGB565_view(const OV7670_view *view);
+
+// Convert YUV pixels to full-color RGB565 (BT.601, fixed point), unlike
+// OV7670_Y2RGB565(), which keeps only brightness -- e.g. to show a color
+// preview of frames captured as YUV for analysis. src and dst may be the
+// same (in place) or separate. Output is in the same byte order as the
+// input, so big-endian (as displays want it) for camera-order data. len
+// should be even, U and V being shared by pixel pairs.
+extern void OV7670_YUV2RGB565(const uint16_t *src, uint16_t *dst,
+                              uint32_t len, OV7670_order order);
+
+// OV7670_YUV2RGB565() on a YUV view, in place if dst is NULL, else to a
+// packed width x height buffer. As with OV7670_Y2RGB565_view(), the view
+// struct still says YUV afterward.
+extern void OV7670_YUV2RGB565_view(const OV7670_view *view, uint16_t *dst);
+
+// Copy the Y (brightness) bytes of len YUV pixels to a contiguous 8-bit
+// plane, half the memory, so grayscale code needn't stride over chroma.
+// dst may be (uint8_t *)src, compacting in place at the front of the
+// buffer and leaving the back half free for other use.
+extern void OV7670_Y_extract(const uint16_t *src, uint8_t *dst, uint32_t len,
+                             OV7670_order order);
+
+// OV7670_Y_extract() on a YUV view, to a width x height byte buffer, or
+// if dst is NULL, in place starting at the view's first pixel (rows
+// packed, so with a crop of a larger image, pixels outside the crop are
+// overwritten too). Returns the plane, or NULL if the view isn't YUV.
+extern uint8_t *OV7670_Y_extract_view(const OV7670_view *view, uint8_t *dst);
+
+// Bytes of memory OV7670_integral_build() needs for an image of the given
+// size, 32-bit (wide) or 16-bit entries: the table, plus a row of working
+// space. E.g. 39 KB 16-bit for 160x120, 77 KB wide.
+extern uint32_t OV7670_integral_bytes(uint16_t width, uint16_t height,
+                                      bool wide);
+
+// Build a summed-area table of one channel of a view in mem (sized with
+// OV7670_integral_bytes()). YUV views are always summed by Y, whatever
+// channel says.
+extern void OV7670_integral_build(OV7670_integral *integral, void *mem,
+                                  bool wide, const OV7670_view *view,
+                                  OV7670_channel channel);
+
+// Sum of the channel over a rectangle of a 16-bit table whose sum could
+// reach 65536, in tiles that can't. OV7670_integral_sum() calls this when
+// needed, there's no reason to call it directly.
+extern uint32_t OV7670_integral_sum_tiled(const OV7670_integral *integral,
+                                          uint16_t x, uint16_t y,
+                                          uint16_t width, uint16_t height);
+
+// Sum of the channel over a rectangle, which must lie within the image.
+// One lookup of four entries, or with a 16-bit table and a rectangle of
+// more than 65535 / max pixels, several.
+static inline uint32_t OV7670_integral_sum(const OV7670_integral *integral,
+                                           uint16_t x, uint16_t y,
+                                           uint16_t width, uint16_t height) {
+  uint32_t row = integral->width + 1;
+  uint32_t top = y * row + x, bottom = (y + height) * row + x;
+  if (integral->wide) {
+    const uint32_t *s = (const uint32_t *)integral->sums;
+    return s[bottom + width] - s[bottom] - s[top + width] + s[top];
+  }
+  if ((uint32_t)width * height * integral->max > 65535) {
+    return OV7670_integral_sum_tiled(integral, x, y, width, height);
+  }
+  const uint16_t *s = (const uint16_t *)integral->sums;
+  return (uint16_t)(s[bottom + width] - s[bottom] - s[top + width] + s[top]);
+}
+
+// Rounded average of the channel over a rectangle, clipped to the image
+// (0 if that leaves nothing).
+extern uint8_t OV7670_integral_mean(const OV7670_integral *integral,
+                                    uint16_t x, uint16_t y, uint16_t width,
+                                    uint16_t height);
+
+// Box blur: each pixel becomes the average of the (2 * radius + 1) square
+// around it (just the part inside the view, at the edges), radius 1 to 7.
+// Unlike a median, the cost per pixel is the same for any radius. RGB565
+// channels are each blurred; for YUV, only Y. Scratch needed is within
+// OV7670_scratch_bytes() for the same radius.
+extern OV7670_status OV7670_image_box_blur_view(const OV7670_view *view,
+                                                uint8_t radius,
+                                                OV7670_scratch *scratch);
+
+// Adaptive (local mean) threshold: each pixel goes to 0 if it's darker
+// than the average of the (2 * radius + 1) square around it by more than
+// bias (0-255 scale), else to full brightness. Unlike a global threshold,
+// this copes with uneven lighting, e.g. for text or markers. radius is 1
+// to 7, and as with box blur, the cost doesn't depend on it. RGB565
+// channels are each thresholded; for YUV, Y only.
+extern OV7670_status OV7670_image_local_threshold_view(const OV7670_view *view,
+                                                       uint8_t radius,
+                                                       uint8_t bias,
+                                                       OV7670_scratch *scratch);
+
+// One of the stock kernels, e.g. to use as is or to start from.
+extern OV7670_kernel OV7670_kernel_preset(OV7670_kernel_type type);
+
+// Convolve a view with a kernel, in place, in one pass down the image.
+// Edge pixels are repeated to fill windows reaching past the view. RGB565
+// channels are each convolved (bias scaled to their 5 or 6 bits); for
+// YUV, only Y. Working memory is a few rows, within OV7670_scratch_bytes()
+// with radius 1 for 3x3 kernels and 2 for 5x5. A size other than 3 or 5
+// does nothing.
+extern OV7670_status OV7670_image_convolve_view(const OV7670_view *view,
+                                                const OV7670_kernel *kernel,
+                                                OV7670_scratch *scratch);
 
 #ifdef __cplusplus
 };
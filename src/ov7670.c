@@ -3,6 +3,7 @@
 // SPDX-License-Identifier: MIT
 
 #include "ov7670.h"
+#include <string.h>
 
 // REQUIRED EXTERN FUNCTIONS -----------------------------------------------
 
@@ -41,6 +42,18 @@ void OV7670_write_list(void *platform, const OV7670_command *cmd) {
   }
 }
 
+// Same as OV7670_write_list(), for OV7670_BOOT_FAST: the 1 ms delay only
+// follows COM7 (reset, output format and size). Other register writes in
+// this file (OV7670_frame_control() etc.) have always been back-to-back.
+static void OV7670_write_list_fast(void *platform, const OV7670_command *cmd) {
+  for (int i = 0; cmd[i].reg != 0xFF && cmd[i].value != 0xFF; i++) {
+    OV7670_write_register(platform, cmd[i].reg, cmd[i].value);
+    if (cmd[i].reg == OV7670_REG_COM7) {
+      OV7670_delay_ms(1);
+    }
+  }
+}
+
 // Write a list of commands of specified length to the camera.
 // Similar to be above function, but based on a length rather than
 // a 0xFF/0xFF end-of-list (register 0xFF is a thing on OV2640 so
@@ -53,6 +66,187 @@ void OV7670_write_list_len(void *platform, const OV7670_command *cmd, int len) {
   }
 }
 
+// REGISTER CACHE ----------------------------------------------------------
+
+// Registers whose contents can change without being written (automatic
+// gain/exposure/white balance results and frame averages), or read-only
+// ID registers, which are always read from the camera so detection code
+// sees the real thing. These are never cached.
+static bool OV7670_cache_volatile(uint8_t reg) {
+  switch (reg) {
+  case OV7670_REG_GAIN:  // AGC
+  case OV7670_REG_BLUE:  // AWB
+  case OV7670_REG_RED:   // AWB
+  case OV7670_REG_VREF:  // AGC bits 9:8 share this with window bits
+  case OV7670_REG_COM1:  // AEC bits 1:0
+  case OV7670_REG_BAVE:  // Averages...
+  case OV7670_REG_GbAVE:
+  case OV7670_REG_AECHH: // AEC bits 15:10
+  case OV7670_REG_RAVE:
+  case OV7670_REG_PID: // IDs...
+  case OV7670_REG_VER:
+  case OV7670_REG_AECH: // AEC bits 9:2
+  case OV7670_REG_MIDH:
+  case OV7670_REG_MIDL:
+  case OV7670_REG_YAVE:
+  case OV7670_REG_GGAIN: // AWB
+    return true;
+  }
+  return false;
+}
+
+void OV7670_cache_clear(OV7670_regcache *cache) {
+  memset(cache->valid, 0, sizeof cache->valid);
+}
+
+// Value is known for a register, either written (any register) or read
+// (if not volatile). For volatile registers, this is the last value
+// written -- not necessarily what's there now, but what profiles restore.
+static bool OV7670_cache_known(const OV7670_regcache *cache, uint8_t reg) {
+  return cache->valid[reg >> 3] & (1 << (reg & 7));
+}
+
+int OV7670_cache_read(const OV7670_regcache *cache, uint8_t reg) {
+  if (OV7670_cache_known(cache, reg) && !OV7670_cache_volatile(reg)) {
+    return cache->value[reg];
+  }
+  return -1;
+}
+
+void OV7670_cache_store(OV7670_regcache *cache, uint8_t reg, uint8_t value) {
+  if (!OV7670_cache_volatile(reg)) {
+    cache->value[reg] = value;
+    cache->valid[reg >> 3] |= 1 << (reg & 7);
+  }
+}
+
+bool OV7670_cache_write(const OV7670_regcache *cache, uint8_t reg,
+                        uint8_t value) {
+  if ((reg == OV7670_REG_COM7) && (value & OV7670_COM7_RESET)) {
+    return true; // Reset always goes to the camera
+  }
+  return OV7670_cache_read(cache, reg) != value;
+}
+
+void OV7670_cache_written(OV7670_regcache *cache, uint8_t reg, uint8_t value,
+                          bool ok) {
+  if ((reg == OV7670_REG_COM7) && (value & OV7670_COM7_RESET)) {
+    // Every register reverts to its default (or if the write failed, may
+    // or may not have), and the reset bit itself self-clears. Start over,
+    // learning values as they're written.
+    OV7670_cache_clear(cache);
+  } else if (ok) {
+    cache->value[reg] = value;
+    cache->valid[reg >> 3] |= 1 << (reg & 7);
+  } else { // Camera may or may not have it, find out next time it's read
+    cache->valid[reg >> 3] &= ~(1 << (reg & 7));
+  }
+}
+
+// REGISTER PROFILES -------------------------------------------------------
+
+// Power-on/reset values of OV7670 registers, from the datasheet. Only
+// registers whose defaults are listed here can be left out of a "diff"
+// profile, anything else is always included.
+static const OV7670_command OV7670_defaults[] = {
+    {OV7670_REG_GAIN, 0x00},    {OV7670_REG_BLUE, 0x80},
+    {OV7670_REG_RED, 0x80},     {OV7670_REG_VREF, 0x00},
+    {OV7670_REG_COM1, 0x00},    {OV7670_REG_COM2, 0x01},
+    {OV7670_REG_PID, 0x76},     {OV7670_REG_VER, 0x73},
+    {OV7670_REG_COM3, 0x00},    {OV7670_REG_COM4, 0x00},
+    {OV7670_REG_COM5, 0x01},    {OV7670_REG_COM6, 0x43},
+    {OV7670_REG_AECH, 0x40},    {OV7670_REG_CLKRC, 0x80},
+    {OV7670_REG_COM7, 0x00},    {OV7670_REG_COM8, 0x8F},
+    {OV7670_REG_COM9, 0x4A},    {OV7670_REG_COM10, 0x00},
+    {OV7670_REG_HSTART, 0x11},  {OV7670_REG_HSTOP, 0x61},
+    {OV7670_REG_VSTART, 0x03},  {OV7670_REG_VSTOP, 0x7B},
+    {OV7670_REG_PSHFT, 0x00},   {OV7670_REG_MIDH, 0x7F},
+    {OV7670_REG_MIDL, 0xA2},    {OV7670_REG_MVFP, 0x00},
+    {OV7670_REG_AEW, 0x75},     {OV7670_REG_AEB, 0x63},
+    {OV7670_REG_VPT, 0xD4},     {OV7670_REG_BBIAS, 0x80},
+    {OV7670_REG_GbBIAS, 0x80},  {OV7670_REG_EXHCH, 0x00},
+    {OV7670_REG_EXHCL, 0x00},   {OV7670_REG_RBIAS, 0x80},
+    {OV7670_REG_ADVFL, 0x00},   {OV7670_REG_ADVFH, 0x00},
+    {OV7670_REG_HSYST, 0x08},   {OV7670_REG_HSYEN, 0x30},
+    {OV7670_REG_HREF, 0x80},    {OV7670_REG_TSLB, 0x0D},
+    {OV7670_REG_COM11, 0x00},   {OV7670_REG_COM12, 0x68},
+    {OV7670_REG_COM13, 0x88},   {OV7670_REG_COM14, 0x00},
+    {OV7670_REG_EDGE, 0x00},    {OV7670_REG_COM15, 0xC0},
+    {OV7670_REG_COM16, 0x08},   {OV7670_REG_COM17, 0x00},
+    {OV7670_REG_MTX1, 0x40},    {OV7670_REG_MTX2, 0x34},
+    {OV7670_REG_MTX3, 0x0C},    {OV7670_REG_MTX4, 0x17},
+    {OV7670_REG_MTX5, 0x29},    {OV7670_REG_MTX6, 0x40},
+    {OV7670_REG_BRIGHT, 0x00},  {OV7670_REG_CONTRAS, 0x40},
+    {OV7670_REG_MTXS, 0x1E},    {OV7670_REG_MANU, 0x80},
+    {OV7670_REG_MANV, 0x80},    {OV7670_REG_DBLV, 0x0A},
+    {OV7670_REG_SCALING_XSC, 0x3A},
+    {OV7670_REG_SCALING_YSC, 0x35},
+    {OV7670_REG_SCALING_DCWCTR, 0x11},
+    {OV7670_REG_SCALING_PCLK_DIV, 0x00},
+    {OV7670_REG_SLOP, 0x24},    {OV7670_REG_GAM_BASE, 0x04},
+    {OV7670_REG_GAM_BASE + 1, 0x07},
+    {OV7670_REG_GAM_BASE + 2, 0x10},
+    {OV7670_REG_GAM_BASE + 3, 0x28},
+    {OV7670_REG_GAM_BASE + 4, 0x36},
+    {OV7670_REG_GAM_BASE + 5, 0x44},
+    {OV7670_REG_GAM_BASE + 6, 0x52},
+    {OV7670_REG_GAM_BASE + 7, 0x60},
+    {OV7670_REG_GAM_BASE + 8, 0x6C},
+    {OV7670_REG_GAM_BASE + 9, 0x78},
+    {OV7670_REG_GAM_BASE + 10, 0x8C},
+    {OV7670_REG_GAM_BASE + 11, 0x9E},
+    {OV7670_REG_GAM_BASE + 12, 0xBB},
+    {OV7670_REG_GAM_BASE + 13, 0xD2},
+    {OV7670_REG_GAM_BASE + 14, 0xE5},
+    {OV7670_REG_SCALING_PCLK_DELAY, 0x02},
+    {OV7670_REG_SATCTR, 0xC0},
+};
+
+int OV7670_reset_default(uint8_t reg) {
+  for (size_t i = 0; i < sizeof OV7670_defaults / sizeof OV7670_defaults[0];
+       i++) {
+    if (OV7670_defaults[i].reg == reg) {
+      return OV7670_defaults[i].value;
+    }
+  }
+  return -1;
+}
+
+int OV7670_profile_save(const OV7670_regcache *cache, OV7670_command *dest,
+                        int max, bool diff) {
+  int count = 0;
+  // COM7 goes first: it selects output format, and on restore everything
+  // else should be applied on top of that (same order as the init lists).
+  // Remaining registers follow in address order.
+  for (int i = -1; i < 256; i++) {
+    uint8_t reg = (i < 0) ? OV7670_REG_COM7 : i;
+    if ((i == OV7670_REG_COM7) || (reg == 0xFF)) {
+      continue; // COM7 already done; 0xFF isn't an OV7670 register
+    }
+    if (!OV7670_cache_known(cache, reg) ||
+        (diff && (cache->value[reg] == OV7670_reset_default(reg)))) {
+      continue; // Unknown (never written since reset), or at default
+    }
+    if (count >= max) {
+      return -1;
+    }
+    dest[count].reg = reg;
+    dest[count].value = cache->value[reg];
+    count++;
+  }
+  return count;
+}
+
+void OV7670_profile_restore(void *platform, const OV7670_command *profile,
+                            int len) {
+  for (int i = 0; i < len; i++) {
+    OV7670_write_register(platform, profile[i].reg, profile[i].value);
+    if (profile[i].reg == OV7670_REG_COM7) {
+      OV7670_delay_ms(1); // As in OV7670_write_list_fast()
+    }
+  }
+}
+
 // CAMERA STARTUP ----------------------------------------------------------
 
 static const OV7670_command
@@ -446,8 +640,25 @@ static const OV7670_command
         {OV2640_REG0_R_DVP_SP, 0x08}, // Manual DVP PCLK setting
         {OV2640_REG0_RESET, 0x00}};   // Reset nothing?
 
+// Available OV7670 PLL ratios, indexed by DBLV[7:6]
+static const uint8_t ov7670_pll_ratio[] = {1, 4, 6, 8};
+
+// Time of one frame, in microseconds, at the PCLK that CLKRC and DBLV
+// are currently set for: about 800,000 PCLKs (784x510, 2 per pixel), the
+// same figure OV7670_set_fps() works from.
+static uint32_t ov7670_frame_us(void *platform) {
+  int clkrc = OV7670_read_register(platform, OV7670_REG_CLKRC);
+  int dblv = OV7670_read_register(platform, OV7670_REG_DBLV);
+  uint32_t pclk = OV7670_XCLK_HZ;
+  if (!(clkrc & OV7670_CLK_EXT)) {
+    pclk = pclk * ov7670_pll_ratio[(dblv >> 6) & 3] /
+           ((clkrc & OV7670_CLK_SCALE) + 1);
+  }
+  return (uint32_t)(800000ULL * 1000000 / pclk);
+}
+
 OV7670_status OV7670_begin(OV7670_host *host, OV7670_colorspace colorspace,
-                           OV7670_size size, float fps) {
+                           OV7670_size size, float fps, OV7670_boot boot) {
   OV7670_status status;
 
   // I2C must already be set up and running (@ 100 KHz) in calling code
@@ -462,14 +673,29 @@ OV7670_status OV7670_begin(OV7670_host *host, OV7670_colorspace colorspace,
 
   // Unsure of camera startup time from beginning of input clock.
   // Let's guess it's similar to tS:REG (300 ms) from datasheet.
-  OV7670_delay_ms(300);
+  // In fast boot, this and the PWDN delay are replaced by polling the
+  // product ID register, as the camera doesn't answer I2C until awake.
+  if (boot == OV7670_BOOT_SAFE) {
+    OV7670_delay_ms(300);
+  }
 
   // ENABLE AND/OR RESET CAMERA --------------------------------------------
 
   if (host->pins->enable >= 0) { // Enable pin defined?
-    OV7670_pin_output(host->pins->enable)
-        OV7670_pin_write(host->pins->enable, 0); // PWDN low (enable)
-    OV7670_delay_ms(300);
+    OV7670_pin_output(host->pins->enable);
+    OV7670_pin_write(host->pins->enable, 0); // PWDN low (enable)
+    if (boot == OV7670_BOOT_SAFE) {
+      OV7670_delay_ms(300);
+    }
+  }
+
+  if (boot == OV7670_BOOT_FAST) {
+    // Time out at the same 600 ms the safe delays would've taken, and
+    // carry on regardless -- a missing camera is no better off either way.
+    uint32_t start = OV7670_micros();
+    while ((OV7670_read_register(host->platform, OV7670_REG_PID) != 0x76) &&
+           ((OV7670_micros() - start) < 600000))
+      ;
   }
 
   if (host->pins->reset >= 0) { // Hard reset pin defined?
@@ -483,14 +709,25 @@ OV7670_status OV7670_begin(OV7670_host *host, OV7670_colorspace colorspace,
   OV7670_delay_ms(1); // Datasheet: tS:RESET = 1 ms
 
 #if 1
-  (void)OV7670_set_fps(host->platform, fps); // Timing
-  if (colorspace == OV7670_COLOR_RGB) {
-    OV7670_write_list(host->platform, OV7670_rgb);
+  if (host->profile) { // Saved register state replaces the lot below
+    OV7670_profile_restore(host->platform, host->profile, host->profile_len);
   } else {
-    OV7670_write_list(host->platform, OV7670_yuv);
+    fps = OV7670_set_fps(host->platform, fps); // Timing
+    if (boot == OV7670_BOOT_FAST) {
+      OV7670_write_list_fast(host->platform, (colorspace == OV7670_COLOR_RGB)
+                                                 ? OV7670_rgb
+                                                 : OV7670_yuv);
+      OV7670_write_list_fast(host->platform, OV7670_init);
+    } else {
+      if (colorspace == OV7670_COLOR_RGB) {
+        OV7670_write_list(host->platform, OV7670_rgb);
+      } else {
+        OV7670_write_list(host->platform, OV7670_yuv);
+      }
+      OV7670_write_list(host->platform, OV7670_init); // Other config
+    }
+    OV7670_set_size(host->platform, size); // Frame size
   }
-  OV7670_write_list(host->platform, OV7670_init); // Other config
-  OV7670_set_size(host->platform, size);          // Frame size
 #else
   // Hacked OV2640 setup (WIP)
   OV7670_write_list_len(host->platform, ov2640_vga,
@@ -506,11 +743,38 @@ OV7670_status OV7670_begin(OV7670_host *host, OV7670_colorspace colorspace,
   OV7670_delay_ms(1); // Required, else lockup on init
 #endif
 
-  OV7670_delay_ms(300); // tS:REG = 300 ms (settling time = 10 frames)
+  if (boot == OV7670_BOOT_FAST) {
+    // Register changes take effect at the next frame boundary. Wait for
+    // two, so the frame that follows is entirely under the new settings
+    // (not one that was partway out when config finished). Timeout is
+    // generous, twice the expected time at the clock now programmed
+    // (by OV7670_set_fps() or the profile; fps may be 0 with the latter).
+    uint32_t frame_us = ov7670_frame_us(host->platform);
+    (void)OV7670_wait_frames(host, 2, frame_us * 4 / 1000 + 10);
+  } else {
+    OV7670_delay_ms(300); // tS:REG = 300 ms (settling time = 10 frames)
+  }
 
   return OV7670_STATUS_OK;
 }
 
+bool OV7670_wait_frames(OV7670_host *host, uint8_t frames,
+                        uint32_t timeout_ms) {
+  uint32_t start = OV7670_micros(), timeout_us = timeout_ms * 1000;
+  bool prior = OV7670_arch_vsync(host);
+  while (frames) {
+    bool vsync = OV7670_arch_vsync(host);
+    if (vsync && !prior && !--frames) { // Rising edge = frame start
+      break;
+    }
+    prior = vsync;
+    if ((OV7670_micros() - start) >= timeout_us) {
+      return false;
+    }
+  }
+  return true;
+}
+
 // MISCELLANY AND CAMERA CONFIG FUNCTIONS ----------------------------------
 
 // Configure camera frame rate. Actual resulting frame rate (returned) may
@@ -529,10 +793,8 @@ float OV7670_set_fps(void *platform, float fps) {
 
   // Pixel clock (PCLK), which determines overall frame rate, is a
   // function of XCLK input frequency (OV7670_XCLK_HZ), a PLL multiplier
-  // and then an integer division factor (1-32). These are the available
-  // OV7670 PLL ratios:
-  static const uint8_t pll_ratio[] = {1, 4, 6, 8};
-  const uint8_t num_plls = sizeof pll_ratio / sizeof pll_ratio[0];
+  // and then an integer division factor (1-32), ov7670_pll_ratio[] above.
+  const uint8_t num_plls = sizeof ov7670_pll_ratio / sizeof ov7670_pll_ratio[0];
 
   // Constrain frame rate to upper and lower limits
   fps = (fps > 30) ? 30 : fps;               // Max 30 FPS
@@ -543,7 +805,7 @@ float OV7670_set_fps(void *platform, float fps) {
       OV7670_write_register(platform, OV7670_REG_DBLV, 0);   // 1:1 PLL
       OV7670_write_register(platform, OV7670_REG_CLKRC, 31); // 1/32 div
     }
-    return (float)(pclk_min * 5 / 4000000); // Return min frame rate
+    return (float)pclk_min * 5.0 / 4000000.0; // Return min frame rate
   }
 
   // Find nearest available FPS without going over. This is done in a
@@ -559,7 +821,7 @@ float OV7670_set_fps(void *platform, float fps) {
   float best_delta = 30.0; // Best requested vs actual FPS (init to "way off")
 
   for (uint8_t p = 0; p < num_plls; p++) {
-    uint32_t xclk_pll = OV7670_XCLK_HZ * pll_ratio[p]; // PLL'd freq
+    uint32_t xclk_pll = OV7670_XCLK_HZ * ov7670_pll_ratio[p]; // PLL'd freq
     uint8_t first_div = p ? 2 : 1; // Min div is 1 for PLL 1:1, else 2
     for (uint8_t div = first_div; div <= 32; div++) {
       uint32_t pclk_result = xclk_pll / div; // PCLK-up-down permutation
@@ -578,7 +840,7 @@ float OV7670_set_fps(void *platform, float fps) {
 
   if (platform) {
     // Set up DBLV and CLKRC registers with best PLL and div values
-    if (pll_ratio[best_pll] == best_div) { // If PLL and div are same (1:1)
+    if (ov7670_pll_ratio[best_pll] == best_div) { // PLL, div same (1:1)
       // Bypass PLL, use external clock directly
       OV7670_write_register(platform, OV7670_REG_DBLV, 0);
       OV7670_write_register(platform, OV7670_REG_CLKRC, 0x40);
@@ -592,49 +854,71 @@ float OV7670_set_fps(void *platform, float fps) {
   return fps - best_delta; // Return actual frame rate
 }
 
-// Sets up PCLK dividers and sets H/V start/stop window. Rather than
-// rolling this into OV7670_set_size(), it's kept separate so test code
-// can experiment with different settings to find ideal defaults.
-void OV7670_frame_control(void *platform, uint8_t size, uint8_t vstart,
-                          uint16_t hstart, uint8_t edge_offset,
-                          uint8_t pclk_delay) {
+// PCLK divider, as a power of 2 (0-4, for 1:1 to 1:16), for a line of
+// width sensor pixels going out as out_w pixels. Each output pixel takes
+// 2 PCLKs whatever the divider, and the line (HREF) lasts as long as the
+// sensor takes to read it, so it has room for width >> divider pixels.
+// That has to hold all out_w of them -- divide further and the camera
+// drops pixels -- but no more than that is useful, a faster PCLK just
+// costs the host bandwidth. So: the largest divider that still fits.
+// With a fractional zoom, out_w doesn't fill the line, and the camera
+// leaves HREF low for the unused PCLKs.
+static uint8_t ov7670_pclk_div(uint16_t width, uint16_t out_w) {
+  uint8_t div = 0;
+  while ((div < 4) && ((width >> (div + 1)) >= out_w)) {
+    div++;
+  }
+  return div;
+}
+
+// Sets up downsampling (1:1 to 1:8, as 0-3), scaling (0x20/zoom, so 0x20
+// is 1:1 and 0x40 is 1:2), PCLK dividers and H/V start/stop window, width
+// x height sensor pixels from hstart, vstart.
+static void ov7670_frame(void *platform, uint8_t dcw, uint8_t zoom,
+                         uint16_t vstart, uint16_t hstart, uint16_t width,
+                         uint16_t height, uint8_t edge_offset,
+                         uint8_t pclk_delay) {
   uint8_t value;
+  // DCW and scaler only run on the divided clock, so it's enabled for
+  // either, even if dividing by 1 (e.g. 352x288 is zoom only)
+  bool scaled = dcw || (zoom != 0x20);
+  uint8_t pclk = ov7670_pclk_div(width, (width >> dcw) * 0x20 / zoom);
 
-  // Enable downsampling if sub-VGA, and zoom if 1:16 scale
-  value = (size > OV7670_SIZE_DIV1) ? OV7670_COM3_DCWEN : 0;
-  if (size == OV7670_SIZE_DIV16)
+  // Enable downsampling if sub-VGA, and scaler if zooming. Byte order
+  // (OV7670_set_order()) shares the register, keep it.
+  value = OV7670_read_register(platform, OV7670_REG_COM3) & OV7670_COM3_SWAP;
+  if (dcw)
+    value |= OV7670_COM3_DCWEN;
+  if (zoom != 0x20)
     value |= OV7670_COM3_SCALEEN;
   OV7670_write_register(platform, OV7670_REG_COM3, value);
 
-  // Enable PCLK division if sub-VGA 2,4,8,16 = 0x19,1A,1B,1C
-  value = (size > OV7670_SIZE_DIV1) ? (0x18 + size) : 0;
+  // Enable DCW & scaling PCLK, divided 1,2,4,8,16 = 0x18,19,1A,1B,1C
+  value = scaled ? (OV7670_COM14_DCWEN | OV7670_COM14_MANUAL | pclk) : 0;
   OV7670_write_register(platform, OV7670_REG_COM14, value);
 
   // Horiz/vert downsample ratio, 1:8 max (H,V are always equal for now)
-  value = (size <= OV7670_SIZE_DIV8) ? size : OV7670_SIZE_DIV8;
-  OV7670_write_register(platform, OV7670_REG_SCALING_DCWCTR, value * 0x11);
+  OV7670_write_register(platform, OV7670_REG_SCALING_DCWCTR, dcw * 0x11);
 
-  // Pixel clock divider if sub-VGA
-  value = (size > OV7670_SIZE_DIV1) ? (0xF0 + size) : 0x08;
+  // DSP scaler clock divided the same, bypassed at full size
+  value = scaled ? (0xF0 + pclk) : OV7670_PCLK_DIV_BYPASS;
   OV7670_write_register(platform, OV7670_REG_SCALING_PCLK_DIV, value);
 
-  // Apply 0.5 digital zoom at 1:16 size (others are downsample only)
-  value = (size == OV7670_SIZE_DIV16) ? 0x40 : 0x20; // 0.5, 1.0
   // Read current SCALING_XSC and SCALING_YSC register values because
   // test pattern settings are also stored in those registers and we
   // don't want to corrupt anything there.
   uint8_t xsc = OV7670_read_register(platform, OV7670_REG_SCALING_XSC);
   uint8_t ysc = OV7670_read_register(platform, OV7670_REG_SCALING_YSC);
-  xsc = (xsc & 0x80) | value; // Modify only scaling bits (not test pattern)
-  ysc = (ysc & 0x80) | value;
+  xsc = (xsc & 0x80) | zoom; // Modify only scaling bits (not test pattern)
+  ysc = (ysc & 0x80) | zoom;
   // Write modified result back to SCALING_XSC and SCALING_YSC
   OV7670_write_register(platform, OV7670_REG_SCALING_XSC, xsc);
   OV7670_write_register(platform, OV7670_REG_SCALING_YSC, ysc);
 
   // Window size is scattered across multiple registers.
   // Horiz/vert stops can be automatically calc'd from starts.
-  uint16_t vstop = vstart + 480;
-  uint16_t hstop = (hstart + 640) % 784;
+  uint16_t vstop = vstart + height;
+  uint16_t hstop = (hstart + width) % 784;
   OV7670_write_register(platform, OV7670_REG_HSTART, hstart >> 3);
   OV7670_write_register(platform, OV7670_REG_HSTOP, hstop >> 3);
   OV7670_write_register(platform, OV7670_REG_HREF,
@@ -648,28 +932,123 @@ void OV7670_frame_control(void *platform, uint8_t size, uint8_t vstart,
   OV7670_write_register(platform, OV7670_REG_SCALING_PCLK_DELAY, pclk_delay);
 }
 
-void OV7670_set_size(void *platform, OV7670_size size) {
-  // Array of five window settings, index of each (0-4) aligns with the five
-  // OV7670_size enumeration values. If enum changes, list must change!
-  static struct {
-    uint8_t vstart;
-    uint8_t hstart;
-    uint8_t edge_offset;
-    uint8_t pclk_delay;
-  } window[] = {
-      // Window settings were tediously determined empirically.
-      // I hope there's a formula for this, if a do-over is needed.
-      {9, 162, 2, 2},  // SIZE_DIV1  640x480 VGA
-      {10, 174, 4, 2}, // SIZE_DIV2  320x240 QVGA
-      {11, 186, 2, 2}, // SIZE_DIV4  160x120 QQVGA
-      {12, 210, 0, 2}, // SIZE_DIV8  80x60   ...
-      {15, 252, 3, 2}, // SIZE_DIV16 40x30
-  };
+// Rather than rolling this into OV7670_set_size(), it's kept separate so
+// test code can experiment with different settings to find ideal
+// defaults. Window is always the full 640x480 sensor area.
+void OV7670_frame_control(void *platform, uint8_t size, uint8_t vstart,
+                          uint16_t hstart, uint8_t edge_offset,
+                          uint8_t pclk_delay) {
+  // Downsample only, except 0.5 digital zoom at 1:16 size
+  uint8_t dcw = (size <= OV7670_SIZE_DIV8) ? size : OV7670_SIZE_DIV8;
+  uint8_t zoom = (size == OV7670_SIZE_DIV16) ? 0x40 : 0x20;
+  ov7670_frame(platform, dcw, zoom, vstart, hstart, 640, 480, edge_offset,
+               pclk_delay);
+}
+
+void OV7670_set_order(void *platform, OV7670_order order) {
+  uint8_t com3 = OV7670_read_register(platform, OV7670_REG_COM3);
+  if (order == OV7670_ORDER_LITTLE) {
+    com3 |= OV7670_COM3_SWAP;
+  } else {
+    com3 &= ~OV7670_COM3_SWAP;
+  }
+  OV7670_write_register(platform, OV7670_REG_COM3, com3);
+}
 
+// Array of five window settings, index of each (0-4) aligns with the five
+// OV7670_size enumeration values. If enum changes, list must change!
+static const struct {
+  uint8_t vstart;
+  uint8_t hstart;
+  uint8_t edge_offset;
+  uint8_t pclk_delay;
+} window[] = {
+    // Window settings were tediously determined empirically.
+    // I hope there's a formula for this, if a do-over is needed.
+    {9, 162, 2, 2},  // SIZE_DIV1  640x480 VGA
+    {10, 174, 4, 2}, // SIZE_DIV2  320x240 QVGA
+    {11, 186, 2, 2}, // SIZE_DIV4  160x120 QQVGA
+    {12, 210, 0, 2}, // SIZE_DIV8  80x60   ...
+    {15, 252, 3, 2}, // SIZE_DIV16 40x30
+};
+
+void OV7670_set_size(void *platform, OV7670_size size) {
   OV7670_frame_control(platform, size, window[size].vstart, window[size].hstart,
                        window[size].edge_offset, window[size].pclk_delay);
 }
 
+// Crop is applied to the sensor window, so each output pixel is still
+// (1 << size) sensor pixels across and down. Only the window registers
+// differ from OV7670_set_size(); downsampling and PCLK setup are the same.
+void OV7670_set_window(void *platform, OV7670_size size, uint16_t x,
+                       uint16_t y, uint16_t width, uint16_t height) {
+  uint8_t dcw = (size <= OV7670_SIZE_DIV8) ? size : OV7670_SIZE_DIV8;
+  uint8_t zoom = (size == OV7670_SIZE_DIV16) ? 0x40 : 0x20;
+  ov7670_frame(platform, dcw, zoom, window[size].vstart + (y << size),
+               window[size].hstart + (x << size), width << size,
+               height << size, window[size].edge_offset,
+               window[size].pclk_delay);
+}
+
+// Work out downsampling, zoom and sensor window for an exact output size.
+// The window is the largest the output's aspect ratio allows, so pixels
+// stay square: overall ratio r (in 1/32nds) is the lesser of 640/width
+// and 480/height, made up of downsampling by 2^dcw (as much as fits) and
+// zoom r/2^dcw. Window is then sized so the output rounds to exactly
+// width x height. Returns false if not possible (larger than VGA, or
+// beyond 1:8 downsampling with the scaler's 0x7F limit).
+static bool ov7670_scaled(uint16_t width, uint16_t height, uint8_t *dcw,
+                          uint8_t *zoom, uint16_t *win_w, uint16_t *win_h) {
+  if (!width || !height || (width > 640) || (height > 480) || (width & 1)) {
+    return false;
+  }
+  uint32_t r = 640 * 32 / width;
+  if (480 * 32 / height < r) {
+    r = 480 * 32 / height;
+  }
+  uint8_t d = 0;
+  while ((d < OV7670_SIZE_DIV8) && ((32u << (d + 1)) <= r)) {
+    d++;
+  }
+  uint32_t z = r >> d;
+  if (z > 0x7F) {
+    return false;
+  }
+  uint16_t w, h;
+  for (;; z--) { // Rounding up window may overshoot sensor, back off zoom
+    w = ((width * z + 31) / 32) << d;
+    h = ((height * z + 31) / 32) << d;
+    if (((w <= 640) && (h <= 480)) || (z <= 32)) {
+      break;
+    }
+  }
+  *dcw = d;
+  *zoom = z;
+  *win_w = w;
+  *win_h = h;
+  return true;
+}
+
+bool OV7670_scaled_size_valid(uint16_t width, uint16_t height) {
+  uint8_t dcw, zoom;
+  uint16_t win_w, win_h;
+  return ov7670_scaled(width, height, &dcw, &zoom, &win_w, &win_h);
+}
+
+// Window is centered on the sensor, using start offsets and timing from
+// the window[] entry with the same downsampling.
+bool OV7670_set_scaled_size(void *platform, uint16_t width, uint16_t height) {
+  uint8_t dcw, zoom;
+  uint16_t win_w, win_h;
+  if (!ov7670_scaled(width, height, &dcw, &zoom, &win_w, &win_h)) {
+    return false;
+  }
+  ov7670_frame(platform, dcw, zoom, window[dcw].vstart + (480 - win_h) / 2,
+               window[dcw].hstart + (640 - win_w) / 2, win_w, win_h,
+               window[dcw].edge_offset, window[dcw].pclk_delay);
+  return true;
+}
+
 // Select one of the camera's night modes (or disable).
 // Trades off frame rate for less grainy images in low light.
 // Note: seems that frame rate is somewhat automatic despite
@@ -740,6 +1119,195 @@ void OV7670_test_pattern(void *platform, OV7670_pattern pattern) {
   OV7670_write_register(platform, OV7670_REG_SCALING_YSC, ysc);
 }
 
+// FRAME BUFFER RING -------------------------------------------------------
+
+// These run in both interrupt and application context. Interrupt side
+// doesn't need protecting from the application (interrupts don't nest
+// here), application side briefly disables interrupts so its read-then-
+// update of ring state can't be split by a frame start or end.
+
+void OV7670_ring_init(OV7670_ring *ring, uint16_t *const *buffers,
+                      uint8_t count) {
+  ring->callback = NULL;
+  ring->callback_arg = NULL;
+  ring->frames = 0;
+  ring->strip_callback = NULL;
+  ring->strip_arg = NULL;
+  ring->strip_rows = ring->strip_height = ring->strip_row = 0;
+  ring->strip_buffers = 1;
+  ring->row_callback = NULL;
+  ring->row_arg = NULL;
+  ring->row_step = ring->row_width = ring->row_last = 0;
+  ring->order = OV7670_ORDER_BIG;
+  ring->swapped = false;
+  OV7670_stats_reset(&ring->stats);
+  OV7670_ring_buffers(ring, buffers, count);
+}
+
+void OV7670_ring_buffers(OV7670_ring *ring, uint16_t *const *buffers,
+                         uint8_t count) {
+  if (count > OV7670_RING_MAX) {
+    count = OV7670_RING_MAX;
+  }
+  for (uint8_t i = 0; i < count; i++) {
+    ring->buf[i] = buffers[i];
+  }
+  ring->count = count;
+  ring->little = (ring->order == OV7670_ORDER_LITTLE) ? 0xFF : 0;
+  ring->filling = ring->ready = ring->held = -1;
+}
+
+// Note capture order of buffer i, whose frame or strip just completed
+static void ov7670_ring_stamp(OV7670_ring *ring, uint8_t i) {
+  if (ring->order == OV7670_ORDER_LITTLE) {
+    ring->little |= 1 << i;
+  } else {
+    ring->little &= ~(1 << i);
+  }
+}
+
+uint16_t *OV7670_ring_start(OV7670_ring *ring) {
+  // A frame still 'filling' here never finished (VSYNC came before DMA
+  // got all its pixels, e.g. lost PCLKs); its buffer is simply reused or
+  // left free. Otherwise, find the first buffer that's neither held nor
+  // ready...
+  if (ring->filling >= 0) {
+    ring->stats.torn++;
+  }
+  int8_t i;
+  for (i = 0; i < ring->count; i++) {
+    if ((i != ring->held) && (i != ring->ready)) {
+      break;
+    }
+  }
+  if (i >= ring->count) { // None free (or count is 1)...
+    if (ring->ready >= 0) {
+      i = ring->ready; // Overwrite newest frame
+      ring->ready = -1;
+      if (ring->count > 1) {
+        ring->stats.dropped++;
+      }
+    } else {
+      i = 0;
+    }
+  }
+  ring->filling = i;
+  ring->row_last = 0;
+  return ring->buf[i];
+}
+
+void OV7670_ring_done(OV7670_ring *ring) {
+  if (ring->filling >= 0) {
+    if ((ring->ready >= 0) && (ring->count > 1)) {
+      ring->stats.dropped++; // Older ready frame is replaced, never used
+    }
+    ring->ready = ring->filling;
+    ring->filling = -1;
+    ov7670_ring_stamp(ring, ring->ready);
+    ring->frames++;
+    ring->stats.captured++;
+    if (ring->row_callback && (ring->row_last < ring->strip_height)) {
+      ring->row_last = ring->strip_height; // Remainder of frame
+      ring->row_callback(ring->buf[ring->ready], ring->strip_height,
+                         ring->row_arg);
+    }
+    if (ring->callback) {
+      ring->callback(ring->buf[ring->ready], ring->callback_arg);
+    }
+  }
+}
+
+uint16_t *OV7670_ring_acquire(OV7670_ring *ring) {
+  OV7670_disable_interrupts();
+  ring->held = ring->ready;
+  ring->ready = -1;
+  OV7670_enable_interrupts();
+  return (ring->held >= 0) ? ring->buf[ring->held] : NULL;
+}
+
+void OV7670_ring_release(OV7670_ring *ring) { ring->held = -1; }
+
+uint16_t *OV7670_ring_strip_buffer(OV7670_ring *ring) {
+  uint8_t i = (ring->strip_row / ring->strip_rows) % ring->strip_buffers;
+  return ring->buf[i];
+}
+
+bool OV7670_ring_strip_done(OV7670_ring *ring) {
+  uint16_t rows = ring->strip_height - ring->strip_row;
+  if (rows > ring->strip_rows) {
+    rows = ring->strip_rows; // All but the last strip
+  }
+  ov7670_ring_stamp(ring,
+                    (ring->strip_row / ring->strip_rows) % ring->strip_buffers);
+  if (ring->strip_callback) {
+    ring->strip_callback(OV7670_ring_strip_buffer(ring), ring->strip_row,
+                         rows, ring->strip_arg);
+  }
+  ring->strip_row += rows;
+  if (ring->strip_row < ring->strip_height) {
+    return false;
+  }
+  ring->strip_row = 0;
+  ring->frames++;
+  ring->stats.captured++;
+  return true;
+}
+
+bool OV7670_ring_strip_vsync(OV7670_ring *ring, bool busy) {
+  if (!ring->strip_row) {
+    return false; // Last frame completed normally, or none started
+  }
+  if (busy && ((ring->strip_height - ring->strip_row) < ring->strip_rows)) {
+    return OV7670_ring_strip_done(ring); // Partial last strip
+  }
+  ring->stats.torn++;
+  ring->strip_row = 0;
+  return false;
+}
+
+void OV7670_ring_rows(OV7670_ring *ring, uint16_t *frame, uint16_t rows) {
+  if (rows < ring->row_last) {
+    ring->row_last = 0; // New frame
+  }
+  if ((rows / ring->row_step) > (ring->row_last / ring->row_step)) {
+    ring->row_last = rows;
+    ring->row_callback(frame, rows, ring->row_arg);
+  }
+}
+
+OV7670_order OV7670_ring_order(const OV7670_ring *ring, const uint16_t *buf) {
+  bool little = (ring->order == OV7670_ORDER_LITTLE);
+  for (uint8_t i = 0; i < ring->count; i++) {
+    if (ring->buf[i] == buf) {
+      little = (ring->little >> i) & 1;
+      break;
+    }
+  }
+  return (little != ring->swapped) ? OV7670_ORDER_LITTLE : OV7670_ORDER_BIG;
+}
+
+// CAPTURE STATISTICS ------------------------------------------------------
+
+void OV7670_stats_reset(OV7670_stats *stats) {
+  memset(stats, 0, sizeof(OV7670_stats));
+}
+
+void OV7670_stats_vsync(OV7670_stats *stats) {
+  uint32_t now = OV7670_micros();
+  if (stats->vsync_seen) {
+    uint32_t us = now - stats->vsync_us;
+    stats->interval_us = us;
+    if (!stats->interval_min_us || (us < stats->interval_min_us)) {
+      stats->interval_min_us = us;
+    }
+    if (us > stats->interval_max_us) {
+      stats->interval_max_us = us;
+    }
+  }
+  stats->vsync_us = now;
+  stats->vsync_seen = true;
+}
+
 // Reformat YUV gray component to RGB565 for TFT preview.
 // Big-endian in and out.
 void OV7670_Y2RGB565(uint16_t *ptr, uint32_t len) {
@@ -749,3 +1317,14 @@ void OV7670_Y2RGB565(uint16_t *ptr, uint32_t len) {
     *ptr++ = __builtin_bswap16(rgb); // Big-endianify RGB565 for TFT
   }
 }
+
+void OV7670_Y2RGB565_order(uint16_t *ptr, uint32_t len, OV7670_order order) {
+  if (order == OV7670_ORDER_BIG) {
+    OV7670_Y2RGB565(ptr, len);
+    return;
+  }
+  while (len--) { // Little-endian: Y in high byte, RGB565 stays native
+    uint8_t y = *ptr >> 8;
+    *ptr++ = ((y >> 3) * 0x801) | ((y & 0xFC) << 3);
+  }
+}
@@ -7,21 +7,155 @@
 #if defined(ARDUINO)
 #include <Arduino.h>
 #define OV7670_delay_ms(x) delay(x)
+#define OV7670_micros() micros()
 #define OV7670_pin_output(pin) pinMode(pin, OUTPUT);
 #define OV7670_pin_write(pin, hi) digitalWrite(pin, hi ? 1 : 0)
 #define OV7670_disable_interrupts() noInterrupts()
 #define OV7670_enable_interrupts() interrupts()
 #else
+#include <stdbool.h>
 #include <stdint.h>
 // If platform provides device-agnostic functions for millisecond delay,
-// set-pin-to-output, pin-write and/or interrupts on/off, those can be
-// #defined here as with Arduino above. If platform does NOT provide some
-// or all of these, they should go in the device-specific .c file with a
-// !defined(ARDUINO) around them.
+// microsecond time, set-pin-to-output, pin-write and/or interrupts on/off,
+// those can be #defined here as with Arduino above. If platform does NOT
+// provide some or all of these, they should go in the device-specific .c
+// file with a !defined(ARDUINO) around them.
 #endif // end platforms
 
+/**
+Shadow copy of the camera's register file, so read-modify-write sequences
+can read from RAM rather than I2C, and writes of unchanged values can be
+skipped. Maintained by the platform's register read/write functions via
+OV7670_cache_read(), OV7670_cache_write() and OV7670_cache_written().
+Declared ahead of the arch headers so an arch that is also a platform
+(posix) can embed one.
+*/
+typedef struct {
+  uint8_t value[256]; ///< Last value written or read, if valid
+  uint8_t valid[32];  ///< Bitmask, 1 bit per register, set if value known
+} OV7670_regcache;
+
+/**
+Byte order of 16-bit pixels in memory. The camera sends the high byte of
+each RGB565 pixel (or Y of a YUV pair) first, and that's how capture
+stores it unless told otherwise: big-endian. With OV7670_set_order(), the
+camera swaps bytes itself, so pixels land in the native order of the
+little-endian microcontrollers (and desktops) this runs on, and image ops
+needn't swap every pixel. An arch whose capture itself reverses each
+pixel's bytes (RP2040's 16-bit DMA path) sets the ring's 'swapped' flag,
+and OV7670_ring_order() reports the order in memory, which is then the
+opposite of the camera's. Declared ahead of OV7670_ring, which tracks
+it.
+*/
+typedef enum {
+  OV7670_ORDER_BIG = 0, ///< As sent by camera (RGB565 high byte first)
+  OV7670_ORDER_LITTLE,  ///< Bytes swapped: native uint16_t RGB565
+} OV7670_order;
+
+#define OV7670_RING_MAX 8 ///< Max frame buffers in an OV7670_ring
+
+/**
+Function called (from interrupt context) each time a frame finishes
+loading, with the completed buffer and the argument given along with the
+function. Keep it brief -- set a flag, hand off to a queue, that sort of
+thing.
+*/
+typedef void (*OV7670_frame_callback)(uint16_t *frame, void *arg);
+
+/**
+Function called (from interrupt context) in strip mode each time a strip
+of rows finishes loading: the strip's pixels, its first row within the
+frame, number of rows, and the argument given along with the function.
+The buffer is reused once capture cycles back around to it, so anything
+slow (SD writes, etc.) should copy it out or be fed from the main loop.
+*/
+typedef void (*OV7670_strip_callback)(uint16_t *pixels, uint16_t row,
+                                      uint16_t rows, void *arg);
+
+/**
+Function called (from interrupt context) as a frame loads, each time
+another set of rows is complete: the frame buffer being loaded, number of
+rows (from the top) now valid in it, and the argument given along with
+the function. Code can then work on the top of a frame while the bottom
+is still arriving, so long as it stays behind that row count.
+*/
+typedef void (*OV7670_row_callback)(uint16_t *frame, uint16_t rows,
+                                    void *arg);
+
+/**
+Capture statistics for continuous (DMA) capture, for spotting signal
+problems (e.g. a marginal PCLK connection) without a scope. Counts run
+until reset with OV7670_stats_reset().
+*/
+typedef struct {
+  uint32_t captured;        ///< Frames fully loaded into a buffer
+  uint32_t dropped;         ///< Frames not captured or lost before use
+  uint32_t torn;            ///< Frames where VSYNC arrived before DMA done
+  uint32_t restarts;        ///< DMA transfers aborted and restarted
+  uint32_t interval_us;     ///< Time between last two VSYNCs
+  uint32_t interval_min_us; ///< Shortest VSYNC interval seen, 0 if none
+  uint32_t interval_max_us; ///< Longest VSYNC interval seen
+  uint32_t vsync_us;        ///< OV7670_micros() at last VSYNC (internal)
+  bool vsync_seen;          ///< vsync_us is valid (internal)
+} OV7670_stats;
+
+/**
+Set of frame buffers for continuous (DMA) capture, so the application can
+work on one frame while the next is arriving. Each frame start takes a
+buffer that is neither held by the application nor the newest complete
+frame; if there is none (only possible with 2 buffers), the newest
+complete frame is overwritten (dropped). A count of 1 is the original
+single-buffer behavior. Elements are maintained by the OV7670_ring_*
+functions, shared between application and interrupt code, except the
+callback elements and frames counter, which can be set and read directly.
+Like the register cache, declared ahead of the arch headers, so arch
+structs can point to the ring their capture interrupts feed.
+
+In strip mode (strip_rows nonzero), each buffer holds strip_rows rows
+rather than a frame, and capture cycles through them, first row to last,
+handing each to strip_callback as it completes. This allows frame sizes
+that won't fit in RAM. Ring ownership (acquire, release) isn't used then.
+
+Each buffer's byte order is noted (in the 'little' bitmask) as a frame or
+strip completes in it, from 'order', so a buffer keeps the order it was
+captured in if capture order changes later. 'order' is the camera's
+setting; 'swapped' is set by an arch whose capture reverses each pixel's
+two bytes on the way to memory. Use OV7670_ring_order(), which accounts
+for both.
+
+Otherwise, if row_callback is set, the arch calls OV7670_ring_rows() as
+rows arrive (how often depends on the arch, at least every row_step rows)
+and the ring passes each multiple of row_step on, plus the full frame.
+*/
+typedef struct {
+  uint16_t *buf[OV7670_RING_MAX];       ///< Frame buffers
+  OV7670_frame_callback callback;       ///< Called at end of frame, if set
+  void *callback_arg;                   ///< Passed to callback
+  volatile uint32_t frames;             ///< Count of frames completed
+  OV7670_stats stats;                   ///< Updated by ring & arch interrupts
+  OV7670_strip_callback strip_callback; ///< Called per strip, if set
+  void *strip_arg;                      ///< Passed to strip_callback
+  uint16_t strip_rows;                  ///< Rows per buffer, 0 = frames
+  uint16_t strip_height;                ///< Rows per frame
+  volatile uint16_t strip_row;          ///< First row of strip in progress
+  uint8_t strip_buffers;                ///< Buffers arch cycles through
+  OV7670_row_callback row_callback;     ///< Called as rows load, if set
+  void *row_arg;                        ///< Passed to row_callback
+  uint16_t row_step;                    ///< Rows between row_callback calls
+  uint16_t row_width;                   ///< Pixels per row
+  volatile uint16_t row_last;           ///< Rows at last row_callback
+  OV7670_order order;                   ///< Byte order now being captured
+  volatile uint8_t little;              ///< Bitmask, buf[] in LITTLE order
+  bool swapped;                         ///< Capture swaps bytes of pixels
+  uint8_t count;                        ///< Number of buffers in buf[]
+  volatile int8_t filling;              ///< Buffer being captured, or -1
+  volatile int8_t ready;                ///< Newest complete frame, or -1
+  volatile int8_t held;                 ///< Buffer held by app, or -1
+} OV7670_ring;
+
 // IMPORTANT: #include ALL of the arch-specific .h files here.
 // They have #ifdef checks to only take effect on the active architecture.
+#include "arch/posix.h"
 #include "arch/rp2040.h"
 #include "arch/samd51.h"
 
@@ -36,6 +170,7 @@ typedef enum {
   OV7670_STATUS_OK = 0,         ///< Success
   OV7670_STATUS_ERR_MALLOC,     ///< malloc() call failed
   OV7670_STATUS_ERR_PERIPHERAL, ///< Peripheral (e.g. timer) not found
+  OV7670_STATUS_ERR_SIZE,       ///< Frame size not possible
 } OV7670_status;
 
 /** Supported color formats */
@@ -53,6 +188,12 @@ typedef enum {
   OV7670_SIZE_DIV16,    ///< 40 x 30
 } OV7670_size;
 
+/** Startup sequences for OV7670_begin() */
+typedef enum {
+  OV7670_BOOT_SAFE = 0, ///< Conservative fixed delays (~1 second total)
+  OV7670_BOOT_FAST,     ///< Wait on camera ID and VSYNC instead of clock
+} OV7670_boot;
+
 typedef enum {
   OV7670_TEST_PATTERN_NONE = 0,       ///< Disable test pattern
   OV7670_TEST_PATTERN_SHIFTING_1,     ///< "Shifting 1" pattern
@@ -99,9 +240,11 @@ typedef struct {
 
 /** Architecture+platform combination structure. */
 typedef struct {
-  OV7670_arch *arch; ///< Architecture-specific config data
-  OV7670_pins *pins; ///< Physical connection to camera
-  void *platform;    ///< Platform-specific data (e.g. Arduino C++ object)
+  OV7670_arch *arch;             ///< Architecture-specific config data
+  OV7670_pins *pins;             ///< Physical connection to camera
+  void *platform;                ///< Platform-specific data (e.g. C++ obj)
+  const OV7670_command *profile; ///< If set, OV7670_begin() restores this
+  uint16_t profile_len;          ///< Number of commands in profile
 } OV7670_host;
 
 #define OV7670_ADDR 0x21 //< Default I2C address if unspecified
@@ -213,6 +356,8 @@ typedef struct {
 #define OV7670_COM13_UVSWAP 0x01           //< COM13 UV swap, use w TSLB[3]
 #define OV7670_REG_COM14 0x3E              //< Common control 14
 #define OV7670_COM14_DCWEN 0x10            //< COM14 DCW & scaling PCLK enable
+#define OV7670_COM14_MANUAL 0x08           //< COM14 Manual scaling, COM7 sizes
+#define OV7670_COM14_PCLK_MASK 0x07        //< COM14 PCLK divide 2^n, if DCWEN
 #define OV7670_REG_EDGE 0x3F               //< Edge enhancement adjustment
 #define OV7670_REG_COM15 0x40              //< Common control 15
 #define OV7670_COM15_RMASK 0xC0            //< COM15 Output range mask
@@ -264,6 +409,8 @@ typedef struct {
 #define OV7670_REG_SCALING_YSC 0x71        //< Test pattern Y scaling
 #define OV7670_REG_SCALING_DCWCTR 0x72     //< DCW control
 #define OV7670_REG_SCALING_PCLK_DIV 0x73   //< DSP scale control clock divide
+#define OV7670_PCLK_DIV_BYPASS 0x08        //< SCALING_PCLK_DIV No DSP divide
+#define OV7670_PCLK_DIV_MASK 0x07          //< SCALING_PCLK_DIV Divide 2^n
 #define OV7670_REG_REG74 0x74              //< Digital gain control
 #define OV7670_REG_REG76 0x76              //< Pixel correction
 #define OV7670_REG_SLOP 0x7A               //< Gamma curve highest seg slope
@@ -552,6 +699,12 @@ typedef struct {
 
 extern OV7670_status OV7670_arch_begin(OV7670_host *host);
 
+// Each arch must also provide this, returning the current logic level of
+// the camera's VSYNC pin (high during the vertical sync pulse at the start
+// of each frame). It's polled, not interrupt-driven, and may be called
+// before or after any DMA is set up.
+extern bool OV7670_arch_vsync(OV7670_host *host);
+
 // C++ ACCESSIBLE FUNCTIONS ------------------------------------------------
 
 // These are declared in an extern "C" so Arduino platform C++ code can
@@ -563,9 +716,18 @@ extern "C" {
 
 // Architecture- and platform-neutral initialization function.
 // Called by the platform init function, this in turn may call an
-// architecture-specific init function.
+// architecture-specific init function. OV7670_BOOT_SAFE uses the original
+// fixed delays throughout. OV7670_BOOT_FAST polls the camera ID register
+// for power-up, drops the per-register delay (except after COM7) and waits
+// for a couple of VSYNCs rather than 300 ms for settings to take effect.
 OV7670_status OV7670_begin(OV7670_host *host, OV7670_colorspace colorspace,
-                           OV7670_size size, float fps);
+                           OV7670_size size, float fps, OV7670_boot boot);
+
+// Wait for a number of frame starts (VSYNC rising edges) from the camera.
+// Returns true on success, false if timeout_ms elapsed first (e.g. camera
+// not running, or VSYNC not connected).
+bool OV7670_wait_frames(OV7670_host *host, uint8_t frames,
+                        uint32_t timeout_ms);
 
 // Configure camera frame rate. Actual resulting frame rate (returned) may
 // be different depending on available clock frequencies. Result will only
@@ -582,6 +744,33 @@ float OV7670_set_fps(void *platform, float fps);
 // (powers-of-two divisions of VGA -- 640x480 down to 40x30).
 void OV7670_set_size(void *platform, OV7670_size size);
 
+// Configure camera to capture only a rectangle of the frame that
+// OV7670_set_size() would give: width x height pixels from (x,y), in that
+// size's pixels. Programs the sensor window registers, so the camera
+// sends (and DMA moves) just those pixels. Caller keeps the rectangle
+// within the frame; width should be even (pixel pairs, YUV macropixels).
+void OV7670_set_window(void *platform, OV7670_size size, uint16_t x,
+                       uint16_t y, uint16_t width, uint16_t height);
+
+// Configure camera for an exact output size that isn't a power-of-two
+// division of VGA (e.g. 352x288 CIF, 176x144 QCIF, or a display's native
+// 240x240 or 160x128), using the sensor's downsampler and fractional
+// scaler, so no resizing is needed after capture. Aspect ratio is kept
+// (square pixels) by cropping the sensor window, centered, to the output
+// shape. Width must be even. Returns false, changing nothing, if the size
+// isn't possible (larger than VGA, or too small for the scaler's range).
+bool OV7670_set_scaled_size(void *platform, uint16_t width, uint16_t height);
+
+// Check whether OV7670_set_scaled_size() can give this size, without
+// touching the camera.
+bool OV7670_scaled_size_valid(uint16_t width, uint16_t height);
+
+// Set byte order of the camera's output (via COM3_SWAP). Big-endian is
+// the camera's default; little-endian means RGB565 pixels captured on the
+// supported (little-endian) architectures are native uint16_t values. The
+// platform should note the change in its OV7670_ring, if any.
+void OV7670_set_order(void *platform, OV7670_order order);
+
 // Lower-level resolution register fiddling function, exposed so dev code
 // can test variations for OV7670_set_size() windowing defaults.
 void OV7670_frame_control(void *platform, uint8_t size, uint8_t vstart,
@@ -599,13 +788,138 @@ void OV7670_flip(void *platform, bool flip_x, bool flip_y);
 // See Adafruit_OV7670.h for notes about minor visual bug here.
 void OV7670_test_pattern(void *platform, OV7670_pattern pattern);
 
+// Register cache functions, for use by the platform layer's register
+// read/write functions (see OV7670_regcache above). The cache assumes the
+// OV7670's flat register map (OV2640 bank switching isn't handled).
+// Registers the camera changes on its own (AGC/AEC/AWB results, averages)
+// or that are read-only IDs are never served from cache.
+
+// Invalidate all cached registers, e.g. after camera hardware reset.
+void OV7670_cache_clear(OV7670_regcache *cache);
+
+// Look up a register. Returns cached value (0-255), or -1 if the platform
+// must read the camera (and should then pass result to OV7670_cache_store).
+int OV7670_cache_read(const OV7670_regcache *cache, uint8_t reg);
+
+// Record a value read from the camera.
+void OV7670_cache_store(OV7670_regcache *cache, uint8_t reg, uint8_t value);
+
+// Check a value about to be written. Returns true if the platform must
+// write it to the camera, false if the camera already holds that value.
+// Nothing is recorded until the write is done: see OV7670_cache_written().
+bool OV7670_cache_write(const OV7670_regcache *cache, uint8_t reg,
+                        uint8_t value);
+
+// Record the outcome of a write that OV7670_cache_write() asked for: ok
+// if the camera acknowledged it, which caches the value, else that
+// register is forgotten (so a retry isn't skipped). Writing COM7 with the
+// reset bit set invalidates the whole cache either way.
+void OV7670_cache_written(OV7670_regcache *cache, uint8_t reg, uint8_t value,
+                          bool ok);
+
+// Register profiles are the tuned register state following begin() and
+// any later config calls, saved as a list of commands that can be kept in
+// RAM or flash and replayed in one burst, instead of the full reset and
+// init tables. A full profile holds every register written since reset
+// (~120 for the built-in tables), a diff profile only those differing from
+// datasheet defaults, and is only valid when restored right after reset.
+
+// Return reset value of a register (0-255), or -1 if not known.
+int OV7670_reset_default(uint8_t reg);
+
+// Save register state from a platform's cache into dest, up to max
+// commands (256 is always enough). If diff is true, registers at their
+// default values are left out. Returns number of commands saved, or -1
+// if max was too small.
+int OV7670_profile_save(const OV7670_regcache *cache, OV7670_command *dest,
+                        int max, bool diff);
+
+// Write a saved profile to the camera, no per-register delays (except
+// after COM7, as with fast boot). Registers are written through the
+// platform's cache; if the camera's lost power since the cache was last
+// valid, clear it first. Setting the host profile & profile_len elements
+// before OV7670_begin() does all of this as part of startup.
+void OV7670_profile_restore(void *platform, const OV7670_command *profile,
+                            int len);
+
+// Frame buffer ring functions (see OV7670_ring above). Init isn't
+// interrupt-safe, do it before capture starts or with interrupts off.
+// Callback is cleared, frame count and statistics reset.
+void OV7670_ring_init(OV7670_ring *ring, uint16_t *const *buffers,
+                      uint8_t count);
+
+// Replace ring's buffers (e.g. after reallocation or changing count),
+// keeping callback and frame count. Same interrupt caveat as init; any
+// held, ready or filling frame is forgotten.
+void OV7670_ring_buffers(OV7670_ring *ring, uint16_t *const *buffers,
+                         uint8_t count);
+
+// Called from capture interrupt at frame start. Returns buffer to load.
+// If the prior frame never finished, it's counted as torn; the caller
+// should have aborted its DMA transfer (and counted the restart) first.
+uint16_t *OV7670_ring_start(OV7670_ring *ring);
+
+// Called from capture interrupt when a frame has finished loading.
+// Counts the frame and calls the ring's callback, if any. With 2 or more
+// buffers, a complete frame replaced before the application acquired it
+// counts as dropped.
+void OV7670_ring_done(OV7670_ring *ring);
+
+// Called by application to take ownership of the newest complete frame
+// (no copy), automatically releasing any prior one. Returns NULL if no new
+// frame has completed since the last acquire, leaving nothing held.
+uint16_t *OV7670_ring_acquire(OV7670_ring *ring);
+
+// Called by application to hand held frame back for capture.
+void OV7670_ring_release(OV7670_ring *ring);
+
+// Strip mode functions (see OV7670_ring above). Each is called from
+// capture interrupt; strip_done and strip_vsync return true if a frame
+// was completed. strip_buffer returns the buffer for the next strip.
+uint16_t *OV7670_ring_strip_buffer(OV7670_ring *ring);
+
+// Strip at strip_row has finished loading: pass it to the callback and
+// move on to the next (or count the frame if that was the last).
+bool OV7670_ring_strip_done(OV7670_ring *ring);
+
+// Called at VSYNC, with busy set if a strip DMA transfer was in progress
+// (the arch aborts it, after this, then restarts at row 0). If frame
+// height isn't a multiple of strip_rows, that was the last, partial
+// strip, which is handed off as complete. Otherwise, a frame in progress
+// is counted as torn.
+bool OV7670_ring_strip_vsync(OV7670_ring *ring, bool busy);
+
+// Called from capture interrupt with the count of rows loaded so far into
+// frame (not in strip mode). Calls row_callback if that's reached another
+// multiple of row_step; a count lower than last time is a new frame.
+// OV7670_ring_done() makes the final call, with the full height.
+void OV7670_ring_rows(OV7670_ring *ring, uint16_t *frame, uint16_t rows);
+
+// Byte order in memory of the last frame (or strip) captured into buf,
+// one of the ring's buffers: the camera's order at the time, reversed if
+// the ring is 'swapped'. Anything else is assumed to be in the ring's
+// current capture order.
+OV7670_order OV7670_ring_order(const OV7670_ring *ring, const uint16_t *buf);
+
+// Zero all counts in a capture statistics struct. OV7670_ring_init()
+// does this for the ring's stats. Not interrupt-safe.
+void OV7670_stats_reset(OV7670_stats *stats);
+
+// Called from capture interrupt at every VSYNC, whether or not capture is
+// suspended, to update frame interval statistics.
+void OV7670_stats_vsync(OV7670_stats *stats);
+
 // Convert Y (brightness) component YUV image in RAM to RGB565 big-
 // endian format for preview on TFT display. Data is overwritten in-place,
 // Y is truncated and UV elements are lost. No practical use outside TFT
-// preview. If you need actual grayscale 0-255 data, just access the low
-// byte of each 16-bit YUV pixel.
+// preview. If you need actual grayscale 0-255 data, OV7670_Y_extract()
+// (image_ops.h) packs it into one byte per pixel.
 void OV7670_Y2RGB565(uint16_t *ptr, uint32_t len);
 
+// As OV7670_Y2RGB565(), for data in either byte order (Y is the high byte
+// of each uint16_t with OV7670_ORDER_LITTLE), output in that same order.
+void OV7670_Y2RGB565_order(uint16_t *ptr, uint32_t len, OV7670_order order);
+
 #ifdef __cplusplus
 };
 #endif